@@ -19,6 +19,10 @@
 #include <set>
 #include <unordered_set>
 #include <string>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
 
 // TODO check usage
 #define GLM_FORCE_PURE
@@ -39,4 +43,8 @@
 #include <fbxsdk.h>
 
 // App Specific
-#define VERT_PRECISION 1000
\ No newline at end of file
+#define QGEN_VERSION "0.0.5"
+#define VERT_PRECISION 1000
+// Max per-axis distance (in units of 1/VERT_PRECISION) across a rounding
+// boundary for which two verts are still welded by VertHashGrid
+#define VERT_WELD_TOLERANCE 0.01f
\ No newline at end of file
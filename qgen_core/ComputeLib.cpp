@@ -1,5 +1,15 @@
 #include "ComputeLib.h"
 
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QG_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
 
 namespace qg {
 	// TEMP SAMPLE lambda
@@ -27,4 +37,113 @@ namespace qg {
 		}
 		return pos_list;
 	}
+
+	// Cephes style sinf / cosf: reduce by multiples of pi/2 (3 part
+	// Cody-Waite constant), minimax polynomials on [-pi/4, pi/4], then
+	// pick sign / function by quadrant
+#ifdef QG_SIMD_SSE2
+	static inline void sinCos4(const float* a, float* s, float* c) {
+		const __m128 x = _mm_loadu_ps(a);
+		const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.63661977236758134f))); // 2 / pi
+		const __m128 qf = _mm_cvtepi32_ps(q);
+		__m128 t = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(1.5703125f)));
+		t = _mm_sub_ps(t, _mm_mul_ps(qf, _mm_set1_ps(4.837512969970703125e-4f)));
+		t = _mm_sub_ps(t, _mm_mul_ps(qf, _mm_set1_ps(7.54978995489188216e-8f)));
+		const __m128 z = _mm_mul_ps(t, t);
+
+		__m128 ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), z), _mm_set1_ps(8.3321608736e-3f));
+		ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(-1.6666654611e-1f));
+		ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), t), t);
+
+		__m128 pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), z), _mm_set1_ps(-1.388731625493765e-3f));
+		pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(4.166664568298827e-2f));
+		pc = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(pc, z), z), _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+		// Quadrant 1 and 3 swap sin / cos, sign flips per quadrant
+		const __m128i one = _mm_set1_epi32(1);
+		const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+		const __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+		const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), _mm_set1_epi32(2)), 30));
+		__m128 rs = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+		__m128 rc = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+		_mm_storeu_ps(s, _mm_xor_ps(rs, sinSign));
+		_mm_storeu_ps(c, _mm_xor_ps(rc, cosSign));
+	}
+#endif
+
+	static inline void sinCos1(float x, float* s, float* c) {
+		const int q = (int)std::lrint(x * 0.63661977236758134f);
+		const float qf = (float)q;
+		float t = x - qf * 1.5703125f;
+		t = t - qf * 4.837512969970703125e-4f;
+		t = t - qf * 7.54978995489188216e-8f;
+		const float z = t * t;
+		float ps = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * t + t;
+		float pc = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+		float rs = (q & 1) ? pc : ps;
+		float rc = (q & 1) ? ps : pc;
+		*s = (q & 2) ? -rs : rs;
+		*c = ((q + 1) & 2) ? -rc : rc;
+	}
+
+	void sinCosBatchScalar(const float* angles, float* sines, float* cosines, size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			sinCos1(angles[i], sines + i, cosines + i);
+		}
+	}
+
+	void sinCosBatch(const float* angles, float* sines, float* cosines, size_t n) {
+#ifdef QG_SIMD_SSE2
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			sinCos4(angles + i, sines + i, cosines + i);
+		}
+		if (i < n) {
+			// Pad the tail to a full vector
+			float a[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float s[4];
+			float c[4];
+			for (size_t k = 0; k < n - i; k++) a[k] = angles[i + k];
+			sinCos4(a, s, c);
+			for (size_t k = 0; k < n - i; k++) {
+				sines[i + k] = s[k];
+				cosines[i + k] = c[k];
+			}
+		}
+#else
+		sinCosBatchScalar(angles, sines, cosines, n);
+#endif
+	}
+
+	void parallelFor(size_t count, int threadCount, const function<void(size_t)>& body) {
+		if (threadCount <= 0) threadCount = (int)std::thread::hardware_concurrency();
+		if (threadCount <= 0) threadCount = 1;
+		if ((size_t)threadCount > count) threadCount = (int)count;
+		if (threadCount <= 1) {
+			for (size_t i = 0; i < count; i++) body(i);
+			return;
+		}
+
+		std::atomic<size_t> next(0);
+		std::exception_ptr error;
+		std::mutex error_mutex;
+		auto worker = [&]() {
+			size_t i;
+			while ((i = next.fetch_add(1)) < count) {
+				try {
+					body(i);
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(error_mutex);
+					if (!error) error = std::current_exception();
+					next = count; // stop handing out work
+				}
+			}
+		};
+		vector<std::thread> workers;
+		for (int t = 1; t < threadCount; t++) workers.emplace_back(worker);
+		worker(); // calling thread takes part
+		for (auto& w : workers) w.join();
+		if (error) std::rethrow_exception(error);
+	}
 }
\ No newline at end of file
@@ -3,7 +3,10 @@
 #include "BaseWrapper.h"
 
 using namespace std;
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <mutex>
 
 namespace qg {
 	
@@ -13,4 +16,116 @@ namespace qg {
 	typedef function<float(SpreaderInput)> ScaleVariatorLambda;
 
 	vector<glm::vec3> positionRadialSpreader(const SpreaderInput p, const ScaleVariatorLambda scale_variator_lambda);
+
+	// sin / cos of n angles. SSE2 four lanes at a time, the tail is padded
+	// into a full vector so every angle goes through the same instructions:
+	// a result never depends on n or on its position in the batch.
+	// Max abs error ~1e-7 for |angle| < 1e4
+	void sinCosBatch(const float* angles, float* sines, float* cosines, size_t n);
+
+	// Portable one angle at a time kernel, same reduction and polynomials.
+	// sinCosBatch without SSE2; always built so the two can be compared
+	void sinCosBatchScalar(const float* angles, float* sines, float* cosines, size_t n);
+
+	// Batched positionRadialSpreader: variator is any float(const SpreaderInput&)
+	// callable, inlined instead of a std::function call per point. Point i
+	// is rotated by (i - 1) * deltaAngle directly rather than by repeated
+	// rotateY, so error does not accumulate along the ring.
+	// Writes p.count points to out, no allocation
+	template <class Variator>
+	void positionRadialSpreaderBatch(const SpreaderInput& p, Variator&& scale_variator, glm::vec3* out) {
+		const float PI = M_PI;
+		const int C = p.count;
+		const float deltaAngle = PI * 2 * p.direction / C;
+		const float y = p.step_index * p.step_delta;
+
+		const int CHUNK = 64;
+		float angles[CHUNK];
+		float sines[CHUNK];
+		float cosines[CHUNK];
+		SpreaderInput p1 = p;
+		for (int base = 0; base < C; base += CHUNK) {
+			const int n = std::min(CHUNK, C - base);
+			for (int k = 0; k < n; k++) {
+				angles[k] = (float)(base + k) * deltaAngle;
+			}
+			sinCosBatch(angles, sines, cosines, n);
+			for (int k = 0; k < n; k++) {
+				p1.radial_index = base + k + 1;
+				float scaleFactor = scale_variator(p1);
+				// glm::rotateY of (radius, y, 0)
+				out[base + k] = glm::vec3(p.radius * cosines[k], y, -p.radius * sines[k]) * scaleFactor;
+			}
+		}
+	}
+
+	// Runs body(i) for i in [0, count) on threadCount worker threads
+	// (hardware concurrency if <= 0). Indices are handed out dynamically,
+	// the first exception thrown by body is rethrown on the caller
+	void parallelFor(size_t count, int threadCount, const function<void(size_t)>& body);
+
+	// Blocking FIFO between pipeline stages, bounded by item count and by a
+	// caller supplied cost per item (e.g. bytes, 0 = no cost limit): push
+	// waits while either bound is reached, which holds back a producer
+	// running ahead of its consumer. An empty queue takes any item, so one
+	// oversized item cannot deadlock. close() wakes every waiter: push then
+	// returns false, pop drains what is left and then returns false
+	template <class T>
+	class BoundedQueue {
+	public:
+		explicit BoundedQueue(size_t maxItems, size_t maxCost = 0)
+			: max_items(maxItems ? maxItems : 1), max_cost(maxCost) {};
+
+		bool push(T item, size_t cost = 0) {
+			std::unique_lock<std::mutex> lock(mutex);
+			not_full.wait(lock, [&]() {
+				return closed || items.empty() ||
+					(items.size() < max_items && (max_cost == 0 || queued_cost + cost <= max_cost));
+			});
+			if (closed) return false;
+			items.push_back(make_pair(std::move(item), cost));
+			queued_cost += cost;
+			not_empty.notify_one();
+			return true;
+		};
+
+		bool pop(T& item) {
+			std::unique_lock<std::mutex> lock(mutex);
+			not_empty.wait(lock, [&]() { return closed || !items.empty(); });
+			if (items.empty()) return false;
+			item = std::move(items.front().first);
+			queued_cost -= items.front().second;
+			items.pop_front();
+			not_full.notify_all();
+			return true;
+		};
+
+		void close() {
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+			not_full.notify_all();
+			not_empty.notify_all();
+		};
+
+		size_t size() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return items.size();
+		};
+		size_t cost() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return queued_cost;
+		};
+
+	private:
+		BoundedQueue(const BoundedQueue&);
+		BoundedQueue& operator=(const BoundedQueue&);
+		mutable std::mutex mutex;
+		std::condition_variable not_full;
+		std::condition_variable not_empty;
+		std::deque<pair<T, size_t>> items;
+		size_t max_items;
+		size_t max_cost;
+		size_t queued_cost = 0;
+		bool closed = false;
+	};
 }
\ No newline at end of file
@@ -5,6 +5,27 @@
 #include "BaseWrapper.h"
 
 #include "MeshStructure.h"
+#include "MeshStructureSoA.h"
+#include "MeshTopology.h"
+#include "MeshMerge.h"
+#include "FBXTransformer.h"
+#include "ComputeLib.h"
+#include "GenCore.h"
+#include "GeometryCache.h"
+#include "MeshBuilder.h"
+#include "TraceLib.h"
+#include "GenServer.h"
+#include "FbxBinaryWriter.h"
+#include "GlbWriter.h"
+#include "QgmFormat.h"
+#include "ResultCache.h"
+#include "MeshTriangles.h"
+#include "MeshDecimate.h"
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <zlib.h>
 
 using namespace std;
 using namespace qg;
@@ -108,4 +129,2068 @@ TEST_CASE("qvec3 map lookup tests", "[qvec3_2]") {
 		// size remains the same
 		REQUIRE(qmap1.size() == 2);
 	}
-}
\ No newline at end of file
+}
+
+TEST_CASE("vert hash grid welding", "[vertgrid_1]") {
+	SECTION("uniqueness matches qvec3 sets") {
+		VertHashGrid grid;
+		grid.findOrInsert({ 1.0,2.0019,1.0 }, 0);
+		grid.findOrInsert({ 1.0,2.0011,1.0 }, 1);
+		grid.findOrInsert({ 1.0,2.001111,1.0 }, 2);
+		if (VERT_PRECISION == 1000) {
+			REQUIRE(grid.size() == 2);
+			REQUIRE(grid.find({ 1.0,2.0019,1.0 }) == 0);
+			REQUIRE(grid.find({ 1.0,2.0018,1.0001 }) == 0);
+			REQUIRE(grid.find({ 1.0,2.0011,1.0 }) == 1);
+			REQUIRE(grid.find({ 1.1,2.0015,1.0001 }) == -1);
+		}
+	}
+
+	SECTION("near boundary values weld across cells") {
+		VertHashGrid grid;
+		if (VERT_PRECISION == 1000) {
+			REQUIRE(grid.findOrInsert({ 1.0,0.0004999,1.0 }, 7) == 7);
+			REQUIRE(grid.findOrInsert({ 1.0,0.0005001,1.0 }, 8) == 7);
+			REQUIRE(grid.size() == 1);
+			// Far from the boundary, neighbouring cells stay distinct
+			REQUIRE(grid.findOrInsert({ 1.0,0.0014,1.0 }, 9) == 9);
+			REQUIRE(grid.size() == 2);
+		}
+	}
+
+	SECTION("erase, update and growth") {
+		VertHashGrid grid;
+		int n = 0;
+		for (int i = 0; i < 100; i++) {
+			for (int j = 0; j < 100; j++) {
+				grid.findOrInsert({ i * 0.5f, 0.0f, j * 0.25f }, n++);
+			}
+		}
+		REQUIRE(grid.size() == 10000);
+		REQUIRE(grid.find({ 99 * 0.5f, 0.0f, 99 * 0.25f }) == 9999);
+		REQUIRE(grid.erase({ 0.0f, 0.0f, 0.0f }));
+		REQUIRE(!grid.erase({ 0.0f, 0.0f, 0.0f }));
+		REQUIRE(grid.find({ 0.0f, 0.0f, 0.0f }) == -1);
+		REQUIRE(grid.update({ 0.5f, 0.0f, 0.25f }, 42));
+		REQUIRE(grid.find({ 0.5f, 0.0f, 0.25f }) == 42);
+		REQUIRE(grid.size() == 9999);
+	}
+}
+
+TEST_CASE("mesh structure vert reverse map", "[meshstructure_1]") {
+	MeshStructure ms;
+	ms.verts = { { 0,0,0 },{ 1,0,0 },{ 1,1,0 },{ 0,1,0 } };
+	ms.rebuild_vert_index_reverse_map();
+	REQUIRE(ms.findVertIndex({ 1,1,0 }) == 2);
+	REQUIRE(ms.findVertIndex({ 1.0001f,0,0 }) == 1);
+	REQUIRE(ms.findVertIndex({ 2,2,2 }) == -1);
+
+	ms.verts.push_back({ 1.0002f,1,0 });
+	REQUIRE_THROWS(ms.rebuild_vert_index_reverse_map());
+}
+
+
+TEST_CASE("structure of arrays mesh storage", "[meshsoa_1]") {
+	MeshStructure* cube = buildDemoMesh_Cube();
+	MeshStructureSoA soa = MeshStructureSoA::fromAoS(*cube);
+	REQUIRE(soa.vertCount() == 8);
+	REQUIRE(soa.faceCount() == 6);
+	REQUIRE(reinterpret_cast<uintptr_t>(soa.vx.data()) % SOA_ALIGNMENT == 0);
+	REQUIRE(reinterpret_cast<uintptr_t>(soa.nz.data()) % SOA_ALIGNMENT == 0);
+
+	SECTION("round trip through the AoS view") {
+		MeshStructure back;
+		soa.toAoS(back);
+		REQUIRE(back.verts.size() == cube->verts.size());
+		for (size_t i = 0; i < back.verts.size(); i++) {
+			REQUIRE(back.verts[i] == cube->verts[i]);
+		}
+		for (size_t f = 0; f < back.quadFaces.size(); f++) {
+			REQUIRE(back.quadFaces[f].indices == cube->quadFaces[f].indices);
+			REQUIRE(back.quadFaces[f].uvs == cube->quadFaces[f].uvs);
+		}
+	}
+
+	SECTION("single attribute passes") {
+		soa.translate(10.0f, 0.0f, 0.0f);
+		REQUIRE(soa.vert(0) == qvec3({ -40, 0, 50 }));
+		soa.translate(-10.0f, 0.0f, 0.0f);
+
+		// Cube normals are authored flat and outward facing
+		soa.recomputeFaceNormals();
+		for (size_t f = 0; f < soa.faceCount(); f++) {
+			QuadFace qf = soa.face(f);
+			for (int c = 0; c < 4; c++) {
+				REQUIRE(qf.normals[c] == cube->quadFaces[f].normals[c]);
+			}
+		}
+	}
+
+	SECTION("export matches the AoS bulk path") {
+		FbxManager* lManager = FbxManager::Create();
+		FbxScene* lScene = FbxScene::Create(lManager, "soa");
+		FbxTransformOptions options;
+		FbxMesh* lAoS = fbxTransformMesh(*cube, lScene, "AoS", options);
+		FbxMesh* lSoA = fbxTransformMesh(soa, lScene, "SoA", options);
+		REQUIRE(lSoA->GetControlPointsCount() == lAoS->GetControlPointsCount());
+		for (int v = 0; v < lSoA->GetControlPointsCount(); v++) {
+			for (int i = 0; i < 3; i++) REQUIRE(lSoA->GetControlPoints()[v][i] == lAoS->GetControlPoints()[v][i]);
+		}
+		REQUIRE(lSoA->GetPolygonCount() == lAoS->GetPolygonCount());
+		for (int p = 0; p < lSoA->GetPolygonCount(); p++) {
+			for (int c = 0; c < 4; c++) REQUIRE(lSoA->GetPolygonVertex(p, c) == lAoS->GetPolygonVertex(p, c));
+		}
+		auto& nSoA = lSoA->GetElementNormal()->GetDirectArray();
+		auto& nAoS = lAoS->GetElementNormal()->GetDirectArray();
+		auto& uvSoA = lSoA->GetElementUV()->GetDirectArray();
+		auto& uvAoS = lAoS->GetElementUV()->GetDirectArray();
+		REQUIRE(nSoA.GetCount() == nAoS.GetCount());
+		REQUIRE(uvSoA.GetCount() == uvAoS.GetCount());
+		for (int k = 0; k < nSoA.GetCount(); k++) {
+			for (int i = 0; i < 3; i++) REQUIRE(nSoA.GetAt(k)[i] == nAoS.GetAt(k)[i]);
+			for (int i = 0; i < 2; i++) REQUIRE(uvSoA.GetAt(k)[i] == uvAoS.GetAt(k)[i]);
+		}
+
+		// Options the SoA path does not implement are refused
+		FbxTransformOptions triangles;
+		triangles.triangulate = true;
+		REQUIRE_THROWS_AS(fbxTransformMesh(soa, lScene, "SoA", triangles), invalid_argument);
+		FbxTransformOptions deduped;
+		deduped.dedupe_attributes = true;
+		REQUIRE_THROWS_AS(fbxTransformMesh(soa, lScene, "SoA", deduped), invalid_argument);
+		FbxTransformOptions incremental;
+		incremental.bulk = false;
+		REQUIRE_THROWS_AS(fbxTransformMesh(soa, lScene, "SoA", incremental), invalid_argument);
+		lManager->Destroy();
+	}
+	delete cube;
+}
+
+TEST_CASE("batched dropVerts compaction", "[dropverts_1]") {
+	// 3 x 2 grid: verts 0..11, row length 4
+	MeshStructure* ms = buildGridMesh(3, 2, 1.0f);
+	ms->rebuild_vert_index_reverse_map();
+	ms->currentBorderIndices = { 0, 1, 2, 3 };
+	REQUIRE(ms->verts.size() == 12);
+	REQUIRE(ms->quadFaces.size() == 6);
+
+	// Drop the interior vert 5 twice plus corner 11, unsorted
+	ms->dropVerts({ 11, 5, 5 });
+	REQUIRE(ms->verts.size() == 10);
+	// Vert 5 touches 4 faces, vert 11 one more
+	REQUIRE(ms->quadFaces.size() == 1);
+	// Remaining face was face 2 { 2, 6, 7, 3 }, now shifted by one
+	REQUIRE(ms->quadFaces[0].indices == array<int, 4>({ 2, 5, 6, 3 }));
+	REQUIRE(ms->verts[5] == qvec3({ 2.0f, 0.0f, 1.0f }));
+	REQUIRE(ms->currentBorderIndices == mesh_vector<int>({ 0, 1, 2, 3 }));
+
+	// Reverse map follows the compaction
+	REQUIRE(ms->findVertIndex({ 1.0f, 0.0f, 1.0f }) == -1);
+	REQUIRE(ms->findVertIndex({ 2.0f, 0.0f, 1.0f }) == 5);
+	REQUIRE(ms->findVertIndex({ 3.0f, 0.0f, 2.0f }) == -1);
+	REQUIRE(ms->findVertIndex({ 2.0f, 0.0f, 2.0f }) == 9);
+
+	REQUIRE_THROWS(ms->dropVerts({ 10 }));
+	delete ms;
+}
+
+TEST_CASE("vert to face CSR adjacency", "[adjacency_1]") {
+	// 3 x 2 grid: verts 0..11, row length 4
+	MeshStructure* ms = buildGridMesh(3, 2, 1.0f);
+	REQUIRE(vector<int>(ms->facesOfVert(5).begin(), ms->facesOfVert(5).end()) == vector<int>({ 0, 1, 3, 4 }));
+	REQUIRE(ms->facesOfVert(0).size() == 1);
+	REQUIRE(ms->facesOfVert(1).size() == 2);
+	REQUIRE(ms->facesOfVert(11)[0] == 5);
+
+	// Appending a face is picked up after invalidation
+	QuadFace qf = ms->quadFaces[0];
+	ms->quadFaces.push_back(qf);
+	ms->invalidateAdjacency();
+	REQUIRE(ms->facesOfVert(0).size() == 2);
+	REQUIRE(ms->facesOfVert(0)[1] == 6);
+
+	// dropVerts invalidates, face ids are shifted on next query
+	ms->dropVerts({ 0 });
+	REQUIRE(ms->facesOfVert(0).size() == 1);
+	REQUIRE(ms->facesOfVert(0)[0] == 0);
+
+	// The read only lookup never rebuilds, it needs an explicit build
+	const MeshStructure& readOnly = *ms;
+	ms->invalidateAdjacency();
+	REQUIRE_FALSE(readOnly.adjacencyBuilt());
+	REQUIRE_THROWS_AS(readOnly.facesOfVertBuilt(0), logic_error);
+	REQUIRE_THROWS_AS(ms->facesOfVertBuilt(0), logic_error);
+	ms->buildAdjacency();
+	REQUIRE(readOnly.facesOfVertBuilt(0).size() == 1);
+	delete ms;
+}
+
+
+TEST_CASE("half-edge topology for quad meshes", "[topology_1]") {
+	SECTION("open grid borders and rings") {
+		// 3 x 2 grid: verts 0..11, row length 4
+		MeshStructure* ms = buildGridMesh(3, 2, 1.0f);
+		MeshTopology topo;
+		REQUIRE(topo.sync(*ms));
+		REQUIRE(!topo.sync(*ms));
+		REQUIRE(topo.halfEdgeCount() == 24);
+
+		// Face 0 = { 0, 4, 5, 1 }: edge 4 -> 5 is shared with face 3 above
+		REQUIRE(topo.faceNeighbor(0, 1) == 3);
+		REQUIRE(topo.faceNeighbor(0, 0) == -1);
+		REQUIRE(topo.origin(topo.twin(1)) == 5);
+
+		auto loops = topo.boundaryLoops();
+		REQUIRE(loops.size() == 1);
+		REQUIRE(loops[0].size() == 10);
+		REQUIRE(topo.boundaryVertString(*ms, loops[0][0]).type == VertGroupType::BORDER_EDGE);
+		REQUIRE(topo.boundaryVertString(*ms, loops[0][0]).verts.size() == 10);
+
+		// Ring across the bottom row of 3 quads, from the left border
+		REQUIRE(topo.edgeRing(0).size() == 4);
+		// Starting mid row walks both ways
+		REQUIRE(topo.edgeRing(4 * 1 + 0).size() == 4);
+
+		// Punching a hole is picked up lazily
+		ms->dropVerts({ 5 });
+		REQUIRE(topo.sync(*ms));
+		REQUIRE(topo.boundaryLoops().size() == 1);
+		delete ms;
+	}
+
+	SECTION("closed cube") {
+		MeshStructure* cube = buildDemoMesh_Cube();
+		MeshTopology topo;
+		topo.build(*cube);
+		REQUIRE(topo.boundaryLoops().empty());
+		for (int h = 0; h < (int)topo.halfEdgeCount(); h++) {
+			REQUIRE(!topo.isBoundary(h));
+			REQUIRE(topo.twin(topo.twin(h)) == h);
+		}
+		REQUIRE(topo.edgeRing(0).size() == 4);
+		delete cube;
+	}
+}
+
+
+TEST_CASE("fbxTransform normal and uv deduplication", "[fbxtransform_1]") {
+	MeshStructure* cube = buildDemoMesh_Cube();
+	FbxManager* lManager = FbxManager::Create();
+	FbxScene* lScene = FbxScene::Create(lManager, "TestScene");
+
+	FbxTransformOptions options;
+	FbxMesh* lPlain = fbxTransformMesh(*cube, lScene, "Plain", options);
+	options.dedupe_attributes = true;
+	FbxMesh* lDeduped = fbxTransformMesh(*cube, lScene, "Deduped", options);
+
+	REQUIRE(lPlain->GetElementNormal()->GetDirectArray().GetCount() == 24);
+	REQUIRE(lPlain->GetElementUV()->GetDirectArray().GetCount() == 24);
+	// Flat shaded cube: one normal per side, the same 4 uv corners per side
+	REQUIRE(lDeduped->GetElementNormal()->GetDirectArray().GetCount() == 6);
+	REQUIRE(lDeduped->GetElementUV()->GetDirectArray().GetCount() == 4);
+	REQUIRE(lDeduped->GetElementNormal()->GetIndexArray().GetCount() == 24);
+	for (int k = 0; k < 24; k++) {
+		FbxVector4 n = lDeduped->GetElementNormal()->GetDirectArray().GetAt(lDeduped->GetElementNormal()->GetIndexArray().GetAt(k));
+		const qvec3& expected = cube->quadFaces[k / 4].normals[k % 4];
+		REQUIRE(qvec3({ (float)n[0], (float)n[1], (float)n[2] }) == expected);
+	}
+
+	// Bulk (raw locked pointers) and incremental (Add / SetAt) exports of
+	// the same grid agree corner by corner, read through the index arrays
+	MeshStructure* grid = buildGridMesh(6, 5, 1.0f);
+	for (size_t f = 0; f < grid->quadFaces.size(); f++) {
+		for (int c = 0; c < 4; c++) {
+			grid->quadFaces[f].normals[c] = qvec3{ 0.1f * c, 1.0f, 0.01f * f };
+			grid->quadFaces[f].uvs[c].x += 0.001f * f;
+		}
+	}
+	auto cornerValues = [](FbxMesh* lMesh, int p, int c, FbxVector4& pos, FbxVector4& n, FbxVector2& uv) {
+		int k = 0;
+		for (int q = 0; q < p; q++) k += lMesh->GetPolygonSize(q);
+		k += c;
+		pos = lMesh->GetControlPoints()[lMesh->GetPolygonVertex(p, c)];
+		auto* lNormals = lMesh->GetElementNormal();
+		n = lNormals->GetDirectArray().GetAt(lNormals->GetIndexArray().GetAt(k));
+		auto* lUVs = lMesh->GetElementUV();
+		uv = lUVs->GetDirectArray().GetAt(lUVs->GetIndexArray().GetAt(k));
+	};
+	FbxTransformOptions incremental;
+	incremental.bulk = false;
+	FbxMesh* lIncremental = fbxTransformMesh(*grid, lScene, "Incremental", incremental);
+	for (int dedupe = 0; dedupe < 2; dedupe++) {
+		FbxTransformOptions bulk;
+		bulk.dedupe_attributes = dedupe != 0;
+		FbxMesh* lBulk = fbxTransformMesh(*grid, lScene, "Bulk", bulk);
+		REQUIRE(lBulk->GetPolygonCount() == 30);
+		REQUIRE(lIncremental->GetPolygonCount() == 30);
+		for (int p = 0; p < 30; p++) {
+			REQUIRE(lBulk->GetPolygonSize(p) == 4);
+			REQUIRE(lIncremental->GetPolygonSize(p) == 4);
+			for (int c = 0; c < 4; c++) {
+				FbxVector4 pb, nb, pi, ni;
+				FbxVector2 ub, ui;
+				cornerValues(lBulk, p, c, pb, nb, ub);
+				cornerValues(lIncremental, p, c, pi, ni, ui);
+				for (int i = 0; i < 3; i++) {
+					REQUIRE(pb[i] == pi[i]);
+					REQUIRE(nb[i] == Approx(ni[i]).margin(1.0 / VERT_PRECISION));
+				}
+				for (int i = 0; i < 2; i++) REQUIRE(ub[i] == Approx(ui[i]).margin(1.0 / VERT_PRECISION));
+				const QuadFace& qf = grid->quadFaces[p];
+				REQUIRE((float)pb[0] == grid->verts[qf.indices[c]].x);
+				REQUIRE((float)nb[0] == Approx(qf.normals[c].x).margin(1.0 / VERT_PRECISION));
+				REQUIRE((float)ub[0] == Approx(qf.uvs[c].x).margin(1.0 / VERT_PRECISION));
+			}
+		}
+	}
+	delete grid;
+
+	lManager->Destroy();
+	delete cube;
+}
+
+TEST_CASE("parallel helpers and batch mesh generation", "[parallel_1]") {
+	SECTION("parallelFor visits every index once") {
+		vector<int> hits(1000, 0);
+		parallelFor(hits.size(), 8, [&](size_t i) { hits[i]++; });
+		REQUIRE(std::count(hits.begin(), hits.end(), 1) == 1000);
+		REQUIRE_THROWS(parallelFor(100, 4, [](size_t i) {
+			if (i == 42) throw std::runtime_error("fail");
+		}));
+	}
+
+	SECTION("batch output does not depend on thread count") {
+		GenMeshBuilder builder = [](const GenMeshJob& job) {
+			return buildGridMesh(job.rotateAxis + 1, 2, 10.0f);
+		};
+		const int N = 7;
+		REQUIRE(CreateScene());
+		FbxNode* lRoot = const_cast<FbxNode*>(GetRootNode());
+		int base = lRoot->GetChildCount();
+
+		ResetGenMeshState();
+		CreateGenMeshBatch(N, builder, 1, false, false);
+		ResetGenMeshState();
+		CreateGenMeshBatch(N, builder, 8, false, false);
+		REQUIRE(lRoot->GetChildCount() == base + 2 * N);
+
+		for (int i = 0; i < N; i++) {
+			FbxNode* a = lRoot->GetChild(base + i);
+			FbxNode* b = lRoot->GetChild(base + N + i);
+			REQUIRE(string(a->GetName()) == "GenMesh_" + to_string(i + 1));
+			REQUIRE(string(a->GetName()) == string(b->GetName()));
+			REQUIRE(a->LclTranslation.Get()[0] == b->LclTranslation.Get()[0]);
+			REQUIRE(a->LclTranslation.Get()[1] == b->LclTranslation.Get()[1]);
+			REQUIRE(a->GetMesh()->GetPolygonCount() == b->GetMesh()->GetPolygonCount());
+		}
+
+		// A builder returning no mesh fails the batch before the commit
+		GenMeshBuilder partial = [](const GenMeshJob& job) -> MeshStructure* {
+			return job.name == "GenMesh_3" ? NULL : buildGridMesh(1, 1, 1.0f);
+		};
+		ResetGenMeshState();
+		REQUIRE_THROWS_AS(CreateGenMeshBatch(N, partial, 4, false, false), std::runtime_error);
+		REQUIRE(lRoot->GetChildCount() == base + 2 * N);
+		ResetGenMeshState();
+	}
+}
+
+TEST_CASE("instanced geometry cache", "[geometrycache_1]") {
+	MeshStructure* cubeA = buildDemoMesh_Cube();
+	MeshStructure* cubeB = buildDemoMesh_Cube();
+	MeshStructure* moved = buildDemoMesh_Cube();
+	moved->verts[0].x += 1.0f;
+	// Float noise below VERT_PRECISION is the same geometry
+	cubeB->verts[1].y += 0.00001f;
+
+	REQUIRE(meshContentHash(*cubeA) == meshContentHash(*cubeB));
+	REQUIRE(meshContentEqual(*cubeA, *cubeB));
+	REQUIRE(!meshContentEqual(*cubeA, *moved));
+
+	FbxManager* lManager = FbxManager::Create();
+	FbxScene* lScene = FbxScene::Create(lManager, "TestScene");
+	GeometryCache cache;
+	FbxNode* n1 = fbxInstance(*cubeA, lScene, "Cube_1", cache);
+	FbxNode* n2 = fbxInstance(*cubeB, lScene, "Cube_2", cache);
+	FbxNode* n3 = fbxInstance(*moved, lScene, "Cube_3", cache);
+	REQUIRE(n1 != n2);
+	REQUIRE(n1->GetMesh() == n2->GetMesh());
+	REQUIRE(n1->GetMesh() != n3->GetMesh());
+	REQUIRE(cache.size() == 2);
+	REQUIRE(cache.hits == 1);
+	REQUIRE(cache.misses == 2);
+
+	lManager->Destroy();
+	delete cubeA;
+	delete cubeB;
+	delete moved;
+}
+
+TEST_CASE("batched radial spreader", "[spreader_1]") {
+	SECTION("sinCosBatch accuracy and lane independence") {
+		vector<float> angles;
+		for (int i = -500; i <= 500; i++) angles.push_back(i * 0.0137f);
+		vector<float> s(angles.size()), c(angles.size());
+		sinCosBatch(angles.data(), s.data(), c.data(), angles.size());
+		for (size_t i = 0; i < angles.size(); i++) {
+			REQUIRE(std::fabs(s[i] - std::sin(angles[i])) < 1e-6f);
+			REQUIRE(std::fabs(c[i] - std::cos(angles[i])) < 1e-6f);
+			// Same bits computed alone as inside a batch
+			float s1, c1;
+			sinCosBatch(&angles[i], &s1, &c1, 1);
+			REQUIRE(std::memcmp(&s1, &s[i], sizeof(float)) == 0);
+			REQUIRE(std::memcmp(&c1, &c[i], sizeof(float)) == 0);
+		}
+
+		// The scalar kernel agrees with whichever one sinCosBatch uses,
+		// across all quadrants and up to the documented range
+		for (int i = -2000; i <= 2000; i++) angles.push_back(i * 4.99f);
+		s.resize(angles.size());
+		c.resize(angles.size());
+		vector<float> ss(angles.size()), sc(angles.size());
+		sinCosBatch(angles.data(), s.data(), c.data(), angles.size());
+		sinCosBatchScalar(angles.data(), ss.data(), sc.data(), angles.size());
+		for (size_t i = 0; i < angles.size(); i++) {
+			REQUIRE(std::fabs(ss[i] - s[i]) < 1e-6f);
+			REQUIRE(std::fabs(sc[i] - c[i]) < 1e-6f);
+		}
+	}
+
+	SECTION("matches positionRadialSpreader") {
+		auto scaleVariator = [](const SpreaderInput& p) {
+			return 1.0f + 0.01f * p.radial_index;
+		};
+		SpreaderInput p = { 101, 10.0f, 0, 3, 2.0f, -1 };
+		vector<glm::vec3> expected = positionRadialSpreader(p, scaleVariator);
+		vector<glm::vec3> out(p.count);
+		positionRadialSpreaderBatch(p, scaleVariator, out.data());
+		for (int i = 0; i < p.count; i++) {
+			REQUIRE(std::fabs(out[i].x - expected[i].x) < 1e-3f);
+			REQUIRE(std::fabs(out[i].y - expected[i].y) < 1e-3f);
+			REQUIRE(std::fabs(out[i].z - expected[i].z) < 1e-3f);
+		}
+	}
+}
+
+
+// Quad (i, j) of a flat grid as a position based DTO
+static QuadFaceDTO gridFaceDTO(int i, int j, float cell) {
+	QuadFaceDTO dto;
+	float x0 = i * cell, x1 = (i + 1) * cell, z0 = j * cell, z1 = (j + 1) * cell;
+	dto.verts[0] = { x0, 0.0f, z0 };
+	dto.verts[1] = { x0, 0.0f, z1 };
+	dto.verts[2] = { x1, 0.0f, z1 };
+	dto.verts[3] = { x1, 0.0f, z0 };
+	for (int c = 0; c < 4; c++) {
+		dto.uvs[c] = { 0.0f, 0.0f };
+		dto.normals[c] = { 0.0f, 1.0f, 0.0f };
+	}
+	dto.faceIndex = j;
+	return dto;
+}
+
+TEST_CASE("streaming mesh builder with welding", "[streambuilder_1]") {
+	MeshStreamBuilder builder(12, 6);
+	vector<QuadFaceDTO> row;
+	for (int i = 0; i < 3; i++) row.push_back(gridFaceDTO(i, 0, 1.0f));
+	builder.addFaceBatch(row);
+	for (int i = 0; i < 3; i++) builder.addFace(gridFaceDTO(i, 1, 1.0f));
+	REQUIRE(builder.faceCount() == 6);
+	// Shared corners welded: same vert count as buildGridMesh(3, 2)
+	REQUIRE(builder.vertCount() == 12);
+
+	MeshStructure ms = builder.finish();
+	REQUIRE(builder.faceCount() == 0);
+	REQUIRE(ms.quadFaces.size() == 6);
+	REQUIRE(ms.findVertIndex({ 3.0f, 0.0f, 2.0f }) >= 0);
+	// Same topology as the index based grid builder
+	MeshTopology topo;
+	topo.build(ms);
+	REQUIRE(topo.boundaryLoops().size() == 1);
+	REQUIRE(topo.boundaryLoops()[0].size() == 10);
+
+	// Faces appended after loading verts directly weld against them
+	MeshStructure* grid = buildGridMesh(3, 2, 1.0f);
+	grid->addFace(gridFaceDTO(3, 0, 1.0f));
+	REQUIRE(grid->verts.size() == 14);
+	delete grid;
+}
+
+TEST_CASE("arena allocation for generated meshes", "[arena_1]") {
+	SECTION("counting allocations per mesh") {
+		CountingResource counter;
+		{
+			ScopedMemoryResource scope(&counter);
+			MeshStructure* ms = buildGridMesh(10, 10, 1.0f);
+			ms->rebuild_vert_index_reverse_map();
+			REQUIRE(counter.allocations > 0);
+			REQUIRE(counter.bytes_in_use >= ms->verts.size() * sizeof(qvec3));
+			delete ms;
+		}
+		REQUIRE(counter.bytes_in_use == 0);
+		REQUIRE(counter.deallocations == counter.allocations);
+		REQUIRE(currentMemoryResource() == heapResource());
+	}
+
+	SECTION("monotonic arena pool") {
+		MeshArenaPool pool(64 * 1024);
+		for (int m = 0; m < 50; m++) {
+			MeshStructure* ms = pool.create();
+			for (int i = 0; i < 20; i++) ms->addFace(gridFaceDTO(i, m, 1.0f));
+			ms->holes_and_borders["border"].verts.push_back({ 0.0f, 0.0f, 0.0f });
+			REQUIRE(ms->quadFaces.size() == 20);
+		}
+		REQUIRE(pool.meshCount() == 50);
+		// Thousands of container allocations served by a handful of blocks
+		REQUIRE(pool.arena().blockCount() < 10);
+		REQUIRE(pool.upstreamStats().allocations == pool.arena().blockCount());
+		REQUIRE(pool.arena().bytesUsed() > 50 * 20 * sizeof(QuadFace));
+
+		pool.reset();
+		REQUIRE(pool.meshCount() == 0);
+		REQUIRE(pool.arena().bytesReserved() == 0);
+		REQUIRE(pool.upstreamStats().bytes_in_use == 0);
+	}
+
+	SECTION("copy, move and assignment keep one resource per mesh") {
+		CountingResource counter;
+		{
+			MeshStructure* built;
+			{
+				ScopedMemoryResource scope(&counter);
+				built = buildGridMesh(4, 4, 1.0f);
+				built->rebuild_vert_index_reverse_map();
+				built->buildAdjacency();
+			}
+			REQUIRE(built->memoryResource() == &counter);
+			REQUIRE(built->allocatorsConsistent());
+
+			// Copies take the current resource, moves keep the source's
+			MeshStructure copy = *built;
+			REQUIRE(copy.memoryResource() == heapResource());
+			REQUIRE(copy.allocatorsConsistent());
+			MeshStructure moved = std::move(*built);
+			REQUIRE(moved.memoryResource() == &counter);
+			REQUIRE(moved.allocatorsConsistent());
+			REQUIRE(moved.findVertIndex({ 1.0f, 0.0f, 1.0f }) >= 0);
+
+			// Assignment keeps the target's
+			MeshStructure assigned;
+			assigned = moved;
+			REQUIRE(assigned.memoryResource() == heapResource());
+			REQUIRE(assigned.allocatorsConsistent());
+			MeshStructure moveAssigned;
+			moveAssigned = std::move(moved);
+			REQUIRE(moveAssigned.memoryResource() == heapResource());
+			REQUIRE(moveAssigned.allocatorsConsistent());
+			REQUIRE(moveAssigned.quadFaces.size() == 16);
+
+			std::swap(copy, *built);
+			REQUIRE(built->memoryResource() == &counter);
+			REQUIRE(built->allocatorsConsistent());
+			REQUIRE(built->quadFaces.size() == 16);
+			delete built;
+		}
+		// Every block went back through the resource it came from
+		REQUIRE(counter.bytes_in_use == 0);
+		REQUIRE(counter.deallocations == counter.allocations);
+	}
+}
+
+
+// n x n grid module shifted along X, with its left and right edges
+// declared as borders
+static MeshStructure gridModule(int n, float offsetX) {
+	MeshStructure* grid = buildGridMesh(n, n, 1.0f);
+	MeshStructure ms = *grid;
+	delete grid;
+	VertString left, right;
+	for (auto &v : ms.verts) {
+		v.x += offsetX;
+		if (v.x == offsetX) left.verts.push_back(v);
+		if (v.x == offsetX + n) right.verts.push_back(v);
+	}
+	ms.holes_and_borders["left"] = left;
+	ms.holes_and_borders["right"] = right;
+	ms.invalidateAdjacency();
+	return ms;
+}
+
+TEST_CASE("mesh merge with border welding", "[merge_1]") {
+	SECTION("two modules") {
+		MeshStructure a = gridModule(4, 0.0f);
+		MeshStructure b = gridModule(4, 4.0f);
+		MeshMergeOptions options;
+
+		options.weld = MeshWeldMode::NONE;
+		MeshStructure plain = mergeMeshes({ &a, &b }, options);
+		REQUIRE(plain.verts.size() == 50);
+		REQUIRE(plain.quadFaces.size() == 32);
+		REQUIRE(plain.quadFaces[16].indices[0] == b.quadFaces[0].indices[0] + 25);
+		REQUIRE(plain.holes_and_borders.size() == 4);
+		REQUIRE(plain.holes_and_borders.count("left.1"));
+
+		options.weld = MeshWeldMode::BORDERS;
+		MeshStructure welded = mergeMeshes({ &a, &b }, options);
+		REQUIRE(welded.verts.size() == 45);
+		REQUIRE(welded.quadFaces.size() == 32);
+		// The seam is interior now, the outer edges stay borders
+		REQUIRE(welded.holes_and_borders.size() == 2);
+		REQUIRE(welded.holes_and_borders.count("left"));
+		REQUIRE(welded.holes_and_borders.count("right"));
+		MeshTopology topo;
+		topo.build(welded);
+		REQUIRE(topo.boundaryLoops().size() == 1);
+		REQUIRE(topo.boundaryLoops()[0].size() == 24);
+		for (const auto &qf : welded.quadFaces) {
+			for (int c = 0; c < 4; c++) {
+				REQUIRE(qf.indices[c] >= 0);
+				REQUIRE(qf.indices[c] < (int)welded.verts.size());
+			}
+		}
+
+		options.weld = MeshWeldMode::SPATIAL;
+		MeshStructure spatial = mergeMeshes({ &a, &b }, options);
+		REQUIRE(spatial.verts.size() == 45);
+		REQUIRE(meshContentEqual(spatial, welded));
+
+		MeshStructure sum = a + b;
+		REQUIRE(meshContentEqual(sum, welded));
+		REQUIRE_NOTHROW(sum.rebuild_vert_index_reverse_map());
+	}
+
+	SECTION("many modules, serial and parallel agree") {
+		vector<MeshStructure> modules;
+		for (int m = 0; m < 300; m++) modules.push_back(gridModule(2, 2.0f * m));
+		vector<const MeshStructure*> parts;
+		for (const auto &m : modules) parts.push_back(&m);
+
+		MeshMergeOptions options;
+		options.threads = 1;
+		MeshStructure serial = mergeMeshes(parts, options);
+		options.threads = 4;
+		MeshStructure parallel = mergeMeshes(parts, options);
+		REQUIRE(serial.verts.size() == 300 * 9 - 299 * 3);
+		REQUIRE(serial.quadFaces.size() == 300 * 4);
+		REQUIRE(meshContentEqual(serial, parallel));
+		REQUIRE(serial.holes_and_borders.size() == 2);
+	}
+
+	SECTION("bridging vert strings") {
+		MeshStructure ms;
+		VertString base;
+		for (int i = 0; i < 4; i++) base.verts.push_back(qvec3{ (float)i, 0.0f, 0.0f });
+		ms = ms + base;
+		REQUIRE(ms.verts.size() == 4);
+		REQUIRE(ms.quadFaces.empty());
+		REQUIRE(ms.currentBorderIndices.size() == 4);
+
+		VertString up = base;
+		for (auto &v : up.verts) v.y = 1.0f;
+		ms = ms + up;
+		REQUIRE(ms.verts.size() == 8);
+		REQUIRE(ms.quadFaces.size() == 3);
+		REQUIRE(ms.quadFaces[0].indices == array<int, 4>{ 0, 1, 5, 4 });
+		REQUIRE(ms.currentBorderIndices == mesh_vector<int>({ 4, 5, 6, 7 }));
+
+		// Closed strings wrap around
+		VertString ring = up;
+		ring.type = VertGroupType::BORDER_EDGE;
+		for (auto &v : ring.verts) v.y = 2.0f;
+		ms = ms + ring;
+		REQUIRE(ms.quadFaces.size() == 7);
+
+		VertString shortString;
+		shortString.verts.push_back(qvec3{ 0.0f, 5.0f, 0.0f });
+		REQUIRE_THROWS_AS(ms + shortString, std::invalid_argument);
+	}
+}
+
+// Ring of grid verts around the cells [lo, hi) x [lo, hi), wound along
+// +X first
+static vector<int> gridRing(int n, int lo, int hi) {
+	vector<int> ring;
+	const int row = n + 1;
+	for (int i = lo; i < hi; i++) ring.push_back(lo * row + i);
+	for (int j = lo; j < hi; j++) ring.push_back(j * row + hi);
+	for (int i = hi; i > lo; i--) ring.push_back(hi * row + i);
+	for (int j = hi; j > lo; j--) ring.push_back(j * row + lo);
+	return ring;
+}
+
+static void requireConsistent(MeshStructure &ms) {
+	for (const auto &qf : ms.quadFaces) {
+		for (int ix : qf.indices) {
+			REQUIRE(ix >= 0);
+			REQUIRE(ix < (int)ms.verts.size());
+		}
+	}
+	for (size_t i = 0; i < ms.verts.size(); i++) {
+		REQUIRE(ms.findVertIndex(ms.verts[i]) == (int)i);
+		REQUIRE(ms.facesOfVert((int)i).size() > 0);
+	}
+}
+
+TEST_CASE("hole cutting with vert string loops", "[holecut_1]") {
+	MeshStructure* grid = buildGridMesh(6, 6, 1.0f);
+	grid->rebuild_vert_index_reverse_map();
+
+	SECTION("small hole, either winding") {
+		vector<int> ring = gridRing(6, 2, 4);
+		REQUIRE(ring.size() == 8);
+		vector<int> reversed(ring.rbegin(), ring.rend());
+		for (const auto &loop : { ring, reversed }) {
+			MeshStructure cut = *grid - loop;
+			REQUIRE(cut.quadFaces.size() == 32);
+			REQUIRE(cut.verts.size() == 48);
+			REQUIRE(cut.holes_and_borders.count("hole_0"));
+			REQUIRE(cut.holes_and_borders["hole_0"].type == VertGroupType::BORDER_EDGE);
+			REQUIRE(cut.holes_and_borders["hole_0"].verts.size() == 8);
+			REQUIRE(cut.currentBorderIndices.size() == 8);
+			for (size_t i = 0; i < loop.size(); i++) {
+				REQUIRE(cut.verts[cut.currentBorderIndices[i]] == grid->verts[loop[i]]);
+			}
+			requireConsistent(cut);
+
+			MeshTopology topo;
+			topo.build(cut);
+			auto loops = topo.boundaryLoops();
+			REQUIRE(loops.size() == 2);
+			REQUIRE(loops[0].size() + loops[1].size() == 24 + 8);
+		}
+	}
+
+	SECTION("the smaller side is cut") {
+		// Inner 4 x 4 block is 16 faces, the outside 20
+		MeshStructure cut = *grid - gridRing(6, 1, 5);
+		REQUIRE(cut.quadFaces.size() == 20);
+		REQUIRE(cut.verts.size() == 49 - 9);
+		requireConsistent(cut);
+	}
+
+	SECTION("vert string loops and repeated cuts") {
+		VertString loop;
+		for (int v : gridRing(6, 1, 3)) loop.verts.push_back(grid->verts[v]);
+		MeshStructure cut = *grid - loop;
+		REQUIRE(cut.quadFaces.size() == 32);
+
+		VertString second;
+		for (int v : gridRing(6, 3, 5)) second.verts.push_back(grid->verts[v]);
+		second.verts.push_back(second.verts.front());
+		cut = cut - second;
+		REQUIRE(cut.quadFaces.size() == 28);
+		REQUIRE(cut.verts.size() == 47);
+		REQUIRE(cut.holes_and_borders.count("hole_0"));
+		REQUIRE(cut.holes_and_borders.count("hole_1"));
+		requireConsistent(cut);
+		// The original is untouched
+		REQUIRE(grid->quadFaces.size() == 36);
+	}
+
+	SECTION("invalid loops") {
+		// Diagonal: verts on the mesh, edges not
+		REQUIRE_THROWS_AS(*grid - vector<int>({ 0, 8, 16, 2 }), std::invalid_argument);
+		REQUIRE_THROWS_AS(*grid - vector<int>({ 0, 1 }), std::invalid_argument);
+		VertString offMesh;
+		offMesh.verts = { { 100.0f, 0.0f, 0.0f }, { 101.0f, 0.0f, 0.0f }, { 101.0f, 0.0f, 1.0f } };
+		REQUIRE_THROWS_AS(*grid - offMesh, std::invalid_argument);
+	}
+	delete grid;
+}
+
+TEST_CASE("phase timing and chrome trace", "[trace_1]") {
+	traceReset();
+	traceEnable(false);
+	{
+		QG_TRACE_SCOPE("disabled");
+		QG_TRACE_COUNTER("disabled.counter", 1);
+	}
+	REQUIRE(traceEventCount() == 0);
+
+	traceEnable(true);
+	{
+		QG_TRACE_SCOPE("outer");
+		for (int i = 0; i < 3; i++) {
+			QG_TRACE_SCOPE_CAT("inner", "test");
+			QG_TRACE_COUNTER("inner.count", i);
+		}
+		parallelFor(8, 4, [](size_t) {
+			QG_TRACE_SCOPE("worker");
+		});
+		MeshStructure* ms = buildGridMesh(4, 4, 1.0f);
+		delete ms;
+	}
+	traceEnable(false);
+	REQUIRE(traceEventCount() == 1 + 3 + 3 + 8 + 1);
+
+	vector<TraceSummaryRow> rows = traceSummary();
+	map<string, TraceSummaryRow> byName;
+	for (const auto &row : rows) byName[row.name] = row;
+	REQUIRE(byName["inner"].count == 3);
+	REQUIRE(byName["worker"].count == 8);
+	REQUIRE(byName["buildGridMesh"].count == 1);
+	REQUIRE(byName["inner.count"].counter);
+	REQUIRE(byName["inner.count"].total_ms == Approx(0 + 1 + 2));
+	REQUIRE(byName["outer"].total_ms >= byName["inner"].total_ms);
+	// Scopes first, largest total first
+	REQUIRE(rows[0].name == "outer");
+
+	std::ostringstream table;
+	tracePrintSummary(table);
+	REQUIRE(table.str().find("worker") != string::npos);
+
+	const string path = "qgen_trace_test.json";
+	REQUIRE(traceWriteChrome(path));
+	std::ifstream in(path);
+	std::stringstream json;
+	json << in.rdbuf();
+	in.close();
+	std::remove(path.c_str());
+	REQUIRE(json.str().find("\"traceEvents\"") != string::npos);
+	REQUIRE(json.str().find("\"name\":\"outer\",\"cat\":\"qgen\"") != string::npos);
+	REQUIRE(json.str().find("\"ph\":\"X\"") != string::npos);
+	REQUIRE(json.str().find("\"ph\":\"C\",\"args\":{\"value\":2.000}") != string::npos);
+
+	REQUIRE(json.str().find("\"dropped_events\":0") != string::npos);
+
+	// Full buffers count what they drop
+	traceReset();
+	size_t cap = traceMaxEventsPerThread();
+	traceSetMaxEventsPerThread(4);
+	traceEnable(true);
+	for (int i = 0; i < 10; i++) {
+		QG_TRACE_SCOPE("capped");
+	}
+	// Caps apply per thread
+	std::thread other([]() {
+		for (int i = 0; i < 6; i++) QG_TRACE_COUNTER("capped.counter", i);
+	});
+	other.join();
+	traceEnable(false);
+	traceSetMaxEventsPerThread(cap);
+	REQUIRE(traceEventCount() == 4 + 4);
+	REQUIRE(traceDroppedCount() == 6 + 2);
+	table.str("");
+	tracePrintSummary(table);
+	REQUIRE(table.str().find("dropped events: 8") != string::npos);
+
+	traceReset();
+	REQUIRE(traceEventCount() == 0);
+	REQUIRE(traceDroppedCount() == 0);
+}
+
+TEST_CASE("batch job manifest", "[batchjobs_1]") {
+	SECTION("manifest parsing") {
+		std::istringstream manifest(
+			"# comment\n"
+			"\n"
+			"a.fbx\n"
+			"  b.fbx meshes=3 format=ascii texture\n"
+			"c.fbx format=binary animate embed=0\n");
+		vector<GenJobSpec> jobs = ParseJobManifest(manifest);
+		REQUIRE(jobs.size() == 3);
+		REQUIRE(jobs[0].output == "a.fbx");
+		REQUIRE(jobs[0].meshes == 1);
+		REQUIRE(jobs[0].format.empty());
+		REQUIRE(jobs[0].embed);
+		REQUIRE(jobs[1].meshes == 3);
+		REQUIRE(jobs[1].format == "ascii");
+		REQUIRE(jobs[1].texture);
+		REQUIRE(jobs[1].line == 4);
+		REQUIRE(jobs[2].animate);
+		REQUIRE(!jobs[2].embed);
+
+		std::istringstream bad("ok.fbx\nx.fbx meshes=lots\n");
+		REQUIRE_THROWS_WITH(ParseJobManifest(bad), Catch::Contains("line 2"));
+		std::istringstream unknown("x.fbx colour=red\n");
+		REQUIRE_THROWS_AS(ParseJobManifest(unknown), std::runtime_error);
+	}
+
+	SECTION("jobs share one manager, scenes are reset") {
+		std::istringstream manifest(
+			"qgen_batch_0.fbx meshes=2\n"
+			"qgen_batch_1.fbx meshes=4 format=binary\n"
+			"qgen_batch_2.fbx meshes=1 format=99999999999\n");
+		vector<GenJobSpec> jobs = ParseJobManifest(manifest);
+		std::ostringstream log;
+		vector<GenJobResult> results = RunJobBatch(jobs, &log);
+		FbxManager* lManager = gSdkManager;
+		REQUIRE(lManager != NULL);
+		REQUIRE(results.size() == 3);
+		REQUIRE(results[0].ok);
+		REQUIRE(results[1].ok);
+		// A bad job fails alone
+		REQUIRE(!results[2].ok);
+		REQUIRE(!results[2].error.empty());
+		REQUIRE(log.str().find("FAIL qgen_batch_2.fbx") != string::npos);
+
+		// One more job on the same manager: marker, camera, and only the
+		// meshes of this job, numbered from 1 again
+		std::istringstream again("qgen_batch_3.fbx meshes=3\n");
+		results = RunJobBatch(ParseJobManifest(again), NULL);
+		REQUIRE(gSdkManager == lManager);
+		REQUIRE(results[0].ok);
+		const FbxNode* lRoot = GetRootNode();
+		REQUIRE(lRoot->GetChildCount() == 2 + 3);
+		REQUIRE(string(lRoot->GetChild(2)->GetName()) == "GenMesh_1");
+
+		std::ostringstream summary;
+		PrintJobBatchSummary(results, 10.0, summary);
+		REQUIRE(summary.str().find("Jobs: 1, failed: 0") != string::npos);
+		for (int i = 0; i < 4; i++) std::remove(("qgen_batch_" + to_string(i) + ".fbx").c_str());
+
+		DestroySdkObjects(gSdkManager, false);
+		REQUIRE(gSdkManager == NULL);
+		ResetGenMeshState();
+	}
+}
+
+TEST_CASE("pipelined batch export", "[pipeline_1]") {
+	SECTION("bounded queue backpressure") {
+		BoundedQueue<int> queue(2, 100);
+		REQUIRE(queue.push(1, 10));
+		REQUIRE(queue.push(2, 10));
+		std::atomic<bool> pushed(false);
+		std::thread producer([&]() {
+			queue.push(3, 10);
+			pushed = true;
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		// Full on items
+		REQUIRE(!pushed);
+		int v = 0;
+		REQUIRE(queue.pop(v));
+		REQUIRE(v == 1);
+		producer.join();
+		REQUIRE(pushed);
+		REQUIRE(queue.size() == 2);
+		REQUIRE(queue.cost() == 20);
+
+		// Full on cost
+		REQUIRE(queue.pop(v));
+		pushed = false;
+		producer = std::thread([&]() {
+			queue.push(4, 95);
+			pushed = true;
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		REQUIRE(!pushed);
+		REQUIRE(queue.pop(v));
+		REQUIRE(v == 3);
+		producer.join();
+		REQUIRE(pushed);
+
+		// An empty queue takes an oversized item
+		REQUIRE(queue.pop(v));
+		REQUIRE(queue.push(5, 1000));
+
+		// Close drains, then stops both ends
+		queue.close();
+		REQUIRE(!queue.push(6));
+		REQUIRE(queue.pop(v));
+		REQUIRE(v == 5);
+		REQUIRE(!queue.pop(v));
+	}
+
+	SECTION("same scenes as the sequential batch") {
+		const char* manifestText =
+			"qgen_pipe_%d_0.fbx meshes=2\n"
+			"qgen_pipe_%d_1.fbx meshes=5 format=binary\n"
+			"qgen_pipe_%d_2.fbx meshes=1 format=99999999999\n"
+			"qgen_pipe_%d_3.fbx meshes=3\n";
+		auto manifestFor = [&](int run) {
+			char text[512];
+			snprintf(text, sizeof(text), manifestText, run, run, run, run);
+			std::istringstream in(text);
+			return ParseJobManifest(in);
+		};
+		auto sceneNames = []() {
+			vector<string> names;
+			const FbxNode* lRoot = GetRootNode();
+			for (int i = 0; i < lRoot->GetChildCount(); i++) names.push_back(lRoot->GetChild(i)->GetName());
+			return names;
+		};
+
+		vector<GenJobResult> sequential = RunJobBatch(manifestFor(0), NULL);
+		vector<string> sequentialNames = sceneNames();
+		FbxManager* lManager = gSdkManager;
+
+		GenPipelineOptions options;
+		options.threads = 4;
+		std::ostringstream log;
+		vector<GenJobResult> pipelined = RunJobBatchPipelined(manifestFor(1), &log, options);
+		REQUIRE(gSdkManager == lManager);
+		REQUIRE(pipelined.size() == sequential.size());
+		for (size_t i = 0; i < pipelined.size(); i++) {
+			REQUIRE(pipelined[i].ok == sequential[i].ok);
+			REQUIRE(pipelined[i].output == "qgen_pipe_1_" + to_string(i) + ".fbx");
+		}
+		REQUIRE(!pipelined[2].ok);
+		REQUIRE(log.str().find("FAIL qgen_pipe_1_2.fbx") != string::npos);
+		REQUIRE(sceneNames() == sequentialNames);
+		REQUIRE(sequentialNames.size() == 2 + 3);
+
+		// One job in flight at a time, byte bound below any mesh
+		options.queueDepth = 1;
+		options.maxQueuedBytes = 1;
+		pipelined = RunJobBatchPipelined(manifestFor(2), NULL, options);
+		REQUIRE(pipelined.size() == 4);
+		REQUIRE(pipelined[3].ok);
+		REQUIRE(sceneNames() == sequentialNames);
+
+		// A failed build fails its job only
+		options.builder = [](const GenMeshJob& job) -> MeshStructure* {
+			if (job.name == "GenMesh_3") throw std::runtime_error("no third mesh");
+			return buildGridMesh(2, 2, 1.0f);
+		};
+		pipelined = RunJobBatchPipelined(manifestFor(3), NULL, options);
+		REQUIRE(pipelined[0].ok);
+		REQUIRE(!pipelined[1].ok);
+		REQUIRE(pipelined[1].error == "no third mesh");
+		REQUIRE(!pipelined[3].ok);
+
+		// So does a builder returning no mesh
+		options.builder = [](const GenMeshJob& job) -> MeshStructure* {
+			return job.name == "GenMesh_3" ? NULL : buildGridMesh(2, 2, 1.0f);
+		};
+		pipelined = RunJobBatchPipelined(manifestFor(3), NULL, options);
+		REQUIRE(pipelined[0].ok);
+		REQUIRE(!pipelined[1].ok);
+		REQUIRE(pipelined[1].error == "builder returned no mesh");
+		REQUIRE(!pipelined[3].ok);
+
+		for (int run = 0; run < 4; run++) {
+			for (int i = 0; i < 4; i++) std::remove(("qgen_pipe_" + to_string(run) + "_" + to_string(i) + ".fbx").c_str());
+		}
+		DestroySdkObjects(gSdkManager, false);
+		ResetGenMeshState();
+	}
+}
+
+TEST_CASE("SDK free binary FBX writer", "[fbxwriter_1]") {
+	MeshStructure* grid = buildGridMesh(12, 7, 2.0f);
+	for (size_t f = 0; f < grid->quadFaces.size(); f++) {
+		for (int c = 0; c < 4; c++) grid->quadFaces[f].uvs[c] = { (float)f, (float)c * 0.25f };
+	}
+	vector<FbxWriterMesh> meshes(2);
+	meshes[0].mesh = grid;
+	meshes[0].name = "GridA";
+	meshes[1].mesh = grid;
+	meshes[1].name = "GridB";
+	meshes[1].translation = { 10.0f, -2.0f, 3.5f };
+	meshes[1].scaling = { 0.3f, 0.3f, 0.3f };
+
+	// Compressed arrays, then raw arrays only
+	FbxBinaryWriterOptions raw;
+	raw.compress = false;
+	const FbxBinaryWriterOptions* variants[] = { NULL, &raw };
+	for (const FbxBinaryWriterOptions* options : variants) {
+		const string path = "qgen_writer_test.fbx";
+		REQUIRE(writeFbxBinary(path, meshes, options ? *options : FbxBinaryWriterOptions()));
+
+		std::ifstream in(path, std::ios::binary);
+		char header[27];
+		in.read(header, sizeof(header));
+		REQUIRE(string(header, 18) == "Kaydara FBX Binary");
+		uint32_t version;
+		memcpy(&version, header + 23, 4);
+		REQUIRE(version == 7400);
+		in.close();
+
+		// Structure check without the SDK: walk every node record, every
+		// end offset must land exactly past the node's properties and
+		// children, every property list must hold the count it declares
+		std::ifstream whole(path, std::ios::binary);
+		const string file((std::istreambuf_iterator<char>(whole)), std::istreambuf_iterator<char>());
+		whole.close();
+		auto u32 = [&](size_t at) {
+			uint32_t v;
+			REQUIRE(at + 4 <= file.size());
+			memcpy(&v, file.data() + at, 4);
+			return v;
+		};
+		struct Record {
+			string name;
+			size_t props;
+			vector<Record> children;
+		};
+		std::function<void(size_t&, vector<Record>&)> readNodes = [&](size_t& pos, vector<Record>& out) {
+			for (;;) {
+				const size_t end = u32(pos);
+				const uint32_t numProps = u32(pos + 4);
+				const size_t propsLength = u32(pos + 8);
+				const size_t nameLength = (uint8_t)file.at(pos + 12);
+				if (end == 0) {
+					// Null record closing the list
+					REQUIRE((numProps == 0 && propsLength == 0 && nameLength == 0));
+					pos += 13;
+					return;
+				}
+				REQUIRE(end <= file.size());
+				Record r;
+				r.name = file.substr(pos + 13, nameLength);
+				r.props = pos + 13 + nameLength;
+				// Property types: scalars, strings / raw, arrays
+				size_t p = r.props;
+				for (uint32_t k = 0; k < numProps; k++) {
+					const char type = file.at(p++);
+					switch (type) {
+					case 'C': p += 1; break;
+					case 'Y': p += 2; break;
+					case 'I': case 'F': p += 4; break;
+					case 'L': case 'D': p += 8; break;
+					case 'S': case 'R': p += 4 + u32(p); break;
+					case 'i': case 'f': case 'l': case 'd': case 'b': p += 12 + u32(p + 8); break;
+					default: FAIL("unknown property type " << type);
+					}
+				}
+				REQUIRE(p == r.props + propsLength);
+				pos = p;
+				if (pos < end) readNodes(pos, r.children);
+				REQUIRE(pos == end);
+				out.push_back(std::move(r));
+			}
+		};
+		vector<Record> top;
+		size_t pos = 27;
+		readNodes(pos, top);
+		REQUIRE(file.compare(pos, 16, "\xfa\xbc\xab\x09\xd0\xc8\xd4\x66\xb1\x76\xfb\x83\x1c\xf7\x26\x7e") == 0);
+		auto child = [](const vector<Record>& nodes, const string& name) -> const Record& {
+			for (const auto& r : nodes) {
+				if (r.name == name) return r;
+			}
+			FAIL("no " << name << " node");
+			return nodes.front();
+		};
+		// Array property: count, encoding (1 = deflate), byte length, data
+		auto readArray = [&](const Record& r, char type, size_t elementSize) {
+			REQUIRE(file.at(r.props) == type);
+			const size_t count = u32(r.props + 1);
+			const uint32_t encoding = u32(r.props + 5);
+			const size_t bytes = u32(r.props + 9);
+			const char* data = file.data() + r.props + 13;
+			string out(count * elementSize, '\0');
+			if (encoding == 1) {
+				uLongf length = (uLongf)out.size();
+				REQUIRE(uncompress((Bytef*)&out[0], &length, (const Bytef*)data, (uLong)bytes) == Z_OK);
+				REQUIRE(length == out.size());
+			}
+			else {
+				REQUIRE(encoding == 0);
+				REQUIRE(bytes == out.size());
+				out.assign(data, bytes);
+			}
+			return out;
+		};
+		const Record& geometry = child(child(top, "Objects").children, "Geometry");
+		const string points = readArray(child(geometry.children, "Vertices"), 'd', sizeof(double));
+		const string corners = readArray(child(geometry.children, "PolygonVertexIndex"), 'i', sizeof(int32_t));
+		REQUIRE(points.size() == grid->verts.size() * 3 * sizeof(double));
+		REQUIRE(corners.size() == grid->quadFaces.size() * 4 * sizeof(int32_t));
+		for (size_t v = 0; v < grid->verts.size(); v++) {
+			double xyz[3];
+			memcpy(xyz, points.data() + v * sizeof(xyz), sizeof(xyz));
+			REQUIRE(xyz[0] == grid->verts[v].x);
+			REQUIRE(xyz[1] == grid->verts[v].y);
+			REQUIRE(xyz[2] == grid->verts[v].z);
+		}
+		for (size_t f = 0; f < grid->quadFaces.size(); f++) {
+			int32_t ix[4];
+			memcpy(ix, corners.data() + f * sizeof(ix), sizeof(ix));
+			REQUIRE(ix[0] == grid->quadFaces[f].indices[0]);
+			REQUIRE(ix[2] == grid->quadFaces[f].indices[2]);
+			REQUIRE(ix[3] == ~grid->quadFaces[f].indices[3]);
+		}
+
+		// Re-import through the SDK: the full validity check, only proven
+		// when built against the real FBX SDK
+		FbxManager* lManager = NULL;
+		FbxScene* lScene = NULL;
+		InitializeSdkObjects(lManager, lScene);
+		FbxImporter* lImporter = FbxImporter::Create(lManager, "");
+		REQUIRE(lImporter->Initialize(path.c_str(), -1, lManager->GetIOSettings()));
+		REQUIRE(lImporter->Import(lScene));
+		lImporter->Destroy();
+
+		FbxNode* lRoot = lScene->GetRootNode();
+		REQUIRE(lRoot->GetChildCount() == 2);
+		FbxNode* a = lRoot->GetChild(0);
+		FbxNode* b = lRoot->GetChild(1);
+		REQUIRE(string(a->GetName()) == "GridA");
+		REQUIRE(string(b->GetName()) == "GridB");
+		REQUIRE(b->LclTranslation.Get()[0] == Approx(10.0));
+		REQUIRE(b->LclTranslation.Get()[2] == Approx(3.5));
+		REQUIRE(b->LclScaling.Get()[1] == Approx(0.3));
+
+		FbxMesh* lMesh = a->GetMesh();
+		REQUIRE(lMesh != NULL);
+		REQUIRE(lMesh->GetControlPointsCount() == (int)grid->verts.size());
+		REQUIRE(lMesh->GetPolygonCount() == (int)grid->quadFaces.size());
+		FbxVector4* lPoints = lMesh->GetControlPoints();
+		for (size_t v = 0; v < grid->verts.size(); v++) {
+			REQUIRE(lPoints[v][0] == grid->verts[v].x);
+			REQUIRE(lPoints[v][2] == grid->verts[v].z);
+		}
+		FbxGeometryElementNormal* lNormals = lMesh->GetElementNormal(0);
+		FbxGeometryElementUV* lUVs = lMesh->GetElementUV(0);
+		REQUIRE(lNormals->GetMappingMode() == FbxGeometryElement::eByPolygonVertex);
+		REQUIRE(lUVs->GetReferenceMode() == FbxGeometryElement::eIndexToDirect);
+		REQUIRE(string(lUVs->GetName()) == "DiffuseUV");
+		for (int f = 0; f < lMesh->GetPolygonCount(); f++) {
+			const QuadFace& qf = grid->quadFaces[f];
+			REQUIRE(lMesh->GetPolygonSize(f) == 4);
+			for (int c = 0; c < 4; c++) {
+				const int k = f * 4 + c;
+				REQUIRE(lMesh->GetPolygonVertex(f, c) == qf.indices[c]);
+				REQUIRE(lNormals->GetDirectArray().GetAt(k)[1] == qf.normals[c].y);
+				FbxVector2 uv = lUVs->GetDirectArray().GetAt(lUVs->GetIndexArray().GetAt(k));
+				REQUIRE(uv[0] == qf.uvs[c].x);
+				REQUIRE(uv[1] == qf.uvs[c].y);
+			}
+		}
+		DestroySdkObjects(lManager, false);
+		std::remove(path.c_str());
+	}
+
+	// Unwritable path
+	REQUIRE(!writeFbxBinary("qgen_no_such_dir/out.fbx", meshes));
+	delete grid;
+}
+
+TEST_CASE("GLB writer", "[glb_1]") {
+	// Shared corners: written from verts as is
+	MeshStructure* grid = buildGridMesh(5, 4, 1.5f);
+	// Per face UVs: one vertex per quad corner
+	MeshStructure* tiles = buildGridMesh(3, 2, 1.0f);
+	for (auto& qf : tiles->quadFaces) {
+		qf.uvs = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f };
+	}
+	MeshStructure empty;
+	vector<GlbWriterMesh> meshes(3);
+	meshes[0].mesh = grid;
+	meshes[0].name = "Grid";
+	meshes[1].mesh = tiles;
+	meshes[1].name = "Tiles \"quoted\"";
+	meshes[1].translation = { 0.0f, 5.0f, 0.0f };
+	meshes[1].rotation = { 0.0f, 90.0f, 0.0f };
+	meshes[2].mesh = &empty;
+	meshes[2].name = "Empty";
+
+	const string path = "qgen_glb_test.glb";
+	REQUIRE(writeGlb(path, meshes));
+	std::ifstream in(path, std::ios::binary);
+	string file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	std::remove(path.c_str());
+
+	auto u32 = [&](size_t offset) {
+		uint32_t v;
+		memcpy(&v, &file[offset], 4);
+		return v;
+	};
+	REQUIRE(file.size() % 4 == 0);
+	REQUIRE(file.substr(0, 4) == "glTF");
+	REQUIRE(u32(4) == 2);
+	REQUIRE(u32(8) == file.size());
+	const uint32_t jsonLength = u32(12);
+	REQUIRE(jsonLength % 4 == 0);
+	REQUIRE(file.substr(16, 4) == "JSON");
+	const string json = file.substr(20, jsonLength);
+	const size_t binChunk = 20 + jsonLength;
+	const uint32_t binLength = u32(binChunk);
+	REQUIRE(file.substr(binChunk + 4, 4) == string("BIN\0", 4));
+	REQUIRE(binChunk + 8 + binLength == file.size());
+	const char* bin = &file[binChunk + 8];
+
+	REQUIRE(json.find("\"version\":\"2.0\"") != string::npos);
+	REQUIRE(json.find("\"name\":\"Tiles \\\"quoted\\\"\"") != string::npos);
+	REQUIRE(json.find("\"buffers\":[{\"byteLength\":" + to_string(binLength) + "}]") != string::npos);
+	// Grid: 30 shared verts, 20 quads as 120 uint16 indices
+	REQUIRE(json.find("\"count\":30,\"type\":\"VEC3\",\"min\":[0,0,0],\"max\":[7.5,0,6]") != string::npos);
+	REQUIRE(json.find("\"componentType\":5123,\"count\":120,\"type\":\"SCALAR\"") != string::npos);
+	// Tiles: 6 quads split into 24 vertices
+	REQUIRE(json.find("\"count\":24,\"type\":\"VEC3\"") != string::npos);
+	REQUIRE(json.find("\"rotation\":[0,0.707106781,0,0.707106781]") != string::npos);
+	// The empty mesh is a node only
+	REQUIRE(json.find("{\"name\":\"Empty\",\"translation\"") != string::npos);
+
+	// Grid BIN: positions, normals, UVs, indices
+	REQUIRE(memcmp(bin, grid->verts.data(), 30 * 12) == 0);
+	float normal[3];
+	memcpy(normal, bin + 30 * 12, 12);
+	REQUIRE(normal[1] == 1.0f);
+	const size_t uvOffset = 30 * 24;
+	const size_t indexOffset = uvOffset + 30 * 8;
+	for (size_t f = 0; f < grid->quadFaces.size(); f++) {
+		const QuadFace& qf = grid->quadFaces[f];
+		uint16_t tri[6];
+		memcpy(tri, bin + indexOffset + f * 12, 12);
+		REQUIRE(tri[0] == qf.indices[0]);
+		REQUIRE(tri[1] == qf.indices[1]);
+		REQUIRE(tri[2] == qf.indices[2]);
+		REQUIRE(tri[3] == qf.indices[0]);
+		REQUIRE(tri[5] == qf.indices[3]);
+		float uv[2];
+		memcpy(uv, bin + uvOffset + qf.indices[2] * 8, 8);
+		REQUIRE(uv[0] == qf.uvs[2].x);
+		REQUIRE(uv[1] == 1.0f - qf.uvs[2].y);
+	}
+
+	// Wide indices past 65535 vertices
+	MeshStructure* big = buildGridMesh(300, 300, 1.0f);
+	vector<GlbWriterMesh> bigMeshes(1);
+	bigMeshes[0].mesh = big;
+	bigMeshes[0].name = "Big";
+	REQUIRE(writeGlb(path, bigMeshes));
+	in.open(path, std::ios::binary);
+	file.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	std::remove(path.c_str());
+	REQUIRE(file.find("\"componentType\":5125") != string::npos);
+	REQUIRE(u32(8) == file.size());
+
+	REQUIRE(!writeGlb("qgen_no_such_dir/out.glb", meshes));
+	delete grid;
+	delete tiles;
+	delete big;
+}
+
+TEST_CASE("qgm mesh cache format", "[qgm_1]") {
+	MeshStructure* grid = buildGridMesh(16, 16, 1.0f);
+	// A hole gives a BORDER_EDGE string and currentBorderIndices
+	grid->cutHole(gridRing(16, 5, 10), "window");
+	VertString seam;
+	seam.verts = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+	seam.uv_scale = { 0.5f, 2.0f };
+	seam.has_uv_scale = true;
+	grid->holes_and_borders["seam"] = seam;
+	REQUIRE(!grid->currentBorderIndices.empty());
+
+	const string path = "qgen_qgm_test.qgm";
+	REQUIRE(writeQgm(path, *grid));
+
+	QgmMapping mapping;
+	string error;
+	REQUIRE(mapping.open(path, &error));
+	REQUIRE(mapping.header().version == QGM_VERSION);
+	REQUIRE(mapping.header().content_hash == meshContentHash(*grid));
+	// In place: same bytes, section aligned
+	REQUIRE(mapping.vertCount() == grid->verts.size());
+	REQUIRE(memcmp(mapping.verts(), grid->verts.data(), grid->verts.size() * sizeof(qvec3)) == 0);
+	REQUIRE((uintptr_t)mapping.verts() % QGM_SECTION_ALIGN == 0);
+	REQUIRE(mapping.faceCount() == grid->quadFaces.size());
+	REQUIRE((uintptr_t)mapping.faces() % QGM_SECTION_ALIGN == 0);
+	for (size_t f = 0; f < grid->quadFaces.size(); f++) {
+		REQUIRE(mapping.faces()[f].indices == grid->quadFaces[f].indices);
+		REQUIRE(mapping.faces()[f].uvs[2] == grid->quadFaces[f].uvs[2]);
+	}
+	REQUIRE(mapping.borderIndexCount() == grid->currentBorderIndices.size());
+
+	MeshStructure loaded;
+	mapping.load(loaded);
+	REQUIRE(meshContentEqual(loaded, *grid));
+	REQUIRE(loaded.currentBorderIndices == grid->currentBorderIndices);
+	REQUIRE(loaded.holes_and_borders.size() == 2);
+	REQUIRE(loaded.holes_and_borders["window"].type == VertGroupType::BORDER_EDGE);
+	REQUIRE(loaded.holes_and_borders["window"].verts == grid->holes_and_borders["window"].verts);
+	REQUIRE(loaded.holes_and_borders["seam"].uv_scale == seam.uv_scale);
+	REQUIRE(loaded.holes_and_borders["seam"].has_uv_scale);
+	// The loaded mesh is fully usable
+	loaded.rebuild_vert_index_reverse_map();
+	REQUIRE(loaded.findVertIndex(grid->verts[5]) == 5);
+	mapping.close();
+	REQUIRE(!mapping.isOpen());
+
+	// Loading into a used mesh with the same vert count: its welding index
+	// follows the new verts, nothing welds onto the old positions
+	{
+		unique_ptr<MeshStructure> used(buildGridMesh(2, 2, 1.0f));
+		used->rebuild_vert_index_reverse_map();
+		MeshStructure shifted = *used;
+		for (auto& v : shifted.verts) v.x += 100.0f;
+		const string moved = "qgen_qgm_test_moved.qgm";
+		REQUIRE(writeQgm(moved, shifted));
+		REQUIRE(mapping.open(moved, &error));
+		mapping.load(*used);
+		mapping.close();
+		std::remove(moved.c_str());
+		REQUIRE(used->findVertIndex({ 100.0f, 0.0f, 0.0f }) >= 0);
+		REQUIRE(used->findVertIndex({ 0.0f, 0.0f, 0.0f }) == -1);
+		const size_t before = used->verts.size();
+		QuadFaceDTO face = {};
+		face.verts[0] = { 0.0f, 0.0f, 0.0f };
+		face.verts[1] = { 0.0f, 0.0f, 1.0f };
+		face.verts[2] = { 1.0f, 0.0f, 1.0f };
+		face.verts[3] = { 1.0f, 0.0f, 0.0f };
+		used->addFace(face);
+		REQUIRE(used->verts.size() == before + 4);
+		for (int ix : used->quadFaces.back().indices) REQUIRE(used->verts[ix].x < 2.0f);
+	}
+
+	// Identical meshes give identical files
+	const string again = "qgen_qgm_test_2.qgm";
+	REQUIRE(writeQgm(again, loaded));
+	std::ifstream a(path, std::ios::binary), b(again, std::ios::binary);
+	string bytesA((std::istreambuf_iterator<char>(a)), std::istreambuf_iterator<char>());
+	string bytesB((std::istreambuf_iterator<char>(b)), std::istreambuf_iterator<char>());
+	a.close();
+	b.close();
+	REQUIRE(bytesA == bytesB);
+
+	// Damaged files are refused with a reason
+	{
+		std::ofstream truncated(again, std::ios::binary);
+		truncated.write(bytesA.data(), bytesA.size() / 2);
+	}
+	REQUIRE(!mapping.open(again, &error));
+	REQUIRE(error.find("truncated") != string::npos);
+	{
+		string wrongVersion = bytesA;
+		wrongVersion[4] = 99;
+		std::ofstream out(again, std::ios::binary);
+		out.write(wrongVersion.data(), wrongVersion.size());
+	}
+	REQUIRE(!mapping.open(again, &error));
+	REQUIRE(error.find("version") != string::npos);
+	// A consistent section with the wrong element size for its type
+	{
+		string wrongElement = bytesA;
+		QgmHeader h;
+		memcpy(&h, wrongElement.data(), sizeof(h));
+		for (uint32_t i = 0; i < h.section_count; i++) {
+			QgmSection sec;
+			char* entry = &wrongElement[sizeof(QgmHeader) + i * sizeof(QgmSection)];
+			memcpy(&sec, entry, sizeof(sec));
+			if (sec.type != QGM_VERTS) continue;
+			sec.element_size = sizeof(float);
+			sec.count *= 3;
+			memcpy(entry, &sec, sizeof(sec));
+		}
+		std::ofstream out(again, std::ios::binary);
+		out.write(wrongElement.data(), wrongElement.size());
+	}
+	REQUIRE(!mapping.open(again, &error));
+	REQUIRE(error.find("element size 4, expected 12") != string::npos);
+	REQUIRE(!mapping.isOpen());
+	REQUIRE(!mapping.open("qgen_no_such_file.qgm", &error));
+
+	// Empty mesh round trip
+	MeshStructure empty;
+	REQUIRE(writeQgm(again, empty));
+	REQUIRE(mapping.open(again, &error));
+	REQUIRE(mapping.vertCount() == 0);
+	mapping.load(loaded);
+	REQUIRE(loaded.verts.empty());
+	mapping.close();
+
+	std::remove(path.c_str());
+	std::remove(again.c_str());
+	delete grid;
+}
+
+static string readWholeFile(const string& path) {
+	std::ifstream in(path, std::ios::binary);
+	return string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+TEST_CASE("content addressed result cache", "[resultcache_1]") {
+	const string dir = "qgen_result_cache_test/store";
+
+	SECTION("keys") {
+		CacheKey a("job");
+		a.add("name", "x;b=1");
+		CacheKey b("job");
+		b.add("name", "x").add("b", 1);
+		REQUIRE(a.text() != b.text());
+		REQUIRE(a.hex() != b.hex());
+		REQUIRE(a.hex().size() == 16);
+
+		GenMeshJob job = { "GenMesh_1", 0.1, 20.0, 0.0, 1 };
+		REQUIRE(GenMeshJobKey(job, "grid").hex() == GenMeshJobKey(job, "grid").hex());
+		REQUIRE(GenMeshJobKey(job, "grid").hex() != GenMeshJobKey(job, "cube").hex());
+		GenMeshJob moved = job;
+		moved.x = 0.1 + 1e-15;
+		REQUIRE(GenMeshJobKey(job, "grid").text() != GenMeshJobKey(moved, "grid").text());
+
+		SpreaderInput p = { 10, 10.0f, 0, 0, 2.0f, 1 };
+		SpreaderInput q = p;
+		q.direction = -1;
+		REQUIRE(CacheKey("spread").add("p", p).hex() != CacheKey("spread").add("p", q).hex());
+
+		GenJobSpec spec;
+		spec.output = "a.fbx";
+		GenJobSpec renamed = spec;
+		renamed.output = "other/b.FBX";
+		REQUIRE(GenJobKey(spec, "cube").text() == GenJobKey(renamed, "cube").text());
+		renamed.texture = true;
+		REQUIRE(GenJobKey(spec, "cube").text() != GenJobKey(renamed, "cube").text());
+	}
+
+	SECTION("store, fetch, LRU eviction, persistence") {
+		auto writeSource = [](const string& path, char fill) {
+			std::ofstream out(path, std::ios::binary);
+			out << string(1000, fill);
+		};
+		vector<CacheKey> keys;
+		for (int i = 0; i < 5; i++) {
+			keys.push_back(CacheKey("file").add("i", i));
+			writeSource("qgen_rc_src_" + to_string(i), (char)('a' + i));
+		}
+		auto src = [](int i) { return "qgen_rc_src_" + to_string(i); };
+		{
+			ResultCache cache(dir, 3500);
+			REQUIRE(cache.open());
+			cache.clear();
+			REQUIRE(!cache.fetchFile(keys[0], "qgen_rc_out"));
+			for (int i = 0; i < 3; i++) REQUIRE(cache.storeFile(keys[i], src(i)));
+			REQUIRE(cache.fetchFile(keys[0], "qgen_rc_out"));
+			REQUIRE(readWholeFile("qgen_rc_out") == string(1000, 'a'));
+
+			// 0 was used last, 1 is the oldest
+			REQUIRE(cache.storeFile(keys[3], src(3)));
+			REQUIRE(cache.contains(keys[0]));
+			REQUIRE(!cache.contains(keys[1]));
+			REQUIRE(cache.contains(keys[2]));
+			ResultCacheStats stats = cache.stats();
+			REQUIRE(stats.hits == 1);
+			REQUIRE(stats.misses == 1);
+			REQUIRE(stats.stores == 4);
+			REQUIRE(stats.evictions == 1);
+			REQUIRE(stats.entries == 3);
+			REQUIRE(stats.bytes == 3000);
+
+			// Bigger than the whole budget
+			std::ofstream(src(4), std::ios::binary) << string(4000, 'e');
+			REQUIRE(!cache.storeFile(keys[4], src(4)));
+			REQUIRE(cache.stats().entries == 3);
+			std::ostringstream line;
+			PrintResultCacheStats(cache.stats(), line);
+			REQUIRE(line.str().find("hit rate: 50.0%") != string::npos);
+		}
+		{
+			// Recency survives a restart: 2 is now the oldest
+			ResultCache cache(dir, 3500);
+			REQUIRE(cache.open());
+			REQUIRE(cache.stats().entries == 3);
+			REQUIRE(cache.stats().bytes == 3000);
+			writeSource(src(4), 'e');
+			REQUIRE(cache.storeFile(keys[4], src(4)));
+			REQUIRE(!cache.contains(keys[2]));
+			REQUIRE(cache.contains(keys[0]));
+		}
+		{
+			// A lost entry file is dropped, a smaller budget evicts on open
+			std::remove((dir + "/" + keys[4].hex()).c_str());
+			ResultCache cache(dir, 1500);
+			REQUIRE(cache.open());
+			REQUIRE(cache.stats().entries == 1);
+			REQUIRE(cache.contains(keys[3]));
+			REQUIRE(!cache.contains(keys[4]));
+			REQUIRE(!cache.fetchFile(keys[4], "qgen_rc_out"));
+		}
+		{
+			// Meshes round trip through .qgm
+			ResultCache cache(dir, 0);
+			REQUIRE(cache.open());
+			MeshStructure* grid = buildGridMesh(8, 8, 1.0f);
+			CacheKey meshKey = CacheKey("mesh").add("grid", 8);
+			cache.clear();
+			REQUIRE(cache.storeMesh(meshKey, *grid));
+			MeshStructure loaded;
+			REQUIRE(cache.fetchMesh(meshKey, loaded));
+			REQUIRE(meshContentEqual(loaded, *grid));
+			REQUIRE(!cache.fetchMesh(keys[3], loaded));
+			delete grid;
+			cache.clear();
+		}
+		for (int i = 0; i < 5; i++) std::remove(src(i).c_str());
+		std::remove("qgen_rc_out");
+	}
+
+	SECTION("batch jobs skip generation on a hit") {
+		ResultCache cache(dir, 0);
+		REQUIRE(cache.open());
+		cache.clear();
+		std::istringstream manifest(
+			"qgen_rc_job_0.fbx meshes=2\n"
+			"qgen_rc_job_1.fbx meshes=3 texture\n");
+		vector<GenJobSpec> jobs = ParseJobManifest(manifest);
+		vector<GenJobResult> results = RunJobBatch(jobs, NULL, &cache);
+		REQUIRE(results[0].ok);
+		REQUIRE(!results[0].cached);
+		REQUIRE(cache.stats().stores == 2);
+		string exported = readWholeFile("qgen_rc_job_1.fbx");
+		std::remove("qgen_rc_job_1.fbx");
+
+		std::ostringstream log;
+		results = RunJobBatch(jobs, &log, &cache);
+		REQUIRE(results[0].cached);
+		REQUIRE(results[1].cached);
+		REQUIRE(readWholeFile("qgen_rc_job_1.fbx") == exported);
+		REQUIRE(log.str().find("(cached)") != string::npos);
+		std::ostringstream summary;
+		PrintJobBatchSummary(results, 1.0, summary);
+		REQUIRE(summary.str().find("cached: 2") != string::npos);
+
+		// Pipelined: default builder shares the job entries
+		GenPipelineOptions options;
+		options.cache = &cache;
+		results = RunJobBatchPipelined(jobs, NULL, options);
+		REQUIRE(results[0].cached);
+		REQUIRE(results[1].cached);
+
+		// A named builder also caches its meshes
+		std::atomic<int> builds(0);
+		options.builder = [&](const GenMeshJob&) {
+			++builds;
+			return buildGridMesh(3, 3, 1.0f);
+		};
+		options.builderKey = "grid3";
+		std::istringstream first("qgen_rc_grid_0.fbx meshes=2\n");
+		results = RunJobBatchPipelined(ParseJobManifest(first), NULL, options);
+		REQUIRE(results[0].ok);
+		REQUIRE(builds == 2);
+		std::istringstream second("qgen_rc_grid_1.fbx meshes=3\n");
+		results = RunJobBatchPipelined(ParseJobManifest(second), NULL, options);
+		REQUIRE(results[0].ok);
+		REQUIRE(!results[0].cached);
+		REQUIRE(builds == 3);
+
+		// Unnamed builders are never cached
+		options.builderKey.clear();
+		size_t stores = cache.stats().stores;
+		std::istringstream third("qgen_rc_grid_2.fbx\n");
+		results = RunJobBatchPipelined(ParseJobManifest(third), NULL, options);
+		REQUIRE(cache.stats().stores == stores);
+
+		// A builder returning no mesh stores nothing
+		GenMeshBuilder none = CachedGenMeshBuilder([](const GenMeshJob&) -> MeshStructure* { return NULL; }, "none", cache);
+		REQUIRE(none(NextGenMeshJob()) == NULL);
+		REQUIRE(cache.stats().stores == stores);
+
+		for (int i = 0; i < 2; i++) std::remove(("qgen_rc_job_" + to_string(i) + ".fbx").c_str());
+		for (int i = 0; i < 3; i++) std::remove(("qgen_rc_grid_" + to_string(i) + ".fbx").c_str());
+		cache.clear();
+		DestroySdkObjects(gSdkManager, false);
+		ResetGenMeshState();
+	}
+	std::remove((dir + "/index").c_str());
+	std::remove(dir.c_str());
+	std::remove("qgen_result_cache_test");
+}
+
+TEST_CASE("triangle lists and vertex cache optimization", "[triangles_1]") {
+	// Triangles as sorted source vert triples, winding checked separately
+	auto triangleSet = [](const TriangleMesh& tm) {
+		multiset<array<int, 3>> tris;
+		for (size_t t = 0; t < tm.triangleCount(); t++) {
+			array<int, 3> tri = { tm.source_verts[tm.indices[t * 3]], tm.source_verts[tm.indices[t * 3 + 1]], tm.source_verts[tm.indices[t * 3 + 2]] };
+			std::sort(tri.begin(), tri.end());
+			tris.insert(tri);
+		}
+		return tris;
+	};
+	auto faceNormalY = [](const TriangleMesh& tm, size_t t) {
+		const qvec3& a = tm.positions[tm.indices[t * 3]];
+		const qvec3& b = tm.positions[tm.indices[t * 3 + 1]];
+		const qvec3& c = tm.positions[tm.indices[t * 3 + 2]];
+		return (b.z - a.z) * (c.x - a.x) - (b.x - a.x) * (c.z - a.z);
+	};
+
+	SECTION("quads split along the shorter diagonal") {
+		MeshStructure* grid = buildGridMesh(2, 1, 1.0f);
+		// Stretch corner 2 (of face 0 = { 0, 3, 4, 1 }) away: 1 - 3 is now shorter
+		grid->verts[4] = qvec3{ 1.5f, 0.0f, 1.5f };
+		TriangleMesh tm = triangulateQuads(*grid);
+		REQUIRE(tm.triangleCount() == 4);
+		REQUIRE(tm.vertexCount() == grid->verts.size());
+		REQUIRE(tm.normals.size() == tm.vertexCount());
+		REQUIRE(tm.uvs.size() == tm.vertexCount());
+		multiset<array<int, 3>> tris = triangleSet(tm);
+		REQUIRE(tris.count(array<int, 3>({ 0, 1, 3 })) == 1);
+		REQUIRE(tris.count(array<int, 3>({ 1, 3, 4 })) == 1);
+		// Face 1 = { 1, 4, 5, 2 } keeps the 1 - 5 diagonal
+		REQUIRE(tris.count(array<int, 3>({ 1, 4, 5 })) == 1);
+		// Same winding as the quads, facing +Y like their normals
+		for (size_t t = 0; t < tm.triangleCount(); t++) REQUIRE(faceNormalY(tm, t) > 0.0f);
+
+		// A seam splits a vert, a collapsed quad drops its degenerate half
+		grid->quadFaces[1].uvs[0] = qvec2{ 0.9f, 0.0f };
+		grid->quadFaces[1].indices[3] = grid->quadFaces[1].indices[0];
+		tm = triangulateQuads(*grid);
+		// Vert 1 gains a vertex, vert 2 is left unused
+		REQUIRE(tm.vertexCount() == grid->verts.size());
+		REQUIRE(std::count(tm.source_verts.begin(), tm.source_verts.end(), 1) == 2);
+		REQUIRE(std::count(tm.source_verts.begin(), tm.source_verts.end(), 2) == 0);
+		REQUIRE(tm.triangleCount() == 3);
+		delete grid;
+
+		MeshStructure empty;
+		REQUIRE(triangulateQuads(empty).triangleCount() == 0);
+	}
+
+	SECTION("cache and fetch order") {
+		MeshStructure* grid = buildGridMesh(40, 40, 1.0f);
+		TriangleMesh tm = triangulateQuads(*grid);
+		multiset<array<int, 3>> before = triangleSet(tm);
+		TriangleOptimizeReport report = optimizeTriangleMesh(tm);
+
+		// Row order on rows wider than the cache transforms every vertex twice
+		REQUIRE(report.before.triangles == 40 * 40 * 2);
+		REQUIRE(report.before.vertices == 41 * 41);
+		REQUIRE(report.before.atvr > 1.9);
+		REQUIRE(report.after.acmr < report.before.acmr * 0.75);
+		REQUIRE(report.after.atvr < 1.5);
+		REQUIRE(report.after.acmr >= 0.5);
+
+		REQUIRE(triangleSet(tm) == before);
+		for (size_t t = 0; t < tm.triangleCount(); t++) REQUIRE(faceNormalY(tm, t) > 0.0f);
+		// Fetch order: every index at most one past the highest so far
+		uint32_t next = 0;
+		for (uint32_t v : tm.indices) {
+			REQUIRE(v <= next);
+			if (v == next) ++next;
+		}
+		for (size_t v = 0; v < tm.vertexCount(); v++) {
+			REQUIRE(tm.positions[v] == grid->verts[tm.source_verts[v]]);
+		}
+		std::ostringstream line;
+		printTriangleOptimizeReport(report, line);
+		REQUIRE(line.str().find("ACMR") != string::npos);
+
+		// Perfect reuse is unreachable, worst case is three per triangle
+		vector<uint32_t> soup = { 0, 1, 2, 3, 4, 5 };
+		VertexCacheStats stats = analyzeVertexCache(soup, 6);
+		REQUIRE(stats.acmr == 3.0);
+		REQUIRE(stats.atvr == 1.0);
+		delete grid;
+	}
+
+	SECTION("triangulated FBX export") {
+		MeshStructure* grid = buildGridMesh(3, 2, 1.0f);
+		FbxManager* lManager = FbxManager::Create();
+		FbxScene* lScene = FbxScene::Create(lManager, "triangles");
+		FbxTransformOptions options;
+		options.triangulate = true;
+		FbxMesh* lMesh = fbxTransformMesh(*grid, lScene, "tris", options);
+		REQUIRE(lMesh->GetPolygonCount() == 12);
+		REQUIRE(lMesh->GetControlPointsCount() == 12);
+		for (int p = 0; p < lMesh->GetPolygonCount(); p++) REQUIRE(lMesh->GetPolygonSize(p) == 3);
+		REQUIRE(lMesh->GetElementNormal()->GetIndexArray().GetCount() == 36);
+		REQUIRE(lMesh->GetElementUV()->GetDirectArray().GetCount() == 12);
+		lManager->Destroy();
+		delete grid;
+	}
+}
+
+TEST_CASE("quad decimation and LOD groups", "[lod_1]") {
+	auto requireQuads = [](const MeshStructure& ms) {
+		for (const auto& qf : ms.quadFaces) {
+			set<int> corners(qf.indices.begin(), qf.indices.end());
+			REQUIRE(corners.size() == 4);
+			for (int v : qf.indices) REQUIRE((v >= 0 && v < (int)ms.verts.size()));
+		}
+	};
+
+	SECTION("flat grid") {
+		MeshStructure* grid = buildGridMesh(32, 32, 1.0f);
+		DecimateOptions options;
+		options.target_faces = 256;
+		DecimateStats stats;
+		decimateQuads(*grid, options, &stats);
+		REQUIRE(stats.faces_before == 1024);
+		REQUIRE(stats.faces_after == grid->quadFaces.size());
+		REQUIRE(grid->quadFaces.size() <= 256);
+		REQUIRE(grid->quadFaces.size() >= 128);
+		REQUIRE(stats.passes > 1);
+		requireQuads(*grid);
+
+		// Nothing leaves the plane, the outline stays put
+		float minX = 1e9f, maxX = -1e9f, minZ = 1e9f, maxZ = -1e9f;
+		for (const auto& v : grid->verts) {
+			REQUIRE(std::abs(v.y) < 1e-5f);
+			minX = std::min(minX, v.x); maxX = std::max(maxX, v.x);
+			minZ = std::min(minZ, v.z); maxZ = std::max(maxZ, v.z);
+		}
+		REQUIRE(minX == Approx(0.0f).margin(1e-4));
+		REQUIRE(maxX == Approx(32.0f).margin(1e-4));
+		REQUIRE(minZ == Approx(0.0f).margin(1e-4));
+		REQUIRE(maxZ == Approx(32.0f).margin(1e-4));
+		for (const auto& qf : grid->quadFaces) {
+			for (int c = 0; c < 4; c++) REQUIRE(qf.normals[c].y == Approx(1.0f));
+		}
+		// Merged verts land on their neighbours' UVs
+		for (const auto& qf : grid->quadFaces) {
+			for (int c = 0; c < 4; c++) {
+				const qvec3& v = grid->verts[qf.indices[c]];
+				REQUIRE(qf.uvs[c].x == Approx(v.x / 32.0f).margin(1e-4));
+			}
+		}
+		delete grid;
+	}
+
+	SECTION("error keeps detail where the surface bends") {
+		MeshStructure* grid = buildGridMesh(32, 16, 1.0f);
+		for (auto& v : grid->verts) {
+			if (v.x > 16.0f) v.y = 0.5f * std::sin(v.x * 1.3f) * std::cos(v.z * 1.1f);
+		}
+		DecimateOptions options;
+		options.target_faces = 256;
+		decimateQuads(*grid, options);
+		requireQuads(*grid);
+		size_t flat = 0, bent = 0;
+		for (const auto& v : grid->verts) (v.x < 16.0f ? flat : bent)++;
+		REQUIRE(bent > flat * 2);
+
+		// An error cap stops short of the target
+		MeshStructure* capped = buildGridMesh(8, 8, 1.0f);
+		for (auto& v : capped->verts) v.y = 0.3f * ((v.x - 4.0f) * (v.x - 4.0f) + (v.z - 4.0f) * (v.z - 4.0f));
+		options.target_faces = 0;
+		options.max_error = 1e-6;
+		DecimateStats stats;
+		decimateQuads(*capped, options, &stats);
+		REQUIRE(stats.rings_collapsed == 0);
+		REQUIRE(capped->quadFaces.size() == 64);
+		delete capped;
+		delete grid;
+	}
+
+	SECTION("arena built meshes") {
+		// Every buffer must go back through the resource it came from
+		CountingResource counter;
+		{
+			MeshStructure* grid;
+			{
+				ScopedMemoryResource scope(&counter);
+				grid = buildGridMesh(16, 16, 1.0f);
+			}
+			DecimateOptions options;
+			options.target_faces = 64;
+			decimateQuads(*grid, options);
+			REQUIRE(grid->quadFaces.size() <= 64);
+			REQUIRE(grid->memoryResource() == &counter);
+			REQUIRE(grid->allocatorsConsistent());
+			delete grid;
+		}
+		REQUIRE(counter.bytes_in_use == 0);
+		REQUIRE(counter.deallocations == counter.allocations);
+
+		MonotonicArena arena(64 * 1024);
+		MeshStructure* grid;
+		{
+			ScopedMemoryResource scope(&arena);
+			grid = buildGridMesh(16, 16, 1.0f);
+		}
+		vector<MeshStructure> levels = buildLodChain(*grid);
+		decimateQuads(*grid);
+		REQUIRE(grid->quadFaces.size() < 256);
+		REQUIRE(grid->allocatorsConsistent());
+		REQUIRE(levels.back().quadFaces.size() <= 32);
+		delete grid;
+	}
+
+	SECTION("closed meshes that cannot shrink") {
+		MeshStructure* cube = buildDemoMesh_Cube();
+		const size_t faces = cube->quadFaces.size();
+		DecimateStats stats;
+		decimateQuads(*cube, DecimateOptions(), &stats);
+		REQUIRE(cube->quadFaces.size() == faces);
+		REQUIRE(stats.passes == 0);
+		delete cube;
+	}
+
+	SECTION("LOD chain and FbxLODGroup") {
+		MeshStructure* grid = buildGridMesh(16, 16, 1.0f);
+		vector<DecimateStats> stats;
+		vector<MeshStructure> levels = buildLodChain(*grid, LodChainOptions(), &stats);
+		REQUIRE(levels.size() == 4);
+		REQUIRE(stats.size() == 4);
+		REQUIRE(levels[0].quadFaces.size() == 256);
+		REQUIRE(levels[0].verts.size() == grid->verts.size());
+		for (size_t i = 1; i < levels.size(); i++) {
+			REQUIRE(levels[i].quadFaces.size() < levels[i - 1].quadFaces.size());
+			REQUIRE(stats[i].faces_before == levels[i - 1].quadFaces.size());
+			requireQuads(levels[i]);
+		}
+		REQUIRE(levels[3].quadFaces.size() <= 32);
+
+		FbxManager* lManager = FbxManager::Create();
+		FbxScene* lScene = FbxScene::Create(lManager, "lod");
+		FbxNode* lNode = fbxCreateLodGroup(levels, lScene, "grid");
+		FbxLODGroup* lLodGroup = dynamic_cast<FbxLODGroup*>(lNode->GetNodeAttribute());
+		REQUIRE(lLodGroup != NULL);
+		REQUIRE(lNode->GetChildCount() == 4);
+		REQUIRE(string(lNode->GetChild(3)->GetName()) == "grid_LOD3");
+		REQUIRE(lNode->GetChild(3)->GetMesh()->GetPolygonCount() == (int)levels[3].quadFaces.size());
+		REQUIRE(lLodGroup->GetNumThresholds() == 3);
+		REQUIRE(lLodGroup->GetNumDisplayLevels() == 4);
+		REQUIRE_FALSE(lLodGroup->ThresholdsUsedAsPercentage.Get());
+		FbxDistance lThreshold;
+		lLodGroup->GetThreshold(2, lThreshold);
+		REQUIRE(lThreshold.value() == Approx(40.0f));
+
+		FbxLodGroupOptions options;
+		options.percentage = true;
+		options.thresholds = { 60.0 };
+		lNode = fbxCreateLodGroup(levels, lScene, "grid_pct", options);
+		lLodGroup = dynamic_cast<FbxLODGroup*>(lNode->GetNodeAttribute());
+		REQUIRE(lLodGroup->ThresholdsUsedAsPercentage.Get());
+		lLodGroup->GetThreshold(0, lThreshold);
+		REQUIRE(lThreshold.value() == Approx(60.0f));
+		lLodGroup->GetThreshold(1, lThreshold);
+		REQUIRE(lThreshold.value() == Approx(25.0f));
+		lManager->Destroy();
+		delete grid;
+	}
+}
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Stand-in client: sends every request, returns the response lines
+static vector<string> unixSocketClient(const string& path, const vector<string>& requests) {
+	vector<string> lines;
+	int fd = -1;
+	for (int attempt = 0; attempt < 200 && fd < 0; attempt++) {
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+		if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+			close(fd);
+			fd = -1;
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+	if (fd < 0) return lines;
+	string all;
+	for (const auto& r : requests) all += r + "\n";
+	send(fd, all.data(), all.size(), 0);
+	string received;
+	char buffer[1024];
+	ssize_t n;
+	while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) received.append(buffer, (size_t)n);
+	close(fd);
+	std::istringstream in(received);
+	string line;
+	while (std::getline(in, line)) lines.push_back(line);
+	return lines;
+}
+#endif
+
+TEST_CASE("generator server sessions", "[genserver_1]") {
+	GenServer server;
+	std::ostringstream warm;
+	REQUIRE(server.warmUp(warm));
+	REQUIRE(warm.str().find("READY qgen") == 0);
+	FbxManager* lManager = gSdkManager;
+
+	SECTION("stream session") {
+		std::istringstream in(
+			"PING\n"
+			"# comment\n"
+			"qgen_serve_0.fbx meshes=2\n"
+			"qgen_serve_1.fbx meshes=oops\n"
+			"qgen_serve_2.fbx\n"
+			"STATS\n"
+			"QUIT\n"
+			"qgen_serve_3.fbx\n");
+		std::ostringstream out;
+		server.serveStream(in, out);
+
+		vector<string> lines;
+		std::istringstream responses(out.str());
+		string line;
+		while (std::getline(responses, line)) lines.push_back(line);
+		REQUIRE(lines.size() == 6);
+		REQUIRE(lines[0] == "PONG");
+		REQUIRE(lines[1].find("OK qgen_serve_0.fbx ") == 0);
+		REQUIRE(lines[2].find("ERR - ") == 0);
+		REQUIRE(lines[3].find("OK qgen_serve_2.fbx ") == 0);
+		REQUIRE(lines[4].find("STATS jobs=3 failed=1 p50=") == 0);
+		REQUIRE(lines[5] == "BYE");
+		REQUIRE(server.jobCount() == 3);
+		// The manager stays warm across requests
+		REQUIRE(gSdkManager == lManager);
+		REQUIRE(server.latencyPercentile(0.5) <= server.latencyPercentile(1.0));
+	}
+
+	SECTION("latency window") {
+		GenServer small(4);
+		for (int i = 0; i < 3; i++) {
+			std::ostringstream out;
+			small.handleLine("qgen_serve_w.fbx", out);
+		}
+		REQUIRE(small.jobCount() == 3);
+		REQUIRE(small.latencyPercentile(0.0) >= 0.0);
+	}
+
+#ifndef _WIN32
+	SECTION("unix socket session") {
+		const string path = "/tmp/qgen_serve_test_" + to_string(getpid()) + ".sock";
+		std::ostringstream log;
+		bool served = false;
+		std::thread serverThread([&]() {
+			served = server.serveUnixSocket(path, 2, log);
+		});
+		vector<string> first = unixSocketClient(path, { "PING", "qgen_serve_s.fbx meshes=1", "QUIT" });
+		vector<string> second = unixSocketClient(path, { "STATS", "SHUTDOWN" });
+		serverThread.join();
+
+		REQUIRE(served);
+		REQUIRE(first.size() == 4);
+		REQUIRE(first[0].find("READY") == 0);
+		REQUIRE(first[1] == "PONG");
+		REQUIRE(first[2].find("OK qgen_serve_s.fbx") == 0);
+		REQUIRE(first[3] == "BYE");
+		REQUIRE(second.size() == 3);
+		REQUIRE(second[1].find("STATS jobs=1 failed=0") == 0);
+		REQUIRE(access(path.c_str(), F_OK) != 0);
+
+		// Only a socket is replaced, a regular file at the path is kept
+		std::ofstream(path) << "keep";
+		std::ostringstream refused;
+		REQUIRE(!server.serveUnixSocket(path, 1, refused));
+		REQUIRE(refused.str().find("Not a socket") != string::npos);
+		REQUIRE(readWholeFile(path) == "keep");
+		std::remove(path.c_str());
+	}
+
+	SECTION("line length cap") {
+		server.setMaxLineLength(16);
+		const string longLine(40, 'x');
+		std::istringstream in("PING\n" + longLine + "\nPING\n");
+		std::ostringstream out;
+		server.serveStream(in, out);
+		REQUIRE(out.str() == "PONG\nERR - line too long\nPONG\n");
+
+		// A socket client streaming a line without end never gets more than
+		// the cap buffered, the session goes on after its newline
+		const string path = "/tmp/qgen_serve_cap_" + to_string(getpid()) + ".sock";
+		std::ostringstream log;
+		std::thread serverThread([&]() {
+			server.serveUnixSocket(path, 2, log);
+		});
+		vector<string> streamed = unixSocketClient(path, { "PING", string(100000, 'x'), "PING", "QUIT" });
+		vector<string> whole = unixSocketClient(path, { longLine, "QUIT" });
+		serverThread.join();
+		REQUIRE(streamed.size() == 5);
+		REQUIRE(streamed[1] == "PONG");
+		REQUIRE(streamed[2] == "ERR - line too long");
+		REQUIRE(streamed[3] == "PONG");
+		REQUIRE(streamed[4] == "BYE");
+		REQUIRE(whole.size() == 3);
+		REQUIRE(whole[1] == "ERR - line too long");
+		REQUIRE(whole[2] == "BYE");
+	}
+#endif
+
+	for (int i = 0; i < 4; i++) std::remove(("qgen_serve_" + to_string(i) + ".fbx").c_str());
+	std::remove("qgen_serve_w.fbx");
+	std::remove("qgen_serve_s.fbx");
+	DestroySdkObjects(gSdkManager, false);
+	ResetGenMeshState();
+}
@@ -1,4 +1,6 @@
 #include "FBXTransformer.h"
+#include "MeshTriangles.h"
+#include "TraceLib.h"
 
 namespace qg {
 	FbxVector4 toFbxVector4(const qvec3& v) {
@@ -9,9 +11,8 @@ namespace qg {
 		return FbxVector2(v.x, v.y);
 	}
 
-	FbxNode* fbxTransform(const MeshStructure& ms, FbxScene* pScene, char* pName) {
-		FbxMesh* lMesh = FbxMesh::Create(pScene, pName);
-
+	// Original export path: per element Add / SetAt
+	static void fbxFillMeshIncremental(const MeshStructure& ms, FbxMesh* lMesh, const FbxTransformOptions& options) {
 		long numFaces = ms.quadFaces.size();
 		long numVerts = numFaces * 4;
 		// Create control points.
@@ -46,7 +47,7 @@ namespace qg {
 
 		int i = 0;
 		for (auto qf: ms.quadFaces) {
-			cout << "FACE " << i/4 << endl;
+			if (options.verbosity > 1) cout << "FACE " << i/4 << endl;
 			// Add normals
 			nVec.Add(toFbxVector4(qf.normals[0]));
 			nVec.Add(toFbxVector4(qf.normals[1]));
@@ -70,11 +71,314 @@ namespace qg {
 			lMesh->EndPolygon();
 		}
 
-		for (int n = 0; n < ms.verts.size(); n++) {
-			cout << "VERTS " << lControlPoints[n].mData[0] << ',' << lControlPoints[n].mData[1] << ',' << lControlPoints[n].mData[2] << endl;
+		if (options.verbosity > 1) {
+			for (int n = 0; n < ms.verts.size(); n++) {
+				cout << "VERTS " << lControlPoints[n].mData[0] << ',' << lControlPoints[n].mData[1] << ',' << lControlPoints[n].mData[2] << endl;
+			}
+		}
+	}
+
+	// Welds per corner normals and UVs through VertHashGrid, writes the
+	// index arrays and fills the direct arrays with the distinct values only
+	static void fbxFillAttributesDeduped(
+		const MeshStructure& ms,
+		FbxLayerElementArrayTemplate<FbxVector4>& nVec,
+		int* lNormalIndices,
+		FbxLayerElementArrayTemplate<FbxVector2>& uvVec,
+		int* lUVIndices
+	) {
+		QG_TRACE_SCOPE_CAT("fbxFillAttributesDeduped", "fbx");
+		VertHashGrid normalGrid;
+		VertHashGrid uvGrid;
+		vector<qvec3> normals;
+		vector<qvec2> uvs;
+		const QuadFace* lFaces = ms.quadFaces.data();
+		const int numFaces = (int)ms.quadFaces.size();
+		for (int f = 0; f < numFaces; f++) {
+			const QuadFace& qf = lFaces[f];
+			for (int c = 0; c < 4; c++) {
+				const int k = f * 4 + c;
+				int ni = normalGrid.findOrInsert(qf.normals[c], (int)normals.size());
+				if (ni == (int)normals.size()) normals.push_back(qf.normals[c]);
+				lNormalIndices[k] = ni;
+				// UVs share the quantized grid with z pinned at 0
+				int ui = uvGrid.findOrInsert(qvec3{ qf.uvs[c].x, qf.uvs[c].y, 0.0f }, (int)uvs.size());
+				if (ui == (int)uvs.size()) uvs.push_back(qf.uvs[c]);
+				lUVIndices[k] = ui;
+			}
+		}
+
+		nVec.SetCount((int)normals.size());
+		FbxVector4* lNormals = nVec.GetLocked(FbxLayerElementArray::eWriteLock);
+		for (size_t i = 0; i < normals.size(); i++) {
+			lNormals[i] = FbxVector4(normals[i].x, normals[i].y, normals[i].z);
+		}
+		nVec.Release(&lNormals);
+
+		uvVec.SetCount((int)uvs.size());
+		FbxVector2* lUVs = uvVec.GetLocked(FbxLayerElementArray::eWriteLock);
+		for (size_t i = 0; i < uvs.size(); i++) {
+			lUVs[i] = FbxVector2(uvs[i].x, uvs[i].y);
+		}
+		uvVec.Release(&lUVs);
+	}
+
+	// Bulk export path: every array is sized once up front and written
+	// through raw pointers in a single pass over the faces
+	static void fbxFillMeshBulk(const MeshStructure& ms, FbxMesh* lMesh, const FbxTransformOptions& options) {
+		const int numVerts = (int)ms.verts.size();
+		const int numFaces = (int)ms.quadFaces.size();
+		const int numCorners = numFaces * 4;
+
+		// ------------- CREATE VERTS ARRAY ------------//
+		lMesh->InitControlPoints(numVerts);
+		FbxVector4* lControlPoints = lMesh->GetControlPoints();
+		const qvec3* lVerts = ms.verts.data();
+		for (int v = 0; v < numVerts; v++) {
+			lControlPoints[v] = FbxVector4(lVerts[v].x, lVerts[v].y, lVerts[v].z);
+		}
+
+		// ----------- MAP NORMALS AND UVS -------------//
+		FbxGeometryElementNormal* lGeometryElementNormal = lMesh->CreateElementNormal();
+		lGeometryElementNormal->SetMappingMode(FbxGeometryElement::eByPolygonVertex);
+		lGeometryElementNormal->SetReferenceMode(FbxGeometryElement::eIndexToDirect);
+		FbxGeometryElementUV* lUVDiffuseElement = lMesh->CreateElementUV("DiffuseUV");
+		FBX_ASSERT(lUVDiffuseElement != NULL);
+		lUVDiffuseElement->SetMappingMode(FbxGeometryElement::eByPolygonVertex);
+		lUVDiffuseElement->SetReferenceMode(FbxGeometryElement::eIndexToDirect);
+
+		auto& nVec = lGeometryElementNormal->GetDirectArray();
+		auto& nIdxVec = lGeometryElementNormal->GetIndexArray();
+		auto& uvVec = lUVDiffuseElement->GetDirectArray();
+		auto& uvIdxVec = lUVDiffuseElement->GetIndexArray();
+		nIdxVec.SetCount(numCorners);
+		uvIdxVec.SetCount(numCorners);
+		int* lNormalIndices = nIdxVec.GetLocked(FbxLayerElementArray::eWriteLock);
+		int* lUVIndices = uvIdxVec.GetLocked(FbxLayerElementArray::eWriteLock);
+
+		const QuadFace* lFaces = ms.quadFaces.data();
+		if (options.dedupe_attributes) {
+			fbxFillAttributesDeduped(ms, nVec, lNormalIndices, uvVec, lUVIndices);
+		}
+		else {
+			// One direct entry per polygon vertex, identity indices
+			nVec.SetCount(numCorners);
+			uvVec.SetCount(numCorners);
+			FbxVector4* lNormals = nVec.GetLocked(FbxLayerElementArray::eWriteLock);
+			FbxVector2* lUVs = uvVec.GetLocked(FbxLayerElementArray::eWriteLock);
+			for (int f = 0; f < numFaces; f++) {
+				const QuadFace& qf = lFaces[f];
+				for (int c = 0; c < 4; c++) {
+					const int k = f * 4 + c;
+					lNormals[k] = FbxVector4(qf.normals[c].x, qf.normals[c].y, qf.normals[c].z);
+					lUVs[k] = FbxVector2(qf.uvs[c].x, qf.uvs[c].y);
+					lNormalIndices[k] = k;
+					lUVIndices[k] = k;
+				}
+			}
+			nVec.Release(&lNormals);
+			uvVec.Release(&lUVs);
+		}
+		nIdxVec.Release(&lNormalIndices);
+		uvIdxVec.Release(&lUVIndices);
+
+		// ------------- BUILD FACES ------------//
+		lMesh->ReservePolygonCount(numFaces);
+		lMesh->ReservePolygonVertexCount(numCorners);
+		for (int f = 0; f < numFaces; f++) {
+			const QuadFace& qf = lFaces[f];
+			lMesh->BeginPolygon(-1, -1, -1, false);
+			for (int c = 0; c < 4; c++) {
+				lMesh->AddPolygon(qf.indices[c]);
+			}
+			lMesh->EndPolygon();
+		}
+
+		if (options.verbosity > 1) {
+			for (int f = 0; f < numFaces; f++) {
+				cout << "FACE " << f << " " << lFaces[f].indices[0] << ',' << lFaces[f].indices[1] << ','
+					<< lFaces[f].indices[2] << ',' << lFaces[f].indices[3] << endl;
+			}
+			for (int v = 0; v < numVerts; v++) {
+				cout << "VERTS " << lVerts[v].x << ',' << lVerts[v].y << ',' << lVerts[v].z << endl;
+			}
+		}
+	}
+
+	// Triangle export path: one polygon per triangle of the optimized list,
+	// normals and UVs indexed by vertex
+	static void fbxFillMeshTriangles(const MeshStructure& ms, FbxMesh* lMesh, const FbxTransformOptions& options) {
+		TriangleMesh tm = triangulateQuads(ms);
+		TriangleOptimizeReport report = optimizeTriangleMesh(tm);
+		if (options.verbosity > 0) printTriangleOptimizeReport(report, cout);
+
+		const int numVerts = (int)tm.vertexCount();
+		const int numTris = (int)tm.triangleCount();
+		const int numCorners = numTris * 3;
+		lMesh->InitControlPoints(numVerts);
+		FbxVector4* lControlPoints = lMesh->GetControlPoints();
+		for (int v = 0; v < numVerts; v++) {
+			lControlPoints[v] = toFbxVector4(tm.positions[v]);
+		}
+
+		if (!tm.normals.empty()) {
+			FbxGeometryElementNormal* lGeometryElementNormal = lMesh->CreateElementNormal();
+			lGeometryElementNormal->SetMappingMode(FbxGeometryElement::eByPolygonVertex);
+			lGeometryElementNormal->SetReferenceMode(FbxGeometryElement::eIndexToDirect);
+			auto& nVec = lGeometryElementNormal->GetDirectArray();
+			auto& nIdxVec = lGeometryElementNormal->GetIndexArray();
+			nVec.SetCount(numVerts);
+			nIdxVec.SetCount(numCorners);
+			FbxVector4* lNormals = nVec.GetLocked(FbxLayerElementArray::eWriteLock);
+			for (int v = 0; v < numVerts; v++) lNormals[v] = toFbxVector4(tm.normals[v]);
+			nVec.Release(&lNormals);
+			int* lNormalIndices = nIdxVec.GetLocked(FbxLayerElementArray::eWriteLock);
+			for (int k = 0; k < numCorners; k++) lNormalIndices[k] = (int)tm.indices[k];
+			nIdxVec.Release(&lNormalIndices);
+		}
+		if (!tm.uvs.empty()) {
+			FbxGeometryElementUV* lUVDiffuseElement = lMesh->CreateElementUV("DiffuseUV");
+			FBX_ASSERT(lUVDiffuseElement != NULL);
+			lUVDiffuseElement->SetMappingMode(FbxGeometryElement::eByPolygonVertex);
+			lUVDiffuseElement->SetReferenceMode(FbxGeometryElement::eIndexToDirect);
+			auto& uvVec = lUVDiffuseElement->GetDirectArray();
+			auto& uvIdxVec = lUVDiffuseElement->GetIndexArray();
+			uvVec.SetCount(numVerts);
+			uvIdxVec.SetCount(numCorners);
+			FbxVector2* lUVs = uvVec.GetLocked(FbxLayerElementArray::eWriteLock);
+			for (int v = 0; v < numVerts; v++) lUVs[v] = toFbxVector2(tm.uvs[v]);
+			uvVec.Release(&lUVs);
+			int* lUVIndices = uvIdxVec.GetLocked(FbxLayerElementArray::eWriteLock);
+			for (int k = 0; k < numCorners; k++) lUVIndices[k] = (int)tm.indices[k];
+			uvIdxVec.Release(&lUVIndices);
+		}
+
+		lMesh->ReservePolygonCount(numTris);
+		lMesh->ReservePolygonVertexCount(numCorners);
+		for (int t = 0; t < numTris; t++) {
+			lMesh->BeginPolygon(-1, -1, -1, false);
+			for (int c = 0; c < 3; c++) {
+				lMesh->AddPolygon((int)tm.indices[t * 3 + c]);
+			}
+			lMesh->EndPolygon();
+		}
+	}
+
+	// SoA export path: one pass per stream group, each reading only the
+	// streams it writes from
+	static void fbxFillMeshSoA(const MeshStructureSoA& soa, FbxMesh* lMesh) {
+		const int numVerts = (int)soa.vertCount();
+		const int numFaces = (int)soa.faceCount();
+		const int numCorners = numFaces * 4;
+
+		// ------------- CREATE VERTS ARRAY ------------//
+		lMesh->InitControlPoints(numVerts);
+		FbxVector4* lControlPoints = lMesh->GetControlPoints();
+		const float* x = soa.vx.data();
+		const float* y = soa.vy.data();
+		const float* z = soa.vz.data();
+		for (int v = 0; v < numVerts; v++) {
+			lControlPoints[v] = FbxVector4(x[v], y[v], z[v]);
+		}
+
+		// ----------- MAP NORMALS -------------//
+		FbxGeometryElementNormal* lGeometryElementNormal = lMesh->CreateElementNormal();
+		lGeometryElementNormal->SetMappingMode(FbxGeometryElement::eByPolygonVertex);
+		lGeometryElementNormal->SetReferenceMode(FbxGeometryElement::eIndexToDirect);
+		auto& nVec = lGeometryElementNormal->GetDirectArray();
+		auto& nIdxVec = lGeometryElementNormal->GetIndexArray();
+		nVec.SetCount(numCorners);
+		nIdxVec.SetCount(numCorners);
+		FbxVector4* lNormals = nVec.GetLocked(FbxLayerElementArray::eWriteLock);
+		const float* nx = soa.nx.data();
+		const float* ny = soa.ny.data();
+		const float* nz = soa.nz.data();
+		for (int k = 0; k < numCorners; k++) {
+			lNormals[k] = FbxVector4(nx[k], ny[k], nz[k]);
+		}
+		nVec.Release(&lNormals);
+		int* lNormalIndices = nIdxVec.GetLocked(FbxLayerElementArray::eWriteLock);
+		for (int k = 0; k < numCorners; k++) lNormalIndices[k] = k;
+		nIdxVec.Release(&lNormalIndices);
+
+		// ------------- MAP UVS ------------//
+		FbxGeometryElementUV* lUVDiffuseElement = lMesh->CreateElementUV("DiffuseUV");
+		FBX_ASSERT(lUVDiffuseElement != NULL);
+		lUVDiffuseElement->SetMappingMode(FbxGeometryElement::eByPolygonVertex);
+		lUVDiffuseElement->SetReferenceMode(FbxGeometryElement::eIndexToDirect);
+		auto& uvVec = lUVDiffuseElement->GetDirectArray();
+		auto& uvIdxVec = lUVDiffuseElement->GetIndexArray();
+		uvVec.SetCount(numCorners);
+		uvIdxVec.SetCount(numCorners);
+		FbxVector2* lUVs = uvVec.GetLocked(FbxLayerElementArray::eWriteLock);
+		const float* u = soa.u.data();
+		const float* v = soa.v.data();
+		for (int k = 0; k < numCorners; k++) {
+			lUVs[k] = FbxVector2(u[k], v[k]);
 		}
+		uvVec.Release(&lUVs);
+		int* lUVIndices = uvIdxVec.GetLocked(FbxLayerElementArray::eWriteLock);
+		for (int k = 0; k < numCorners; k++) lUVIndices[k] = k;
+		uvIdxVec.Release(&lUVIndices);
+
+		// ------------- BUILD FACES ------------//
+		lMesh->ReservePolygonCount(numFaces);
+		lMesh->ReservePolygonVertexCount(numCorners);
+		const int* lIndices = soa.indices.data();
+		for (int f = 0; f < numFaces; f++) {
+			lMesh->BeginPolygon(-1, -1, -1, false);
+			for (int c = 0; c < 4; c++) {
+				lMesh->AddPolygon(lIndices[f * 4 + c]);
+			}
+			lMesh->EndPolygon();
+		}
+	}
+
+	FbxMesh* fbxTransformMesh(const MeshStructure& ms, FbxScene* pScene, const char* pName, const FbxTransformOptions& options) {
+		QG_TRACE_SCOPE_CAT("fbxTransformMesh", "fbx");
+		QG_TRACE_COUNTER("fbx.quads", ms.quadFaces.size());
+		FbxMesh* lMesh = FbxMesh::Create(pScene, pName);
+		if (options.triangulate) {
+			fbxFillMeshTriangles(ms, lMesh, options);
+		}
+		else if (options.bulk) {
+			fbxFillMeshBulk(ms, lMesh, options);
+		}
+		else {
+			fbxFillMeshIncremental(ms, lMesh, options);
+		}
+		if (options.verbosity > 0) {
+			cout << "fbxTransform " << pName << ": " << ms.verts.size() << " verts, " << ms.quadFaces.size() << " faces" << endl;
+		}
+		return lMesh;
+	}
+
+	FbxMesh* fbxTransformMesh(const MeshStructureSoA& soa, FbxScene* pScene, const char* pName, const FbxTransformOptions& options) {
+		QG_TRACE_SCOPE_CAT("fbxTransformMesh", "fbx");
+		QG_TRACE_COUNTER("fbx.quads", soa.faceCount());
+		if (!options.bulk || options.dedupe_attributes || options.triangulate) {
+			throw invalid_argument("fbxTransformMesh: SoA export supports the bulk layout only");
+		}
+		FbxMesh* lMesh = FbxMesh::Create(pScene, pName);
+		fbxFillMeshSoA(soa, lMesh);
+		if (options.verbosity > 0) {
+			cout << "fbxTransform " << pName << ": " << soa.vertCount() << " verts, " << soa.faceCount() << " faces (SoA)" << endl;
+		}
+		return lMesh;
+	}
+
+	FbxNode* fbxTransform(const MeshStructure& ms, FbxScene* pScene, char* pName) {
+		return fbxTransform(ms, pScene, pName, FbxTransformOptions());
+	}
+
+	FbxNode* fbxTransform(const MeshStructure& ms, FbxScene* pScene, char* pName, const FbxTransformOptions& options) {
+		FbxMesh* lMesh = fbxTransformMesh(ms, pScene, pName, options);
 		//return lMesh;
-		
+		return fbxCreateMeshNode(lMesh, pScene, pName);
+	}
+
+	FbxNode* fbxCreateMeshNode(FbxMesh* lMesh, FbxScene* pScene, const char* pName) {
+		QG_TRACE_SCOPE_CAT("fbxCreateMeshNode", "fbx");
 		// create a FbxNode
 		FbxNode* lNode = FbxNode::Create(pScene, pName);
 
@@ -90,4 +394,33 @@ namespace qg {
 		// return the FbxNode
 		return lNode;
 	}
-}
\ No newline at end of file
+
+	FbxNode* fbxCreateLodGroup(const vector<MeshStructure>& levels, FbxScene* pScene, const char* pName, const FbxLodGroupOptions& options) {
+		QG_TRACE_SCOPE_CAT("fbxCreateLodGroup", "fbx");
+		FbxNode* lGroupNode = FbxNode::Create(pScene, pName);
+		FbxLODGroup* lLodGroup = FbxLODGroup::Create(pScene, pName);
+		lGroupNode->SetNodeAttribute(lLodGroup);
+
+		lLodGroup->ThresholdsUsedAsPercentage.Set(options.percentage);
+		lLodGroup->WorldSpace.Set(options.world_space);
+		lLodGroup->MinMaxDistance.Set(false);
+
+		const FbxSystemUnit lUnit = pScene->GetGlobalSettings().GetSystemUnit();
+		for (size_t i = 0; i < levels.size(); i++) {
+			string lName = string(pName) + "_LOD" + std::to_string(i);
+			FbxMesh* lMesh = fbxTransformMesh(levels[i], pScene, lName.c_str(), options.transform);
+			lGroupNode->AddChild(fbxCreateMeshNode(lMesh, pScene, lName.c_str()));
+			lLodGroup->SetDisplayLevel((int)i, FbxLODGroup::eUseLOD);
+
+			// Thresholds sit between levels
+			if (i + 1 == levels.size()) break;
+			double lThreshold;
+			if (i < options.thresholds.size()) lThreshold = options.thresholds[i];
+			else if (options.percentage) lThreshold = 50.0 / (1 << i);
+			else lThreshold = 10.0 * (1 << i);
+			if (options.percentage) lLodGroup->AddThreshold(lThreshold);
+			else lLodGroup->AddThreshold(FbxDistance((float)lThreshold, lUnit));
+		}
+		return lGroupNode;
+	}
+}
@@ -2,12 +2,55 @@
 
 #include "BaseWrapper.h"
 #include "MeshStructure.h"
+#include "MeshStructureSoA.h"
 
 using namespace std;
 
 namespace qg {
+	struct FbxTransformOptions {
+		// Pre-size control point, direct and index arrays and fill them
+		// through locked raw pointers in one pass. false keeps the original
+		// per element Add / SetAt path
+		bool bulk = true;
+		// Bulk only: store each distinct normal / UV once in the direct
+		// arrays (welded like qvec3::operator==, at VERT_PRECISION) and
+		// reference them through real eIndexToDirect indices
+		bool dedupe_attributes = false;
+		// Export triangles instead of quads: triangulateQuads, then
+		// optimizeTriangleMesh. Control points are the triangle vertices in
+		// fetch order, so importers that triangulate (samples/ViewScene)
+		// find nothing left to split and keep the cache friendly order
+		bool triangulate = false;
+		// 0: silent, 1: one summary line per mesh, 2: dump every face and vert
+		int verbosity = 0;
+	};
+
 	FbxNode* fbxTransform(const MeshStructure& ms, FbxScene* pScene, char* pName);
+	FbxNode* fbxTransform(const MeshStructure& ms, FbxScene* pScene, char* pName, const FbxTransformOptions& options);
+	// Mesh attribute only, no node
+	FbxMesh* fbxTransformMesh(const MeshStructure& ms, FbxScene* pScene, const char* pName, const FbxTransformOptions& options);
+	// Same mesh from SoA storage: each FBX array is filled from its own
+	// streams in a separate pass. Bulk layout only: throws
+	// invalid_argument if options ask for bulk = false, dedupe_attributes
+	// or triangulate (convert with toAoS for those)
+	FbxMesh* fbxTransformMesh(const MeshStructureSoA& soa, FbxScene* pScene, const char* pName, const FbxTransformOptions& options);
+	// Node carrying an existing mesh, several nodes may share one mesh
+	FbxNode* fbxCreateMeshNode(FbxMesh* lMesh, FbxScene* pScene, const char* pName);
+
+	struct FbxLodGroupOptions {
+		// Switch distance from each level to the next, in scene units, or
+		// percentages of screen size if percentage is set. Empty: 10, 20,
+		// 40... (or 50, 25, 12.5... percent)
+		vector<double> thresholds;
+		bool percentage = false;
+		bool world_space = true;      // distances not affected by the group's scaling
+		FbxTransformOptions transform;
+	};
+
+	// LOD group node (FbxLODGroup attribute) with one child mesh node per
+	// level, named pName_LOD0, pName_LOD1... Levels from buildLodChain
+	FbxNode* fbxCreateLodGroup(const vector<MeshStructure>& levels, FbxScene* pScene, const char* pName, const FbxLodGroupOptions& options = FbxLodGroupOptions());
 
 	FbxVector4 toFbxVector4(const qvec3& v);
 	FbxVector2 toFbxVector2(const qvec2& v);
-}
\ No newline at end of file
+}
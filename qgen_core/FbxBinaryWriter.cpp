@@ -0,0 +1,533 @@
+#include "FbxBinaryWriter.h"
+#include "TraceLib.h"
+#include <fstream>
+#include <zlib.h>
+
+namespace qg {
+
+	// ===================== FBX BINARY STREAM ===================== //
+	// Node records are written in place; end offset, property count and
+	// property list length are patched once the node is closed
+
+	static const uint32_t FBX_VERSION = 7400;
+	static const size_t FBX_NULL_RECORD = 13; // 3 x uint32 + name length, all 0
+
+	// Creation time and the file / footer ids the SDK checks against it
+	static const char FBX_CREATION_TIME[] = "1970-01-01 10:00:00:000";
+	static const unsigned char FBX_FILE_ID[16] = {
+		0x28, 0xb3, 0x2a, 0xeb, 0xb6, 0x24, 0xcc, 0xc2, 0xbf, 0xc8, 0xb0, 0x2a, 0xa9, 0x2b, 0xfc, 0xf1 };
+	static const unsigned char FBX_FOOTER_ID[16] = {
+		0xfa, 0xbc, 0xab, 0x09, 0xd0, 0xc8, 0xd4, 0x66, 0xb1, 0x76, 0xfb, 0x83, 0x1c, 0xf7, 0x26, 0x7e };
+	static const unsigned char FBX_FOOTER_MAGIC[16] = {
+		0xf8, 0x5a, 0x8c, 0x6a, 0xde, 0xf5, 0xd9, 0x7e, 0xec, 0xe9, 0x0c, 0xe3, 0x75, 0x8f, 0x29, 0x0b };
+
+	class FbxBinaryStream {
+	public:
+		FbxBinaryStream(ostream& out, const FbxBinaryWriterOptions& options) : out(out), options(options) {};
+
+		void writeHeader() {
+			static const char magic[23] = "Kaydara FBX Binary  \0\x1a";
+			out.write(magic, 23);
+			put<uint32_t>(FBX_VERSION);
+		};
+
+		void beginNode(const char* name) {
+			if (!nodes.empty()) {
+				closeProperties(nodes.back());
+				nodes.back().children = true;
+			}
+			Node node;
+			node.header = tell();
+			put<uint32_t>(0);
+			put<uint32_t>(0);
+			put<uint32_t>(0);
+			uint8_t length = (uint8_t)strlen(name);
+			put<uint8_t>(length);
+			out.write(name, length);
+			node.properties = tell();
+			nodes.push_back(node);
+		};
+
+		void endNode() {
+			Node& node = nodes.back();
+			closeProperties(node);
+			if (node.children || node.count == 0) writeNullRecord();
+			uint64_t end = tell();
+			out.seekp(node.header);
+			put<uint32_t>(offset32(end));
+			put<uint32_t>(node.count);
+			put<uint32_t>(node.length);
+			out.seekp(end);
+			nodes.pop_back();
+		};
+
+		void writeNullRecord() {
+			static const char zeros[FBX_NULL_RECORD] = {};
+			out.write(zeros, FBX_NULL_RECORD);
+		};
+
+		void propBool(bool v) { property('C'); put<uint8_t>(v ? 1 : 0); };
+		void propInt(int32_t v) { property('I'); put<int32_t>(v); };
+		void propLong(int64_t v) { property('L'); put<int64_t>(v); };
+		void propDouble(double v) { property('D'); put<double>(v); };
+
+		void propString(const string& v) {
+			property('S');
+			put<uint32_t>((uint32_t)v.size());
+			out.write(v.data(), v.size());
+		};
+
+		void propRaw(const void* data, size_t bytes) {
+			property('R');
+			put<uint32_t>((uint32_t)bytes);
+			out.write((const char*)data, bytes);
+		};
+
+		// Array property, data handed over in any number of chunks
+		void beginArray(char type, size_t count, size_t elementSize) {
+			property(type);
+			put<uint32_t>((uint32_t)count);
+			array_deflate = options.compress && count * elementSize >= options.compress_min_bytes;
+			put<uint32_t>(array_deflate ? 1 : 0);
+			array_length_pos = tell();
+			put<uint32_t>(0);
+			array_start = tell();
+			if (array_deflate) {
+				memset(&zs, 0, sizeof(zs));
+				if (deflateInit(&zs, options.compression_level) != Z_OK) throw std::runtime_error("deflateInit failed");
+			}
+		};
+
+		void arrayData(const void* data, size_t bytes) {
+			if (!array_deflate) {
+				out.write((const char*)data, bytes);
+				return;
+			}
+			zs.next_in = (Bytef*)data;
+			zs.avail_in = (uInt)bytes;
+			deflateChunk(Z_NO_FLUSH);
+		};
+
+		void endArray() {
+			if (array_deflate) {
+				zs.next_in = NULL;
+				zs.avail_in = 0;
+				deflateChunk(Z_FINISH);
+				deflateEnd(&zs);
+			}
+			uint64_t end = tell();
+			out.seekp(array_length_pos);
+			put<uint32_t>(offset32(end - array_start));
+			out.seekp(end);
+		};
+
+		void writeFooter() {
+			out.write((const char*)FBX_FOOTER_ID, 16);
+			put<uint32_t>(0);
+			// Pads to 16 bytes, a full 16 when already aligned
+			size_t pad = 16 - (size_t)(tell() % 16);
+			static const char zeros[120] = {};
+			out.write(zeros, pad);
+			put<uint32_t>(FBX_VERSION);
+			out.write(zeros, 120);
+			out.write((const char*)FBX_FOOTER_MAGIC, 16);
+		};
+
+		uint64_t tell() { return (uint64_t)out.tellp(); };
+
+	private:
+		struct Node {
+			uint64_t header;
+			uint64_t properties;
+			uint32_t count = 0;
+			uint32_t length = 0;
+			bool closed = false;
+			bool children = false;
+		};
+
+		ostream& out;
+		const FbxBinaryWriterOptions& options;
+		vector<Node> nodes;
+		z_stream zs;
+		bool array_deflate = false;
+		uint64_t array_length_pos = 0;
+		uint64_t array_start = 0;
+
+		template <class T>
+		void put(T v) {
+			// FBX is little endian, as every platform the SDK ships for
+			out.write((const char*)&v, sizeof(T));
+		};
+
+		void property(char type) {
+			nodes.back().count++;
+			put<char>(type);
+		};
+
+		void closeProperties(Node& node) {
+			if (node.closed) return;
+			node.length = offset32(tell() - node.properties);
+			node.closed = true;
+		};
+
+		void deflateChunk(int flush) {
+			char buffer[64 * 1024];
+			do {
+				zs.next_out = (Bytef*)buffer;
+				zs.avail_out = sizeof(buffer);
+				int status = deflate(&zs, flush);
+				if (status == Z_STREAM_ERROR) throw std::runtime_error("deflate failed");
+				out.write(buffer, sizeof(buffer) - zs.avail_out);
+			} while (zs.avail_out == 0 || (flush == Z_FINISH && zs.avail_in > 0));
+		};
+
+		static uint32_t offset32(uint64_t v) {
+			if (v > 0xffffffffull) throw std::runtime_error("FBX 7.4 file larger than 4GB");
+			return (uint32_t)v;
+		};
+	};
+
+	// Buffers array elements and hands them to the stream in chunks
+	template <class T>
+	class FbxArrayChunker {
+	public:
+		FbxArrayChunker(FbxBinaryStream& stream, char type, size_t count) : stream(stream) {
+			stream.beginArray(type, count, sizeof(T));
+		};
+		void push(T v) {
+			buffer[used++] = v;
+			if (used == CHUNK) flush();
+		};
+		void finish() {
+			flush();
+			stream.endArray();
+		};
+	private:
+		static const size_t CHUNK = 8192;
+		FbxBinaryStream& stream;
+		T buffer[CHUNK];
+		size_t used = 0;
+
+		void flush() {
+			if (used) stream.arrayData(buffer, used * sizeof(T));
+			used = 0;
+		};
+	};
+	// =================== end FBX BINARY STREAM =================== //
+
+	// ======================== SCENE WRITER ======================= //
+
+	static void writeP70Int(FbxBinaryStream& s, const char* name, int v) {
+		s.beginNode("P");
+		s.propString(name);
+		s.propString("int");
+		s.propString("Integer");
+		s.propString("");
+		s.propInt(v);
+		s.endNode();
+	}
+
+	static void writeP70Double(FbxBinaryStream& s, const char* name, double v) {
+		s.beginNode("P");
+		s.propString(name);
+		s.propString("double");
+		s.propString("Number");
+		s.propString("");
+		s.propDouble(v);
+		s.endNode();
+	}
+
+	static void writeP70String(FbxBinaryStream& s, const char* name, const char* type, const char* v) {
+		s.beginNode("P");
+		s.propString(name);
+		s.propString(type);
+		s.propString("");
+		s.propString("");
+		s.propString(v);
+		s.endNode();
+	}
+
+	// Animatable vector, e.g. "Lcl Translation"
+	static void writeP70Vector(FbxBinaryStream& s, const char* name, const qvec3& v) {
+		s.beginNode("P");
+		s.propString(name);
+		s.propString(name);
+		s.propString("");
+		s.propString("A");
+		s.propDouble(v.x);
+		s.propDouble(v.y);
+		s.propDouble(v.z);
+		s.endNode();
+	}
+
+	static void writeIntNode(FbxBinaryStream& s, const char* name, int v) {
+		s.beginNode(name);
+		s.propInt(v);
+		s.endNode();
+	}
+
+	static void writeStringNode(FbxBinaryStream& s, const char* name, const string& v) {
+		s.beginNode(name);
+		s.propString(v);
+		s.endNode();
+	}
+
+	// Binary FBX object names are "name\0\1Class"
+	static string fbxObjectName(const string& name, const char* fbxClass) {
+		return name + string("\0\1", 2) + fbxClass;
+	}
+
+	static void writeHeaderExtension(FbxBinaryStream& s) {
+		s.beginNode("FBXHeaderExtension");
+		writeIntNode(s, "FBXHeaderVersion", 1003);
+		writeIntNode(s, "FBXVersion", FBX_VERSION);
+		writeIntNode(s, "EncryptionType", 0);
+		s.beginNode("CreationTimeStamp");
+		writeIntNode(s, "Version", 1000);
+		writeIntNode(s, "Year", 1970);
+		writeIntNode(s, "Month", 1);
+		writeIntNode(s, "Day", 1);
+		writeIntNode(s, "Hour", 10);
+		writeIntNode(s, "Minute", 0);
+		writeIntNode(s, "Second", 0);
+		writeIntNode(s, "Millisecond", 0);
+		s.endNode();
+		writeStringNode(s, "Creator", "qgen " QGEN_VERSION);
+		s.endNode();
+
+		s.beginNode("FileId");
+		s.propRaw(FBX_FILE_ID, sizeof(FBX_FILE_ID));
+		s.endNode();
+		writeStringNode(s, "CreationTime", FBX_CREATION_TIME);
+		writeStringNode(s, "Creator", "qgen " QGEN_VERSION);
+	}
+
+	static void writeGlobalSettings(FbxBinaryStream& s) {
+		// Y up, right handed, centimeters: the SDK defaults
+		s.beginNode("GlobalSettings");
+		writeIntNode(s, "Version", 1000);
+		s.beginNode("Properties70");
+		writeP70Int(s, "UpAxis", 1);
+		writeP70Int(s, "UpAxisSign", 1);
+		writeP70Int(s, "FrontAxis", 2);
+		writeP70Int(s, "FrontAxisSign", 1);
+		writeP70Int(s, "CoordAxis", 0);
+		writeP70Int(s, "CoordAxisSign", 1);
+		writeP70Double(s, "UnitScaleFactor", 1.0);
+		writeP70Double(s, "OriginalUnitScaleFactor", 1.0);
+		s.endNode();
+		s.endNode();
+	}
+
+	static void writeDocuments(FbxBinaryStream& s, int64_t documentId) {
+		s.beginNode("Documents");
+		writeIntNode(s, "Count", 1);
+		s.beginNode("Document");
+		s.propLong(documentId);
+		s.propString("");
+		s.propString("Scene");
+		s.beginNode("Properties70");
+		s.beginNode("P");
+		s.propString("SourceObject");
+		s.propString("object");
+		s.propString("");
+		s.propString("");
+		s.endNode();
+		writeP70String(s, "ActiveAnimStackName", "KString", "");
+		s.endNode();
+		s.beginNode("RootNode");
+		s.propLong(0);
+		s.endNode();
+		s.endNode();
+		s.endNode();
+
+		s.beginNode("References");
+		s.endNode();
+	}
+
+	static void writeDefinitions(FbxBinaryStream& s, int meshCount) {
+		s.beginNode("Definitions");
+		writeIntNode(s, "Version", 100);
+		writeIntNode(s, "Count", 1 + 2 * meshCount);
+		const char* types[] = { "GlobalSettings", "Model", "Geometry" };
+		const int counts[] = { 1, meshCount, meshCount };
+		for (int t = 0; t < 3; t++) {
+			s.beginNode("ObjectType");
+			s.propString(types[t]);
+			writeIntNode(s, "Count", counts[t]);
+			s.endNode();
+		}
+		s.endNode();
+	}
+
+	static void writeGeometry(FbxBinaryStream& s, const FbxWriterMesh& m, int64_t id) {
+		QG_TRACE_SCOPE_CAT("writeFbxBinary.geometry", "fbx");
+		const MeshStructure& ms = *m.mesh;
+		const size_t numFaces = ms.quadFaces.size();
+		const size_t numCorners = numFaces * 4;
+
+		s.beginNode("Geometry");
+		s.propLong(id);
+		s.propString(fbxObjectName(m.name, "Geometry"));
+		s.propString("Mesh");
+
+		{
+			s.beginNode("Vertices");
+			FbxArrayChunker<double> a(s, 'd', ms.verts.size() * 3);
+			for (const auto& v : ms.verts) {
+				a.push(v.x);
+				a.push(v.y);
+				a.push(v.z);
+			}
+			a.finish();
+			s.endNode();
+		}
+		{
+			// The last index of a polygon is stored as ~index
+			s.beginNode("PolygonVertexIndex");
+			FbxArrayChunker<int32_t> a(s, 'i', numCorners);
+			for (const auto& qf : ms.quadFaces) {
+				a.push(qf.indices[0]);
+				a.push(qf.indices[1]);
+				a.push(qf.indices[2]);
+				a.push(~qf.indices[3]);
+			}
+			a.finish();
+			s.endNode();
+		}
+		writeIntNode(s, "GeometryVersion", 124);
+
+		s.beginNode("LayerElementNormal");
+		s.propInt(0);
+		writeIntNode(s, "Version", 101);
+		writeStringNode(s, "Name", "");
+		writeStringNode(s, "MappingInformationType", "ByPolygonVertex");
+		writeStringNode(s, "ReferenceInformationType", "Direct");
+		{
+			s.beginNode("Normals");
+			FbxArrayChunker<double> a(s, 'd', numCorners * 3);
+			for (const auto& qf : ms.quadFaces) {
+				for (int c = 0; c < 4; c++) {
+					a.push(qf.normals[c].x);
+					a.push(qf.normals[c].y);
+					a.push(qf.normals[c].z);
+				}
+			}
+			a.finish();
+			s.endNode();
+		}
+		s.endNode();
+
+		s.beginNode("LayerElementUV");
+		s.propInt(0);
+		writeIntNode(s, "Version", 101);
+		writeStringNode(s, "Name", "DiffuseUV");
+		writeStringNode(s, "MappingInformationType", "ByPolygonVertex");
+		writeStringNode(s, "ReferenceInformationType", "IndexToDirect");
+		{
+			s.beginNode("UV");
+			FbxArrayChunker<double> a(s, 'd', numCorners * 2);
+			for (const auto& qf : ms.quadFaces) {
+				for (int c = 0; c < 4; c++) {
+					a.push(qf.uvs[c].x);
+					a.push(qf.uvs[c].y);
+				}
+			}
+			a.finish();
+			s.endNode();
+		}
+		{
+			s.beginNode("UVIndex");
+			FbxArrayChunker<int32_t> a(s, 'i', numCorners);
+			for (size_t k = 0; k < numCorners; k++) a.push((int32_t)k);
+			a.finish();
+			s.endNode();
+		}
+		s.endNode();
+
+		s.beginNode("Layer");
+		s.propInt(0);
+		writeIntNode(s, "Version", 100);
+		const char* elements[] = { "LayerElementNormal", "LayerElementUV" };
+		for (const char* element : elements) {
+			s.beginNode("LayerElement");
+			writeStringNode(s, "Type", element);
+			writeIntNode(s, "TypedIndex", 0);
+			s.endNode();
+		}
+		s.endNode();
+
+		s.endNode();
+	}
+
+	static void writeModel(FbxBinaryStream& s, const FbxWriterMesh& m, int64_t id) {
+		s.beginNode("Model");
+		s.propLong(id);
+		s.propString(fbxObjectName(m.name, "Model"));
+		s.propString("Mesh");
+		writeIntNode(s, "Version", 232);
+		s.beginNode("Properties70");
+		writeP70Vector(s, "Lcl Translation", m.translation);
+		writeP70Vector(s, "Lcl Rotation", m.rotation);
+		writeP70Vector(s, "Lcl Scaling", m.scaling);
+		s.endNode();
+		s.beginNode("Shading");
+		s.propBool(true);
+		s.endNode();
+		writeStringNode(s, "Culling", "CullingOff");
+		s.endNode();
+	}
+
+	static void writeConnection(FbxBinaryStream& s, int64_t child, int64_t parent) {
+		s.beginNode("C");
+		s.propString("OO");
+		s.propLong(child);
+		s.propLong(parent);
+		s.endNode();
+	}
+
+	bool writeFbxBinary(const string& path, const vector<FbxWriterMesh>& meshes, const FbxBinaryWriterOptions& options) {
+		QG_TRACE_SCOPE_CAT("writeFbxBinary", "fbx");
+		std::ofstream out(path, std::ios::binary);
+		if (!out) return false;
+		// Object ids: document, then a model / geometry pair per mesh
+		const int64_t documentId = 1000000;
+		auto modelId = [&](size_t i) { return documentId + 1 + 2 * (int64_t)i; };
+		auto geometryId = [&](size_t i) { return documentId + 2 + 2 * (int64_t)i; };
+
+		try {
+			FbxBinaryStream s(out, options);
+			s.writeHeader();
+			writeHeaderExtension(s);
+			writeGlobalSettings(s);
+			writeDocuments(s, documentId);
+			writeDefinitions(s, (int)meshes.size());
+
+			s.beginNode("Objects");
+			for (size_t i = 0; i < meshes.size(); i++) {
+				writeGeometry(s, meshes[i], geometryId(i));
+				writeModel(s, meshes[i], modelId(i));
+			}
+			s.endNode();
+
+			s.beginNode("Connections");
+			for (size_t i = 0; i < meshes.size(); i++) {
+				writeConnection(s, modelId(i), 0);
+				writeConnection(s, geometryId(i), modelId(i));
+			}
+			s.endNode();
+
+			s.beginNode("Takes");
+			writeStringNode(s, "Current", "");
+			s.endNode();
+
+			s.writeNullRecord();
+			s.writeFooter();
+		}
+		catch (const std::runtime_error&) {
+			return false;
+		}
+		return (bool)out;
+	}
+	// ====================== end SCENE WRITER ===================== //
+}
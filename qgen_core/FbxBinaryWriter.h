@@ -0,0 +1,39 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "MeshStructure.h"
+
+using namespace std;
+
+namespace qg {
+
+	// SDK FREE FBX WRITER
+	// Streams MeshStructure only scenes straight into a binary FBX 7.4 file:
+	// one Model + Geometry pair per mesh under the root, no FbxManager, no
+	// FbxMesh / layer element copies. Geometry matches the bulk fbxTransform
+	// output: control points = verts, one quad per QuadFace, per polygon
+	// vertex normals ("DiffuseUV" UVs through identity indices).
+	// Arrays are zlib deflated while they are generated, chunk by chunk, so
+	// no full size double copy of the mesh is ever held. Files above 4GB
+	// need FBX 7.5 offsets and are refused.
+	struct FbxWriterMesh {
+		const MeshStructure* mesh;
+		string name;
+		qvec3 translation = { 0.0f, 0.0f, 0.0f };
+		qvec3 rotation = { 0.0f, 0.0f, 0.0f }; // euler XYZ, degrees
+		qvec3 scaling = { 1.0f, 1.0f, 1.0f };
+	};
+
+	struct FbxBinaryWriterOptions {
+		bool compress = true;
+		int compression_level = 1;        // zlib level, 1 favours speed
+		size_t compress_min_bytes = 128;  // smaller arrays are stored raw
+	};
+
+	// false if the file cannot be written
+	bool writeFbxBinary(
+		const string& path,
+		const vector<FbxWriterMesh>& meshes,
+		const FbxBinaryWriterOptions& options = FbxBinaryWriterOptions()
+	);
+}
@@ -4,7 +4,15 @@
 #include "MeshStructure.h"
 #include "MeshBuilder.h"
 #include "FBXTransformer.h"
-#include "CoreTester.h"
+#include "GeometryCache.h"
+#include "TraceLib.h"
+#include "GenServer.h"
+#include "ResultCache.h"
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <thread>
 
 using namespace std::chrono;
 using namespace std;
@@ -22,6 +30,11 @@ namespace qg {
 	double gMeshYPos = 20.0;  // initial CubeYPos
 	double gMeshZPos = 0.0;   // initial CubeZPos
 
+	const char* const DEMO_MESH_BUILDER_KEY = "buildDemoMesh_Cube";
+
+	// Generated geometry shared across nodes of gScene
+	GeometryCache gGeometryCache;
+
 	FbxAnimLayer* gAnimLayer = NULL;  // holder of animation curves
 	FbxString* gAppPath = NULL;     // path where the application started
 
@@ -48,6 +61,7 @@ namespace qg {
 
 		//Create an FBX scene. This object holds most objects imported/exported from/to files.
 		pScene = FbxScene::Create(pManager, "My Scene");
+		gGeometryCache.clear();
 		if (!pScene)
 		{
 			FBXSDK_printf("Error: Unable to create FBX scene!\n");
@@ -58,20 +72,54 @@ namespace qg {
 
 	void DestroySdkObjects(FbxManager* pManager, bool pExitStatus)
 	{
+		QG_TRACE_SCOPE("DestroySdkObjects");
+		// Cached meshes die with their scenes
+		gGeometryCache.clear();
+
 		//Delete the FBX Manager. All the objects that have been allocated using the FBX Manager and that haven't been explicitly destroyed are also automatically destroyed.
 		if (pManager) pManager->Destroy();
+		if (pManager == gSdkManager) {
+			gSdkManager = NULL;
+			gScene = NULL;
+		}
 		if (pExitStatus) FBXSDK_printf("Program Success!\n");
 	}
 
 	// to create a basic scene
 	bool CreateScene()
 	{
+		QG_TRACE_SCOPE("CreateScene");
 		// Initialize the FbxManager and the FbxScene
 		if (InitializeSdkObjects(gSdkManager, gScene) == false)
 		{
 			return false;
 		}
 
+		PopulateScene();
+		return true;
+	}
+
+	// Replace gScene by an empty scene, keeping the FbxManager and its
+	// FbxIOSettings alive
+	bool ResetScene()
+	{
+		QG_TRACE_SCOPE("ResetScene");
+		if (gSdkManager == NULL) return CreateScene();
+
+		// Cached meshes belong to the old scene
+		gGeometryCache.clear();
+		if (gScene) gScene->Destroy();
+		gScene = FbxScene::Create(gSdkManager, "My Scene");
+		if (!gScene) return false;
+
+		ResetGenMeshState();
+		PopulateScene();
+		return true;
+	}
+
+	// marker and camera every scene starts with
+	void PopulateScene()
+	{
 		// create a marker
 		FbxNode* lMarker = CreateMarker(gScene, "Marker");
 
@@ -94,8 +142,6 @@ namespace qg {
 
 		// set camera switcher as the default camera
 		gScene->GetGlobalSettings().SetDefaultCamera((char *)lCamera->GetName());
-
-		return true;
 	}
 
 
@@ -180,6 +226,7 @@ namespace qg {
 		if (pSdkManager == NULL) return false;
 		if (pScene == NULL) return false;
 		if (pFilename == NULL) return false;
+		QG_TRACE_SCOPE_CAT("SaveScene", "export");
 
 		bool lStatus = true;
 
@@ -213,9 +260,12 @@ namespace qg {
 		}
 
 		// Initialize the exporter by providing a filename.
-		if (lExporter->Initialize(pFilename, pFileFormat, pSdkManager->GetIOSettings()) == false)
 		{
-			return false;
+			QG_TRACE_SCOPE_CAT("FbxExporter::Initialize", "export");
+			if (lExporter->Initialize(pFilename, pFileFormat, pSdkManager->GetIOSettings()) == false)
+			{
+				return false;
+			}
 		}
 
 		// Set the export states. By default, the export states are always set to 
@@ -230,7 +280,10 @@ namespace qg {
 		IOS_REF.SetBoolProp(EXP_FBX_GLOBAL_SETTINGS, true);
 
 		// Export the scene.
-		lStatus = lExporter->Export(pScene);
+		{
+			QG_TRACE_SCOPE_CAT("FbxExporter::Export", "export");
+			lStatus = lExporter->Export(pScene);
+		}
 
 		// Destroy the exporter.
 		lExporter->Destroy();
@@ -240,23 +293,16 @@ namespace qg {
 
 	//----------------------------- CUBE GENERATOR ------------------------------------//
 
-	// create a new cube
-	void CreateGenMesh(bool pWithTexture, bool pAnimate)
+	// next cube name and position
+	GenMeshJob NextGenMeshJob()
 	{
 		// make a new cube name
-		FbxString lMeshName = "GenMesh_";
-		lMeshName += FbxString(gMeshNumber);
-
-		// create a new cube
-		CreateGenMeshDetailed(lMeshName.Buffer(),
-			gMeshXPos,
-			gMeshYPos,
-			gMeshZPos,
-
-			gMeshRotationAxis,
-			pWithTexture,
-			pAnimate
-		);
+		GenMeshJob job;
+		job.name = "GenMesh_" + to_string(gMeshNumber);
+		job.x = gMeshXPos;
+		job.y = gMeshYPos;
+		job.z = gMeshZPos;
+		job.rotateAxis = gMeshRotationAxis;
 
 		// compute for next cube creation    
 		gMeshNumber++; // cube number
@@ -277,10 +323,39 @@ namespace qg {
 		gMeshYPos += 30.0;
 
 		if (gMeshRotationAxis > 2) gMeshRotationAxis = 0; // cube rotation
+
+		return job;
+	}
+
+	void ResetGenMeshState()
+	{
+		gMeshNumber = 1;
+		gMeshRotationAxis = 1;
+		gMeshXPos = 0.0;
+		gMeshYPos = 20.0;
+		gMeshZPos = 0.0;
 	}
 
 	// create a new cube
-	void CreateGenMeshDetailed(char* pCubeName,
+	void CreateGenMesh(bool pWithTexture, bool pAnimate)
+	{
+		QG_TRACE_SCOPE("CreateGenMesh");
+		GenMeshJob job = NextGenMeshJob();
+
+		// create a new cube
+		CreateGenMeshDetailed(&job.name[0],
+			job.x,
+			job.y,
+			job.z,
+
+			job.rotateAxis,
+			pWithTexture,
+			pAnimate
+		);
+	}
+
+	// position a generated mesh node and add it under the root node
+	static void AttachGenMeshNode(FbxNode* lMeshFbxNode,
 		double pX,
 		double pY,
 		double pZ,
@@ -289,10 +364,6 @@ namespace qg {
 		bool pAnimate
 	)
 	{
-		FbxNode* lMeshFbxNode = CreateQgenDemoMesh(gScene, pCubeName);
-		//FbxNode* lCube = CreateCubeMesh(gScene, pCubeName);
-		
-
 		// set the cube position
 		lMeshFbxNode->LclTranslation.Set(FbxVector4(pX, pY, pZ));
 
@@ -312,11 +383,355 @@ namespace qg {
 		gScene->GetRootNode()->AddChild(lMeshFbxNode);
 	}
 
+	// create a new cube
+	void CreateGenMeshDetailed(char* pCubeName,
+		double pX,
+		double pY,
+		double pZ,
+		int pRotateAxe,
+		bool pWithTexture,
+		bool pAnimate
+	)
+	{
+		FbxNode* lMeshFbxNode = CreateQgenDemoMesh(gScene, pCubeName);
+		//FbxNode* lCube = CreateCubeMesh(gScene, pCubeName);
+		
+		AttachGenMeshNode(lMeshFbxNode, pX, pY, pZ, pRotateAxe, pWithTexture, pAnimate);
+	}
+
+	// create many meshes, building geometry in parallel
+	void CreateGenMeshBatch(
+		size_t count,
+		const GenMeshBuilder& builder,
+		int threadCount,
+		bool pWithTexture,
+		bool pAnimate
+	)
+	{
+		QG_TRACE_SCOPE("CreateGenMeshBatch");
+		QG_TRACE_COUNTER("GenMesh.batch", count);
+
+		// Layout: serial, same names and positions as repeated CreateGenMesh
+		vector<GenMeshJob> jobs;
+		jobs.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			jobs.push_back(NextGenMeshJob());
+		}
+
+		// Build: pure CPU, no FBX objects touched off this thread
+		// Owned here so a throw in either phase frees every mesh built
+		vector<unique_ptr<MeshStructure>> meshes(count);
+		{
+			QG_TRACE_SCOPE("GenMesh.build");
+			parallelFor(count, threadCount, [&](size_t i) {
+				QG_TRACE_SCOPE_CAT("GenMesh.buildJob", "build");
+				meshes[i].reset(builder(jobs[i]));
+			});
+		}
+		for (size_t i = 0; i < count; i++) {
+			if (!meshes[i]) throw std::runtime_error("builder returned no mesh for " + jobs[i].name);
+		}
+
+		// Commit: FBX objects created serially in job order, identical
+		// geometry shares one FbxMesh
+		QG_TRACE_SCOPE("GenMesh.commit");
+		for (size_t i = 0; i < count; i++) {
+			FbxNode* lMeshFbxNode = fbxInstance(*meshes[i], gScene, jobs[i].name.c_str(), gGeometryCache);
+			meshes[i].reset();
+			AttachGenMeshNode(lMeshFbxNode, jobs[i].x, jobs[i].y, jobs[i].z, jobs[i].rotateAxis, pWithTexture, pAnimate);
+		}
+	}
+
+	//----------------------------- BATCH JOBS ------------------------------------//
+
+	vector<GenJobSpec> ParseJobManifest(istream& in)
+	{
+		vector<GenJobSpec> jobs;
+		string line;
+		int lineNumber = 0;
+		while (std::getline(in, line)) {
+			++lineNumber;
+			std::istringstream tokens(line);
+			string token;
+			if (!(tokens >> token) || token[0] == '#') continue;
+
+			GenJobSpec job;
+			job.output = token;
+			job.line = lineNumber;
+			while (tokens >> token) {
+				size_t eq = token.find('=');
+				string key = token.substr(0, eq);
+				string value = eq == string::npos ? "" : token.substr(eq + 1);
+				try {
+					if (key == "meshes" && !value.empty()) job.meshes = std::stoi(value);
+					else if (key == "format" && !value.empty()) job.format = value;
+					else if (key == "embed" && !value.empty()) job.embed = std::stoi(value) != 0;
+					else if (token == "texture") job.texture = true;
+					else if (token == "animate") job.animate = true;
+					else throw std::invalid_argument(token);
+				}
+				catch (const std::logic_error&) {
+					throw std::runtime_error("manifest line " + to_string(lineNumber) + ": bad option '" + token + "'");
+				}
+			}
+			if (job.meshes < 0) {
+				throw std::runtime_error("manifest line " + to_string(lineNumber) + ": negative mesh count");
+			}
+			jobs.push_back(job);
+		}
+		return jobs;
+	}
+
+	// Writer format index for a manifest format name, -1 lets SaveScene pick
+	static int ResolveWriterFormat(FbxManager* pSdkManager, const string& format)
+	{
+		if (format.empty()) return -1;
+		FbxIOPluginRegistry* lRegistry = pSdkManager->GetIOPluginRegistry();
+		if (format == "binary") return lRegistry->GetNativeWriterFormat();
+		if (format == "ascii") {
+			for (int i = 0; i < lRegistry->GetWriterFormatCount(); i++) {
+				if (lRegistry->WriterIsFBX(i) && FbxString(lRegistry->GetWriterFormatDescription(i)).Find("ascii") >= 0) return i;
+			}
+			throw std::runtime_error("no ascii FBX writer");
+		}
+		return std::stoi(format);
+	}
+
+	static void LogJobResult(ostream* log, const GenJobSpec& job, const GenJobResult& result)
+	{
+		if (!log) return;
+		*log << (result.ok ? "OK   " : "FAIL ") << job.output << "  " << std::fixed << std::setprecision(2)
+			<< result.ms << " ms";
+		if (result.cached) *log << "  (cached)";
+		if (!result.error.empty()) *log << "  (line " << job.line << ": " << result.error << ")";
+		*log << endl;
+	}
+
+	vector<GenJobResult> RunJobBatch(const vector<GenJobSpec>& jobs, ostream* log, ResultCache* cache)
+	{
+		QG_TRACE_SCOPE("RunJobBatch");
+		vector<GenJobResult> results;
+		results.reserve(jobs.size());
+
+		// The SDK is initialized once, only the scene is reset per job
+		bool freshScene = false;
+		if (gSdkManager == NULL) {
+			if (!CreateScene()) throw std::runtime_error("Unable to initialize the FBX SDK");
+			freshScene = true;
+		}
+
+		for (size_t i = 0; i < jobs.size(); i++) {
+			const GenJobSpec& job = jobs[i];
+			QG_TRACE_SCOPE("GenJob");
+			GenJobResult result;
+			result.output = job.output;
+			result.ok = false;
+
+			steady_clock::time_point t0 = steady_clock::now();
+			try {
+				CacheKey key = GenJobKey(job, DEMO_MESH_BUILDER_KEY);
+				if (cache && cache->fetchFile(key, job.output)) {
+					result.ok = true;
+					result.cached = true;
+				}
+				else {
+					if (!(freshScene && i == 0) && !ResetScene()) throw std::runtime_error("scene reset failed");
+					for (int m = 0; m < job.meshes; m++) {
+						CreateGenMesh(job.texture, job.animate);
+					}
+					int lFormat = ResolveWriterFormat(gSdkManager, job.format);
+					result.ok = SaveScene(gSdkManager, gScene, job.output.c_str(), lFormat, job.embed);
+					if (!result.ok) result.error = "export failed";
+					else if (cache) cache->storeFile(key, job.output);
+				}
+			}
+			catch (const std::exception& e) {
+				result.error = e.what();
+			}
+			result.ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+
+			LogJobResult(log, job, result);
+			results.push_back(result);
+		}
+		return results;
+	}
+
+	// A job of the pipeline, built and waiting for export
+	struct GenPipelineItem {
+		size_t job;
+		vector<unique_ptr<MeshStructure>> meshes;
+		string error; // build failure
+		bool cached = false; // output copied from the result cache
+		steady_clock::time_point start;
+	};
+
+	static size_t ApproxMeshBytes(const MeshStructure& ms)
+	{
+		return ms.verts.size() * sizeof(qvec3) + ms.quadFaces.size() * sizeof(QuadFace);
+	}
+
+	vector<GenJobResult> RunJobBatchPipelined(const vector<GenJobSpec>& jobs, ostream* log, const GenPipelineOptions& options)
+	{
+		QG_TRACE_SCOPE("RunJobBatchPipelined");
+		vector<GenJobResult> results;
+		results.reserve(jobs.size());
+
+		bool freshScene = false;
+		if (gSdkManager == NULL) {
+			if (!CreateScene()) throw std::runtime_error("Unable to initialize the FBX SDK");
+			freshScene = true;
+		}
+
+		GenMeshBuilder builder = options.builder;
+		string builderKey = options.builderKey;
+		ResultCache* cache = options.cache;
+		if (!builder) {
+			builder = [](const GenMeshJob&) { return buildDemoMesh_Cube(); };
+			builderKey = DEMO_MESH_BUILDER_KEY; // quicker to build than to load
+		}
+		else if (cache && !builderKey.empty()) {
+			builder = CachedGenMeshBuilder(builder, builderKey, *cache);
+		}
+		// Unnamed builders cannot be keyed
+		if (builderKey.empty()) cache = nullptr;
+
+		// Layout: every job restarts the CreateGenMesh sequence, so one
+		// sequence as long as the largest job serves them all
+		int maxMeshes = 0;
+		for (const auto& job : jobs) maxMeshes = std::max(maxMeshes, job.meshes);
+		vector<GenMeshJob> layout;
+		ResetGenMeshState();
+		for (int m = 0; m < maxMeshes; m++) layout.push_back(NextGenMeshJob());
+		ResetGenMeshState();
+
+		// Build: pure CPU on the producer and its workers
+		BoundedQueue<GenPipelineItem> queue(options.queueDepth, options.maxQueuedBytes);
+		std::thread producer([&]() {
+			for (size_t i = 0; i < jobs.size(); i++) {
+				GenPipelineItem item;
+				item.job = i;
+				item.start = steady_clock::now();
+				size_t bytes = 0;
+				try {
+					if (cache && cache->fetchFile(GenJobKey(jobs[i], builderKey), jobs[i].output)) {
+						item.cached = true;
+						if (!queue.push(std::move(item), 0)) return;
+						continue;
+					}
+					QG_TRACE_SCOPE_CAT("Pipeline.build", "pipeline");
+					item.meshes.resize(jobs[i].meshes);
+					parallelFor(item.meshes.size(), options.threads, [&](size_t m) {
+						item.meshes[m].reset(builder(layout[m]));
+					});
+					for (const auto& ms : item.meshes) {
+						if (!ms) throw std::runtime_error("builder returned no mesh");
+					}
+					for (const auto& ms : item.meshes) bytes += ApproxMeshBytes(*ms);
+				}
+				catch (const std::exception& e) {
+					item.meshes.clear();
+					item.error = e.what();
+				}
+				catch (...) {
+					item.meshes.clear();
+					item.error = "mesh build failed";
+				}
+				QG_TRACE_SCOPE_CAT("Pipeline.waitSpace", "pipeline");
+				if (!queue.push(std::move(item), bytes)) return;
+			}
+			queue.close();
+		});
+
+		// Commit and export: FBX objects on this thread only, in job order
+		try {
+			GenPipelineItem item;
+			for (;;) {
+				{
+					QG_TRACE_SCOPE_CAT("Pipeline.waitItem", "pipeline");
+					if (!queue.pop(item)) break;
+				}
+				QG_TRACE_COUNTER("Pipeline.queued", queue.size());
+				const GenJobSpec& job = jobs[item.job];
+				QG_TRACE_SCOPE("GenJob");
+				GenJobResult result;
+				result.output = job.output;
+				result.ok = false;
+
+				try {
+					if (!item.error.empty()) throw std::runtime_error(item.error);
+					if (item.cached) {
+						result.ok = true;
+						result.cached = true;
+					}
+					else {
+						if (!(freshScene && item.job == 0) && !ResetScene()) throw std::runtime_error("scene reset failed");
+						for (size_t m = 0; m < item.meshes.size(); m++) {
+							FbxNode* lMeshFbxNode = fbxInstance(*item.meshes[m], gScene, layout[m].name.c_str(), gGeometryCache);
+							item.meshes[m].reset();
+							AttachGenMeshNode(lMeshFbxNode, layout[m].x, layout[m].y, layout[m].z, layout[m].rotateAxis, job.texture, job.animate);
+						}
+						int lFormat = ResolveWriterFormat(gSdkManager, job.format);
+						result.ok = SaveScene(gSdkManager, gScene, job.output.c_str(), lFormat, job.embed);
+						if (!result.ok) result.error = "export failed";
+						else if (cache) cache->storeFile(GenJobKey(job, builderKey), job.output);
+					}
+				}
+				catch (const std::exception& e) {
+					result.error = e.what();
+				}
+				result.ms = duration<double, std::milli>(steady_clock::now() - item.start).count();
+
+				LogJobResult(log, job, result);
+				results.push_back(result);
+			}
+		}
+		catch (...) {
+			queue.close();
+			producer.join();
+			throw;
+		}
+		producer.join();
+		return results;
+	}
+
+	void PrintJobBatchSummary(const vector<GenJobResult>& results, double wallMs, ostream& out)
+	{
+		vector<double> latencies;
+		size_t failures = 0;
+		size_t cached = 0;
+		for (const auto& r : results) {
+			latencies.push_back(r.ms);
+			if (!r.ok) ++failures;
+			if (r.cached) ++cached;
+		}
+		std::sort(latencies.begin(), latencies.end());
+		auto percentile = [&](double p) {
+			if (latencies.empty()) return 0.0;
+			size_t k = (size_t)std::ceil(p * latencies.size());
+			return latencies[k == 0 ? 0 : k - 1];
+		};
+
+		out << std::fixed << std::setprecision(2);
+		out << "Jobs: " << results.size() << ", failed: " << failures << ", cached: " << cached
+			<< ", wall: " << wallMs << " ms, throughput: "
+			<< (wallMs > 0.0 ? results.size() * 1000.0 / wallMs : 0.0) << " jobs/s" << endl;
+		out << "Latency ms p50: " << percentile(0.50) << ", p95: " << percentile(0.95)
+			<< ", max: " << (latencies.empty() ? 0.0 : latencies.back()) << endl;
+	}
 
 	FbxNode* CreateQgenDemoMesh(FbxScene* pScene, char* pName) {
+		QG_TRACE_SCOPE("CreateQgenDemoMesh");
 
-		MeshStructure* meshStructure = buildDemoMesh_Cube();
-		FbxNode* node = fbxTransform(*meshStructure, pScene, pName);
+		// Build in a throwaway arena: every container allocation comes from
+		// one block, released when the arena goes out of scope
+		MonotonicArena arena(16 * 1024);
+		MeshStructure* meshStructure;
+		{
+			ScopedMemoryResource scope(&arena);
+			meshStructure = buildDemoMesh_Cube();
+		}
+		// Every demo cube instances one shared FbxMesh
+		FbxNode* node = fbxInstance(*meshStructure, pScene, pName, gGeometryCache);
 		delete meshStructure;
 		return node;
 	}
@@ -372,44 +787,3 @@ namespace qg {
 		//test_vertMerge_1();
 	}
 }
-
-
-#ifdef TEST_MODE
-//qg::invokeTests();
-#else
-
-int main(int argc, const char* argv[])
-{
-
-	cout << "QGEN Version 0.0.5";
-	std::string outFileName = "mgen_";
-	milliseconds ms = duration_cast< milliseconds >(system_clock::now().time_since_epoch());
-
-	if (argc > 1) {
-		outFileName += argv[1] + string("_") + to_string(ms.count()) + ".fbx";
-	}
-	else {
-		cout << "No args: Using default file name: ";
-		/*outFileName += to_string(ms.count()) + ".fbx";*/
-		outFileName += "mesh.fbx";
-	}
-	cout << outFileName << endl;
-
-	qg::CreateScene();
-	// create a new cube with option selected
-	//args bool (lWithTexture, lWithAnimation);
-	qg::CreateGenMesh(false, false);
-	//qg::CreateGenMesh2(false, false);
-
-	//char gszOutputFile[_MAX_PATH];           // File name to export
-	int  gWriteFileFormat = -1;             // Write file format
-
-	qg::Export(outFileName.c_str(), gWriteFileFormat);
-
-	// dont forget to delete the SdkManager 
-	// and all objects created by the SDK manager
-	qg::DestroySdkObjects(qg::gSdkManager, true);
-
-	
-}
-#endif
\ No newline at end of file
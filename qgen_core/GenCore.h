@@ -1,8 +1,16 @@
 #pragma once
 // use the fbxsdk.h
 #include "BaseWrapper.h"
+#include "MeshStructure.h"
+#include <functional>
 using namespace std;
 namespace qg {
+	class ResultCache;
+
+	// SDK manager and scene used by CreateScene, CreateGenMesh and Export
+	extern FbxManager* gSdkManager;
+	extern FbxScene* gScene;
+
 	// to create an instance of the SDK manager
 	bool InitializeSdkObjects(
 		FbxManager*& pSdkManager,
@@ -33,6 +41,12 @@ namespace qg {
 	// to create a basic scene
 	bool CreateScene();
 
+	// to start a new empty scene on the existing SDK manager
+	bool ResetScene();
+
+	// add the default marker and camera to gScene
+	void PopulateScene();
+
 	// Create a marker to use a point of interest for the camera. 
 	FbxNode* CreateMarker(
 		FbxScene* pScene,
@@ -79,6 +93,106 @@ namespace qg {
 
 	FbxNode* CreateQgenDemoMesh(FbxScene* pScene, char* pName);
 
+	// Name and placement of one generated mesh
+	struct GenMeshJob {
+		string name;
+		double x;
+		double y;
+		double z;
+		int rotateAxis;
+	};
+
+	// Builds the MeshStructure for a job. Called from worker threads:
+	// pure CPU, must not touch FBX objects or global state. Must not
+	// return NULL: batch callers fail with "builder returned no mesh"
+	typedef function<MeshStructure*(const GenMeshJob&)> GenMeshBuilder;
+
+	// Next name / placement in the CreateGenMesh sequence, advances the
+	// global counters
+	GenMeshJob NextGenMeshJob();
+
+	// Restart the CreateGenMesh naming and placement sequence
+	void ResetGenMeshState();
+
+	// Create count meshes: jobs are laid out serially in CreateGenMesh
+	// order, MeshStructures are built in parallel on threadCount threads,
+	// then attached to the scene in job order on the calling thread.
+	// Output is identical for any thread count. Throws runtime_error,
+	// before touching the scene, if the builder returns NULL
+	void CreateGenMeshBatch(
+		size_t count,
+		const GenMeshBuilder& builder,
+		int threadCount,
+		bool pWithTexture,
+		bool pAnim
+	);
+
+	//------------------BATCH JOBS---------------------//
+
+	// One output file of a batch manifest
+	struct GenJobSpec {
+		string output;
+		int meshes = 1;        // CreateGenMesh calls
+		string format;         // "", "binary", "ascii" or a writer format index
+		bool texture = false;
+		bool animate = false;
+		bool embed = true;     // as Export
+		int line = 0;          // manifest line, for messages
+	};
+
+	struct GenJobResult {
+		string output;
+		bool ok;
+		double ms;             // reset + generation + export
+		string error;
+		bool cached = false;   // copied from the result cache
+	};
+
+	// Line based manifest, one job per line:
+	//   <output.fbx> [meshes=N] [format=binary|ascii|N] [texture] [animate] [embed=0|1]
+	// Blank lines and lines starting with '#' are skipped. Throws
+	// runtime_error naming the line of a malformed entry
+	vector<GenJobSpec> ParseJobManifest(istream& in);
+
+	// Runs jobs back to back on one FbxManager and FbxIOSettings (created if
+	// needed, left alive for DestroySdkObjects), with a fresh scene and
+	// CreateGenMesh sequence per job. A failed job is reported in its
+	// result and the batch goes on. Per job lines go to log if not NULL.
+	// With a cache, a job whose file is cached (GenJobKey) is copied from
+	// it with no scene work, and exported files are stored
+	vector<GenJobResult> RunJobBatch(const vector<GenJobSpec>& jobs, ostream* log, ResultCache* cache = NULL);
+
+	struct GenPipelineOptions {
+		int threads = 0;                          // build threads, hardware concurrency if <= 0
+		size_t queueDepth = 2;                    // built jobs waiting for export
+		size_t maxQueuedBytes = 256 * 1024 * 1024; // built geometry waiting for export, 0 = no limit
+		GenMeshBuilder builder;                   // demo cube if empty
+		// Exported files are cached as in RunJobBatch when the builder is
+		// the default or named by builderKey; a named builder also has its
+		// meshes cached (CachedGenMeshBuilder)
+		ResultCache* cache = nullptr;
+		string builderKey;
+	};
+
+	// RunJobBatch with generation overlapped with export: a producer thread
+	// builds the MeshStructures of the next jobs (on options.threads
+	// workers) while the calling thread commits the current job to a fresh
+	// scene and writes it. Built jobs wait in a BoundedQueue, bounded by
+	// queueDepth and maxQueuedBytes. FBX objects are only touched on the
+	// calling thread. Same scenes and files as RunJobBatch; a job's ms runs
+	// from the start of its build to the end of its export
+	vector<GenJobResult> RunJobBatchPipelined(
+		const vector<GenJobSpec>& jobs,
+		ostream* log,
+		const GenPipelineOptions& options = GenPipelineOptions()
+	);
+
+	// builderKey of the demo cube built by CreateGenMesh
+	extern const char* const DEMO_MESH_BUILDER_KEY;
+
+	// Jobs, failures, cache hits, wall time, throughput and latency percentiles
+	void PrintJobBatchSummary(const vector<GenJobResult>& results, double wallMs, ostream& out);
+
 	//------------------TEMP TESTS---------------------//
 	void testPositionRadialSpreader();
 
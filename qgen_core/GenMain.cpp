@@ -0,0 +1,151 @@
+// Command line entry point of qgen_core. Kept apart from GenCore.cpp so
+// other executables (qgen_bench) can link the generator without it
+#include "GenCore.h"
+#include "GenServer.h"
+#include "ResultCache.h"
+#include "TraceLib.h"
+#include "CoreTester.h"
+#include <fstream>
+#include <memory>
+
+using namespace std::chrono;
+using namespace std;
+
+#ifdef TEST_MODE
+//qg::invokeTests();
+#else
+
+int main(int argc, const char* argv[])
+{
+
+	cout << "QGEN Version " QGEN_VERSION;
+	std::string outFileName = "mgen_";
+	milliseconds ms = duration_cast< milliseconds >(system_clock::now().time_since_epoch());
+
+	// --trace <file.json> records phase timings as a Chrome trace and
+	// prints a summary, --batch <manifest> runs every job of a manifest
+	// (see ParseJobManifest) in this process, overlapping generation with
+	// export when --pipeline is given, --serve keeps the SDK warm
+	// and handles requests from stdin, or from a UNIX domain socket with
+	// --socket <path> (see GenServer). --cache <dir> keeps exported files
+	// in a result cache (see ResultCache) for --batch and --serve, bounded
+	// by --cache-mb <N> (1024 by default). The remaining args keep their
+	// positions
+	std::string traceFileName;
+	std::string manifestFileName;
+	std::string socketPath;
+	std::string cacheDir;
+	uint64_t cacheMb = 1024;
+	bool serve = false;
+	bool pipeline = false;
+	vector<const char*> args;
+	for (int i = 0; i < argc; i++) {
+		if (string(argv[i]) == "--trace" && i + 1 < argc) traceFileName = argv[++i];
+		else if (string(argv[i]) == "--batch" && i + 1 < argc) manifestFileName = argv[++i];
+		else if (string(argv[i]) == "--pipeline") pipeline = true;
+		else if (string(argv[i]) == "--serve") serve = true;
+		else if (string(argv[i]) == "--socket" && i + 1 < argc) socketPath = argv[++i];
+		else if (string(argv[i]) == "--cache" && i + 1 < argc) cacheDir = argv[++i];
+		else if (string(argv[i]) == "--cache-mb" && i + 1 < argc) cacheMb = std::strtoull(argv[++i], NULL, 10);
+		else args.push_back(argv[i]);
+	}
+	argc = (int)args.size();
+	argv = args.data();
+	qg::traceEnable(!traceFileName.empty());
+
+	std::unique_ptr<qg::ResultCache> cache;
+	if (!cacheDir.empty()) {
+		cache.reset(new qg::ResultCache(cacheDir, cacheMb * 1024 * 1024));
+		std::string error;
+		if (!cache->open(&error)) {
+			cout << endl << error << endl;
+			return 1;
+		}
+	}
+
+	if (serve) {
+		cout << endl;
+		qg::GenServer server;
+		server.setResultCache(cache.get());
+		bool ok = server.warmUp(cout);
+		if (ok && socketPath.empty()) server.serveStream(std::cin, cout);
+		else if (ok) ok = server.serveUnixSocket(socketPath, 0, cout);
+		qg::DestroySdkObjects(qg::gSdkManager, false);
+		if (!traceFileName.empty()) {
+			qg::tracePrintSummary(cerr);
+			if (!qg::traceWriteChrome(traceFileName)) cerr << "Failed to write trace " << traceFileName << endl;
+		}
+		return ok ? 0 : 1;
+	}
+
+	if (!manifestFileName.empty()) {
+		cout << endl;
+		std::ifstream manifest(manifestFileName);
+		if (!manifest) {
+			cout << "Unable to open manifest " << manifestFileName << endl;
+			return 1;
+		}
+		vector<qg::GenJobResult> results;
+		steady_clock::time_point t0 = steady_clock::now();
+		try {
+			vector<qg::GenJobSpec> jobs = qg::ParseJobManifest(manifest);
+			if (pipeline) {
+				qg::GenPipelineOptions options;
+				options.cache = cache.get();
+				results = qg::RunJobBatchPipelined(jobs, &cout, options);
+			}
+			else results = qg::RunJobBatch(jobs, &cout, cache.get());
+		}
+		catch (const std::exception& e) {
+			cout << e.what() << endl;
+			qg::DestroySdkObjects(qg::gSdkManager, false);
+			return 1;
+		}
+		double wallMs = duration<double, std::milli>(steady_clock::now() - t0).count();
+		qg::DestroySdkObjects(qg::gSdkManager, false);
+
+		qg::PrintJobBatchSummary(results, wallMs, cout);
+		if (cache) qg::PrintResultCacheStats(cache->stats(), cout);
+		if (!traceFileName.empty()) {
+			qg::tracePrintSummary(cout);
+			if (!qg::traceWriteChrome(traceFileName)) cout << "Failed to write trace " << traceFileName << endl;
+		}
+		for (const auto& r : results) {
+			if (!r.ok) return 1;
+		}
+		return 0;
+	}
+
+	if (argc > 1) {
+		outFileName += argv[1] + string("_") + to_string(ms.count()) + ".fbx";
+	}
+	else {
+		cout << "No args: Using default file name: ";
+		/*outFileName += to_string(ms.count()) + ".fbx";*/
+		outFileName += "mesh.fbx";
+	}
+	cout << outFileName << endl;
+
+	qg::CreateScene();
+	// create a new cube with option selected
+	//args bool (lWithTexture, lWithAnimation);
+	qg::CreateGenMesh(false, false);
+	//qg::CreateGenMesh2(false, false);
+
+	//char gszOutputFile[_MAX_PATH];           // File name to export
+	int  gWriteFileFormat = -1;             // Write file format
+
+	qg::Export(outFileName.c_str(), gWriteFileFormat);
+
+	// dont forget to delete the SdkManager 
+	// and all objects created by the SDK manager
+	qg::DestroySdkObjects(qg::gSdkManager, true);
+
+	if (!traceFileName.empty()) {
+		qg::tracePrintSummary(cout);
+		if (!qg::traceWriteChrome(traceFileName)) cout << "Failed to write trace " << traceFileName << endl;
+	}
+
+	
+}
+#endif
\ No newline at end of file
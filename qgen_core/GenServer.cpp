@@ -0,0 +1,252 @@
+#include "GenServer.h"
+#include "ResultCache.h"
+#include "TraceLib.h"
+#include <cerrno>
+#include <iomanip>
+#include <sstream>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace qg {
+
+	// ===================== GENERATOR SERVER ====================== //
+
+	GenServer::GenServer(size_t latencyWindow) : latency_window(latencyWindow ? latencyWindow : 1) {
+	}
+
+	static void writeReady(ostream& out) {
+		out << "READY qgen " QGEN_VERSION << endl;
+	}
+
+	bool GenServer::warmUp(ostream& out) {
+		if (gSdkManager == NULL && !CreateScene()) {
+			out << "ERR - Unable to initialize the FBX SDK" << endl;
+			return false;
+		}
+		writeReady(out);
+		return true;
+	}
+
+	void GenServer::recordLatency(double ms) {
+		if (latencies.size() < latency_window) {
+			latencies.push_back(ms);
+			return;
+		}
+		latencies[latency_next] = ms;
+		latency_next = (latency_next + 1) % latency_window;
+	}
+
+	double GenServer::latencyPercentile(double p) const {
+		if (latencies.empty()) return 0.0;
+		vector<double> sorted(latencies);
+		std::sort(sorted.begin(), sorted.end());
+		size_t k = (size_t)std::ceil(p * sorted.size());
+		return sorted[k == 0 ? 0 : std::min(k, sorted.size()) - 1];
+	}
+
+	bool GenServer::handleLine(const string& line, ostream& out) {
+		std::istringstream tokens(line);
+		string command;
+		if (!(tokens >> command) || command[0] == '#') return true;
+
+		if (command == "PING") {
+			out << "PONG" << endl;
+			return true;
+		}
+		if (command == "STATS") {
+			out << std::fixed << std::setprecision(3) << "STATS jobs=" << jobs << " failed=" << failed
+				<< " p50=" << latencyPercentile(0.50) << " p95=" << latencyPercentile(0.95)
+				<< " p99=" << latencyPercentile(0.99) << " max=" << latencyPercentile(1.0);
+			if (cache) {
+				ResultCacheStats cacheStats = cache->stats();
+				out << " cache_hits=" << cacheStats.hits << " cache_misses=" << cacheStats.misses;
+			}
+			out << endl;
+			return true;
+		}
+		if (command == "QUIT" || command == "SHUTDOWN") {
+			shutdown = command == "SHUTDOWN";
+			out << "BYE" << endl;
+			return false;
+		}
+
+		QG_TRACE_SCOPE("GenServer::request");
+		++jobs;
+		vector<GenJobSpec> specs;
+		try {
+			std::istringstream request(line);
+			specs = ParseJobManifest(request);
+		}
+		catch (const std::exception& e) {
+			++failed;
+			out << "ERR - " << e.what() << endl;
+			return true;
+		}
+
+		// Same path as a one job batch: warm manager, fresh scene
+		vector<GenJobResult> results = RunJobBatch(specs, NULL, cache);
+		const GenJobResult& r = results[0];
+		recordLatency(r.ms);
+		if (r.ok) {
+			out << "OK " << r.output << " " << std::fixed << std::setprecision(3) << r.ms << endl;
+		}
+		else {
+			++failed;
+			out << "ERR " << r.output << " " << r.error << endl;
+		}
+		return true;
+	}
+
+	void GenServer::serveStream(istream& in, ostream& out) {
+		string line;
+		while (std::getline(in, line)) {
+			if (line.size() > max_line) {
+				out << "ERR - line too long" << endl;
+				continue;
+			}
+			if (!handleLine(line, out)) break;
+		}
+	}
+
+#ifndef _WIN32
+	static bool sendAll(int fd, const string& data) {
+		int flags = 0;
+#ifdef MSG_NOSIGNAL
+		flags = MSG_NOSIGNAL; // a vanished client must not kill the server
+#endif
+		size_t sent = 0;
+		while (sent < data.size()) {
+			ssize_t n = send(fd, data.data() + sent, data.size() - sent, flags);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+			sent += (size_t)n;
+		}
+		return true;
+	}
+
+	// One session over a connected socket, responses are sent per line
+	static void serveConnection(GenServer& server, int fd) {
+		std::ostringstream ready;
+		writeReady(ready);
+		if (!sendAll(fd, ready.str())) return;
+
+		// At most one line is buffered: a client that never sends a newline
+		// gets an error, the rest of its line is dropped as it arrives
+		const string tooLong = "ERR - line too long\n";
+		const size_t maxLine = server.maxLineLength();
+		bool dropping = false;
+		string pending;
+		char buffer[4096];
+		for (;;) {
+			ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return;
+			pending.append(buffer, (size_t)n);
+
+			size_t start = 0;
+			size_t eol;
+			while ((eol = pending.find('\n', start)) != string::npos) {
+				const size_t length = eol - start;
+				const size_t lineStart = start;
+				start = eol + 1;
+				if (dropping) {
+					dropping = false;
+					continue;
+				}
+				if (length > maxLine) {
+					if (!sendAll(fd, tooLong)) return;
+					continue;
+				}
+				string line = pending.substr(lineStart, length);
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+				std::ostringstream response;
+				bool more = server.handleLine(line, response);
+				if (!sendAll(fd, response.str()) || !more) return;
+			}
+			pending.erase(0, start);
+			if (dropping) pending.clear();
+			else if (pending.size() > maxLine) {
+				if (!sendAll(fd, tooLong)) return;
+				dropping = true;
+				pending.clear();
+			}
+		}
+	}
+#endif
+
+#ifndef _WIN32
+	// Removes path only if it is a socket: a mistyped --serve path must
+	// never delete a regular file. A missing path is fine
+	static bool unlinkSocketFile(const string& path, ostream& log) {
+		struct stat st;
+		if (lstat(path.c_str(), &st) < 0) {
+			if (errno == ENOENT) return true;
+			log << "lstat " << path << ": " << strerror(errno) << endl;
+			return false;
+		}
+		if (!S_ISSOCK(st.st_mode)) {
+			log << "Not a socket, refusing to remove: " << path << endl;
+			return false;
+		}
+		if (unlink(path.c_str()) < 0 && errno != ENOENT) {
+			log << "unlink " << path << ": " << strerror(errno) << endl;
+			return false;
+		}
+		return true;
+	}
+#endif
+
+	bool GenServer::serveUnixSocket(const string& path, size_t maxConnections, ostream& log) {
+#ifdef _WIN32
+		log << "UNIX domain sockets are not supported on this platform" << endl;
+		return false;
+#else
+		sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(addr.sun_path)) {
+			log << "Socket path too long: " << path << endl;
+			return false;
+		}
+		strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+		// A stale socket file from a previous run blocks bind
+		if (!unlinkSocketFile(path, log)) return false;
+
+		int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener < 0) {
+			log << "socket: " << strerror(errno) << endl;
+			return false;
+		}
+		if (bind(listener, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listener, 8) < 0) {
+			log << "bind/listen " << path << ": " << strerror(errno) << endl;
+			close(listener);
+			return false;
+		}
+		log << "Listening on " << path << endl;
+
+		bool ok = true;
+		size_t served = 0;
+		shutdown = false;
+		while (!shutdown && (maxConnections == 0 || served < maxConnections)) {
+			int client = accept(listener, NULL, NULL);
+			if (client < 0) {
+				if (errno == EINTR) continue;
+				log << "accept: " << strerror(errno) << endl;
+				ok = false;
+				break;
+			}
+			serveConnection(*this, client);
+			close(client);
+			++served;
+		}
+		close(listener);
+		if (!unlinkSocketFile(path, log)) ok = false;
+		return ok;
+#endif
+	}
+	// =================== end GENERATOR SERVER ==================== //
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "GenCore.h"
+
+using namespace std;
+
+namespace qg {
+
+	// GENERATOR SERVER
+	// Long running mode keeping the FBX SDK manager warm between requests.
+	// Line protocol, one request per line, one response line per request:
+	//   <job line>  same syntax as a batch manifest line (ParseJobManifest)
+	//               -> "OK <output> <ms>" or "ERR <output|-> <message>"
+	//   PING        -> "PONG"
+	//   STATS       -> "STATS jobs=N failed=N p50=ms p95=ms p99=ms max=ms",
+	//                  then " cache_hits=N cache_misses=N" with a cache
+	//   QUIT        -> "BYE", ends the session
+	//   SHUTDOWN    -> "BYE", ends the session and the socket server
+	// Blank and '#' lines get no response. A line longer than
+	// maxLineLength() gets "ERR - line too long" and is skipped; sockets
+	// never buffer more than that per client. Every session starts with a
+	// "READY ..." line once the SDK is warm; clients skip anything before
+	// it (the SDK prints a banner on stdout).
+	// Requests are handled one at a time: the SDK objects are global.
+	class GenServer {
+	public:
+		// Latencies kept for the percentiles, oldest dropped first
+		explicit GenServer(size_t latencyWindow = 100000);
+
+		// Jobs go through cache (see RunJobBatch), NULL for none
+		void setResultCache(ResultCache* pCache) { cache = pCache; };
+
+		// Longest request line accepted, 64 KiB by default
+		void setMaxLineLength(size_t length) { max_line = length; };
+		size_t maxLineLength() const { return max_line; };
+
+		// Initializes the SDK (if needed) and writes the READY line
+		bool warmUp(ostream& out);
+
+		// Handles one request line, returns false after QUIT
+		bool handleLine(const string& line, ostream& out);
+
+		// Serves a session until QUIT or end of input
+		void serveStream(istream& in, ostream& out);
+
+		// Listens on a UNIX domain socket, one connection at a time, each
+		// connection is a session. Returns after maxConnections sessions
+		// (0 = forever), on a SHUTDOWN line, or false on a socket error
+		// (always false where UNIX sockets are unavailable). A stale socket
+		// at path is replaced; any other file there fails with false and is
+		// left untouched
+		bool serveUnixSocket(const string& path, size_t maxConnections, ostream& log);
+
+		size_t jobCount() const { return jobs; };
+		size_t failedCount() const { return failed; };
+		// Latency at fraction p of the window (0.5 = median), 0 if empty
+		double latencyPercentile(double p) const;
+
+	private:
+		size_t latency_window;
+		vector<double> latencies; // ring buffer once full
+		size_t latency_next = 0;
+		size_t jobs = 0;
+		size_t failed = 0;
+		bool shutdown = false;
+		size_t max_line = 64 * 1024;
+		ResultCache* cache = NULL;
+
+		void recordLatency(double ms);
+	};
+}
@@ -1,5 +1,10 @@
 #pragma once
 #include "BaseWrapper.h"
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
 
 namespace qg {
 	// GENERIC UTILS
@@ -12,5 +17,37 @@ namespace qg {
 		seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 	}
 
+	// Allocator returning Align-byte aligned storage, used for SIMD friendly
+	// attribute streams. Align must be a power of two >= sizeof(void*)
+	template <class T, size_t Align>
+	struct AlignedAllocator {
+		typedef T value_type;
+		template <class U> struct rebind { typedef AlignedAllocator<U, Align> other; };
+
+		AlignedAllocator() {}
+		template <class U> AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+		T* allocate(size_t n) {
+			if (n == 0) return nullptr;
+			void* p = nullptr;
+#ifdef _WIN32
+			p = _aligned_malloc(n * sizeof(T), Align);
+#else
+			if (posix_memalign(&p, Align, n * sizeof(T)) != 0) p = nullptr;
+#endif
+			if (!p) throw std::bad_alloc();
+			return static_cast<T*>(p);
+		}
+		void deallocate(T* p, size_t) {
+#ifdef _WIN32
+			_aligned_free(p);
+#else
+			free(p);
+#endif
+		}
+		template <class U> bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+		template <class U> bool operator!=(const AlignedAllocator<U, Align>&) const { return false; }
+	};
+
 	// end GENERIC UTILS
 }
\ No newline at end of file
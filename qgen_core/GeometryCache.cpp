@@ -0,0 +1,45 @@
+#include "GeometryCache.h"
+#include "TraceLib.h"
+
+namespace qg {
+
+	// ====================== GEOMETRY CACHE ======================= //
+
+	FbxMesh* GeometryCache::getOrCreate(const MeshStructure& ms, FbxScene* pScene, const char* pName) {
+		QG_TRACE_SCOPE_CAT("GeometryCache::getOrCreate", "fbx");
+		uint64_t key = meshContentHash(ms);
+		auto range = entries.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second.scene == pScene && meshContentEqual(it->second.geometry, ms)) {
+				++hits;
+				QG_TRACE_COUNTER("geometryCache.hits", hits);
+				return it->second.mesh;
+			}
+		}
+
+		++misses;
+		QG_TRACE_COUNTER("geometryCache.misses", misses);
+		// Entries outlive any generation arena the caller may have active
+		ScopedMemoryResource heap(heapResource());
+		Entry entry;
+		entry.scene = pScene;
+		entry.geometry.verts = ms.verts;
+		entry.geometry.quadFaces = ms.quadFaces;
+		entry.mesh = fbxTransformMesh(ms, pScene, pName, options);
+		FbxMesh* lMesh = entry.mesh;
+		entries.insert(std::make_pair(key, std::move(entry)));
+		return lMesh;
+	}
+
+	void GeometryCache::clear() {
+		entries.clear();
+		hits = 0;
+		misses = 0;
+	}
+
+	FbxNode* fbxInstance(const MeshStructure& ms, FbxScene* pScene, const char* pName, GeometryCache& cache) {
+		FbxMesh* lMesh = cache.getOrCreate(ms, pScene, pName);
+		return fbxCreateMeshNode(lMesh, pScene, pName);
+	}
+	// ==================== end GEOMETRY CACHE ===================== //
+}
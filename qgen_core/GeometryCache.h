@@ -0,0 +1,42 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "MeshStructure.h"
+#include "FBXTransformer.h"
+
+using namespace std;
+
+namespace qg {
+
+	// INSTANCED GEOMETRY CACHE
+	// Maps MeshStructure content to one FbxMesh per scene, so identical
+	// generated meshes become FbxNodes sharing a single mesh attribute
+	// (same technique as samples/Instances). Lookups hash the content
+	// (meshContentHash) and confirm hits with meshContentEqual against a
+	// stored copy, so a hash collision never shares the wrong geometry.
+	// Entries hold scene-owned FbxMesh pointers: clear() whenever a scene
+	// is destroyed.
+	class GeometryCache {
+	public:
+		FbxTransformOptions options;
+
+		// Shared FbxMesh for ms in pScene, created on first use
+		FbxMesh* getOrCreate(const MeshStructure& ms, FbxScene* pScene, const char* pName);
+		void clear();
+
+		size_t size() const { return entries.size(); };
+		size_t hits = 0;
+		size_t misses = 0;
+
+	private:
+		struct Entry {
+			FbxScene* scene;
+			MeshStructure geometry; // verts and faces only, for hit verification
+			FbxMesh* mesh;
+		};
+		unordered_multimap<uint64_t, Entry> entries;
+	};
+
+	// Node named pName instancing the cached mesh for ms
+	FbxNode* fbxInstance(const MeshStructure& ms, FbxScene* pScene, const char* pName, GeometryCache& cache);
+}
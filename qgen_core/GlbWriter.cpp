@@ -0,0 +1,344 @@
+#include "GlbWriter.h"
+#include "TraceLib.h"
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace qg {
+
+	// ========================= GLB LAYOUT ======================== //
+
+	static const uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+	static const uint32_t GLB_VERSION = 2;
+	static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+	static const uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+	static const int GLTF_UNSIGNED_SHORT = 5123;
+	static const int GLTF_UNSIGNED_INT = 5125;
+	static const int GLTF_FLOAT = 5126;
+	static const int GLTF_ARRAY_BUFFER = 34962;
+	static const int GLTF_ELEMENT_ARRAY_BUFFER = 34963;
+
+	static size_t align4(size_t n) {
+		return (n + 3) & ~(size_t)3;
+	}
+
+	// What is written for one mesh, decided before the first byte goes out
+	struct GlbMeshLayout {
+		bool shared;         // verts written as is, indexed by QuadFace::indices
+		bool normals;
+		bool uvs;
+		bool wide_indices;   // uint32 rather than uint16
+		size_t vertex_count;
+		size_t index_count;
+		qvec3 min;
+		qvec3 max;
+		// BIN chunk offsets
+		size_t positions;
+		size_t normals_offset;
+		size_t uvs_offset;
+		size_t indices;
+	};
+
+	static bool sameVec(const qvec3& a, const qvec3& b) {
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	// Exact compare: every corner of a vert carries the same normal and UV
+	static bool cornersAgree(const MeshStructure& ms, bool normals, bool uvs) {
+		vector<int> first(ms.verts.size(), -1);
+		const QuadFace* lFaces = ms.quadFaces.data();
+		for (size_t f = 0; f < ms.quadFaces.size(); f++) {
+			for (int c = 0; c < 4; c++) {
+				const int v = lFaces[f].indices[c];
+				const int k = (int)f * 4 + c;
+				if (first[v] < 0) {
+					first[v] = k;
+					continue;
+				}
+				const QuadFace& qf = lFaces[first[v] / 4];
+				const int fc = first[v] % 4;
+				if (normals && !sameVec(qf.normals[fc], lFaces[f].normals[c])) return false;
+				if (uvs && !(qf.uvs[fc] == lFaces[f].uvs[c])) return false;
+			}
+		}
+		return true;
+	}
+
+	static void growBounds(GlbMeshLayout& layout, const qvec3& v) {
+		layout.min = { std::min(layout.min.x, v.x), std::min(layout.min.y, v.y), std::min(layout.min.z, v.z) };
+		layout.max = { std::max(layout.max.x, v.x), std::max(layout.max.y, v.y), std::max(layout.max.z, v.z) };
+	}
+
+	// Lays the mesh out from offset on, returns the offset past its data
+	static size_t planMesh(const MeshStructure& ms, const GlbWriterOptions& options, size_t offset, GlbMeshLayout& layout) {
+		memset(&layout, 0, sizeof(layout));
+		if (ms.quadFaces.empty()) return offset;
+		layout.normals = options.normals;
+		layout.uvs = options.uvs;
+		for (const auto& qf : ms.quadFaces) {
+			layout.normals = layout.normals && qf.has_normals;
+			layout.uvs = layout.uvs && qf.has_uvs;
+		}
+		layout.shared = options.share_verts && cornersAgree(ms, layout.normals, layout.uvs);
+		layout.vertex_count = layout.shared ? ms.verts.size() : ms.quadFaces.size() * 4;
+		layout.index_count = ms.quadFaces.size() * 6;
+		// 65535 is the primitive restart value, never a valid uint16 index
+		layout.wide_indices = layout.vertex_count > 65535;
+
+		const float inf = std::numeric_limits<float>::infinity();
+		layout.min = { inf, inf, inf };
+		layout.max = { -inf, -inf, -inf };
+		if (layout.shared) {
+			for (const auto& v : ms.verts) growBounds(layout, v);
+		}
+		else {
+			for (const auto& qf : ms.quadFaces) {
+				for (int c = 0; c < 4; c++) growBounds(layout, ms.verts[qf.indices[c]]);
+			}
+		}
+
+		layout.positions = offset;
+		offset = align4(offset + layout.vertex_count * 12);
+		layout.normals_offset = offset;
+		if (layout.normals) offset = align4(offset + layout.vertex_count * 12);
+		layout.uvs_offset = offset;
+		if (layout.uvs) offset = align4(offset + layout.vertex_count * 8);
+		layout.indices = offset;
+		offset = align4(offset + layout.index_count * (layout.wide_indices ? 4 : 2));
+		return offset;
+	}
+	// ======================= end GLB LAYOUT ====================== //
+
+	// ========================== GLB JSON ========================= //
+
+	static void writeJsonString(ostream& out, const string& s) {
+		out << '"';
+		for (unsigned char ch : s) {
+			if (ch == '"' || ch == '\\') out << '\\' << ch;
+			else if (ch < 0x20) out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)ch << std::dec << std::setfill(' ');
+			else out << ch;
+		}
+		out << '"';
+	}
+
+	// Euler XYZ degrees (FBX Lcl Rotation) to a glTF x, y, z, w quaternion
+	static void eulerToQuaternion(const qvec3& degrees, double q[4]) {
+		const double h = M_PI / 360.0;
+		const double cx = std::cos(degrees.x * h), sx = std::sin(degrees.x * h);
+		const double cy = std::cos(degrees.y * h), sy = std::sin(degrees.y * h);
+		const double cz = std::cos(degrees.z * h), sz = std::sin(degrees.z * h);
+		// qz * qy * qx: X applied first
+		q[0] = sx * cy * cz - cx * sy * sz;
+		q[1] = cx * sy * cz + sx * cy * sz;
+		q[2] = cx * cy * sz - sx * sy * cz;
+		q[3] = cx * cy * cz + sx * sy * sz;
+	}
+
+	static void writeGltfJson(ostream& out, const vector<GlbWriterMesh>& meshes, const vector<GlbMeshLayout>& layouts, size_t binLength) {
+		out << std::setprecision(9);
+		out << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"qgen " QGEN_VERSION "\"},\"scene\":0,\"scenes\":[{\"nodes\":[";
+		for (size_t i = 0; i < meshes.size(); i++) out << (i ? "," : "") << i;
+		out << "]}],\"nodes\":[";
+		int meshIndex = 0;
+		for (size_t i = 0; i < meshes.size(); i++) {
+			const GlbWriterMesh& m = meshes[i];
+			out << (i ? "," : "") << "{\"name\":";
+			writeJsonString(out, m.name);
+			// Empty meshes become plain nodes, accessors cannot be empty
+			if (layouts[i].index_count) out << ",\"mesh\":" << meshIndex++;
+			out << ",\"translation\":[" << m.translation.x << "," << m.translation.y << "," << m.translation.z << "]";
+			double q[4];
+			eulerToQuaternion(m.rotation, q);
+			out << ",\"rotation\":[" << q[0] << "," << q[1] << "," << q[2] << "," << q[3] << "]";
+			out << ",\"scale\":[" << m.scaling.x << "," << m.scaling.y << "," << m.scaling.z << "]}";
+		}
+		out << "]";
+
+		// One bufferView per attribute / index array, accessors in the same order
+		std::ostringstream views;
+		std::ostringstream accessors;
+		std::ostringstream primitives;
+		int view = 0;
+		bool first = true;
+		for (size_t i = 0; i < meshes.size(); i++) {
+			const GlbMeshLayout& l = layouts[i];
+			if (!l.index_count) continue;
+			auto addView = [&](size_t offset, size_t bytes, int target) {
+				views << (view ? "," : "") << "{\"buffer\":0,\"byteOffset\":" << offset << ",\"byteLength\":" << bytes
+					<< ",\"target\":" << target << "}";
+				return view++;
+			};
+			auto addAccessor = [&](int v, int componentType, size_t count, const char* type) {
+				accessors << (v ? "," : "") << "{\"bufferView\":" << v << ",\"componentType\":" << componentType
+					<< ",\"count\":" << count << ",\"type\":\"" << type << "\"";
+			};
+
+			primitives << (first ? "" : ",") << "{\"name\":";
+			writeJsonString(primitives, meshes[i].name);
+			first = false;
+			int v = addView(l.positions, l.vertex_count * 12, GLTF_ARRAY_BUFFER);
+			addAccessor(v, GLTF_FLOAT, l.vertex_count, "VEC3");
+			accessors << std::setprecision(9) << ",\"min\":[" << l.min.x << "," << l.min.y << "," << l.min.z
+				<< "],\"max\":[" << l.max.x << "," << l.max.y << "," << l.max.z << "]}";
+			primitives << ",\"primitives\":[{\"attributes\":{\"POSITION\":" << v;
+			if (l.normals) {
+				v = addView(l.normals_offset, l.vertex_count * 12, GLTF_ARRAY_BUFFER);
+				addAccessor(v, GLTF_FLOAT, l.vertex_count, "VEC3");
+				accessors << "}";
+				primitives << ",\"NORMAL\":" << v;
+			}
+			if (l.uvs) {
+				v = addView(l.uvs_offset, l.vertex_count * 8, GLTF_ARRAY_BUFFER);
+				addAccessor(v, GLTF_FLOAT, l.vertex_count, "VEC2");
+				accessors << "}";
+				primitives << ",\"TEXCOORD_0\":" << v;
+			}
+			v = addView(l.indices, l.index_count * (l.wide_indices ? 4 : 2), GLTF_ELEMENT_ARRAY_BUFFER);
+			addAccessor(v, l.wide_indices ? GLTF_UNSIGNED_INT : GLTF_UNSIGNED_SHORT, l.index_count, "SCALAR");
+			accessors << "}";
+			primitives << "},\"indices\":" << v << ",\"mode\":4}]}";
+		}
+		if (view) {
+			out << ",\"meshes\":[" << primitives.str() << "],\"accessors\":[" << accessors.str()
+				<< "],\"bufferViews\":[" << views.str() << "],\"buffers\":[{\"byteLength\":" << binLength << "}]";
+		}
+		out << "}";
+	}
+	// ======================== end GLB JSON ======================= //
+
+	// ========================== GLB BIN ========================== //
+
+	// Small staging buffer between MeshStructure and the file
+	class GlbBinStream {
+	public:
+		explicit GlbBinStream(ostream& out) : out(out) {};
+		~GlbBinStream() { flush(); };
+
+		template <class T>
+		void put(T v) {
+			if (used + sizeof(T) > sizeof(buffer)) flush();
+			memcpy(buffer + used, &v, sizeof(T));
+			used += sizeof(T);
+		};
+		void putVec3(const qvec3& v) {
+			put<float>(v.x);
+			put<float>(v.y);
+			put<float>(v.z);
+		};
+		// Large contiguous data goes straight to the file
+		void write(const void* data, size_t bytes) {
+			flush();
+			out.write((const char*)data, bytes);
+			written += bytes;
+		};
+		void padTo(size_t offset) {
+			while (position() < offset) put<uint8_t>(0);
+		};
+		size_t position() const { return written + used; };
+		void flush() {
+			out.write(buffer, used);
+			written += used;
+			used = 0;
+		};
+
+	private:
+		ostream& out;
+		char buffer[64 * 1024];
+		size_t used = 0;
+		size_t written = 0;
+	};
+
+	static void writeMeshBin(GlbBinStream& bin, const MeshStructure& ms, const GlbMeshLayout& l, const GlbWriterOptions& options) {
+		QG_TRACE_SCOPE_CAT("writeGlb.mesh", "glb");
+		const QuadFace* lFaces = ms.quadFaces.data();
+		const size_t numFaces = ms.quadFaces.size();
+		bin.padTo(l.positions);
+		if (l.shared) {
+			static_assert(sizeof(qvec3) == 12, "qvec3 must be three packed floats");
+			bin.write(ms.verts.data(), ms.verts.size() * sizeof(qvec3));
+		}
+		else {
+			for (size_t f = 0; f < numFaces; f++) {
+				for (int c = 0; c < 4; c++) bin.putVec3(ms.verts[lFaces[f].indices[c]]);
+			}
+		}
+
+		// Shared layout: attributes of the first corner using each vert
+		vector<int> corner;
+		if (l.shared && (l.normals || l.uvs)) {
+			corner.assign(ms.verts.size(), -1);
+			for (size_t f = 0; f < numFaces; f++) {
+				for (int c = 0; c < 4; c++) {
+					int& k = corner[lFaces[f].indices[c]];
+					if (k < 0) k = (int)f * 4 + c;
+				}
+			}
+		}
+		const size_t n = l.vertex_count;
+		auto cornerOf = [&](size_t i) { return l.shared ? corner[i] : (int)i; };
+
+		if (l.normals) {
+			bin.padTo(l.normals_offset);
+			for (size_t i = 0; i < n; i++) {
+				const int k = cornerOf(i);
+				// Unused verts still need a unit normal
+				bin.putVec3(k < 0 ? qvec3{ 0.0f, 1.0f, 0.0f } : lFaces[k / 4].normals[k % 4]);
+			}
+		}
+		if (l.uvs) {
+			bin.padTo(l.uvs_offset);
+			for (size_t i = 0; i < n; i++) {
+				const int k = cornerOf(i);
+				qvec2 uv = k < 0 ? qvec2{ 0.0f, 0.0f } : lFaces[k / 4].uvs[k % 4];
+				bin.put<float>(uv.x);
+				bin.put<float>(options.flip_v ? 1.0f - uv.y : uv.y);
+			}
+		}
+
+		bin.padTo(l.indices);
+		for (size_t f = 0; f < numFaces; f++) {
+			uint32_t q[4];
+			for (int c = 0; c < 4; c++) q[c] = l.shared ? (uint32_t)lFaces[f].indices[c] : (uint32_t)(f * 4 + c);
+			const uint32_t tris[6] = { q[0], q[1], q[2], q[0], q[2], q[3] };
+			for (uint32_t index : tris) {
+				if (l.wide_indices) bin.put<uint32_t>(index);
+				else bin.put<uint16_t>((uint16_t)index);
+			}
+		}
+	}
+	// ======================== end GLB BIN ======================== //
+
+	bool writeGlb(const string& path, const vector<GlbWriterMesh>& meshes, const GlbWriterOptions& options) {
+		QG_TRACE_SCOPE_CAT("writeGlb", "glb");
+		vector<GlbMeshLayout> layouts(meshes.size());
+		size_t binLength = 0;
+		for (size_t i = 0; i < meshes.size(); i++) {
+			binLength = planMesh(*meshes[i].mesh, options, binLength, layouts[i]);
+		}
+
+		std::ostringstream json;
+		writeGltfJson(json, meshes, layouts, binLength);
+		string jsonText = json.str();
+		// JSON chunk padded with spaces, BIN with zeros
+		jsonText.resize(align4(jsonText.size()), ' ');
+		const size_t total = 12 + 8 + jsonText.size() + (binLength ? 8 + binLength : 0);
+		if (total > 0xffffffffull) return false;
+
+		std::ofstream out(path, std::ios::binary);
+		if (!out) return false;
+		const uint32_t header[5] = { GLB_MAGIC, GLB_VERSION, (uint32_t)total, (uint32_t)jsonText.size(), GLB_CHUNK_JSON };
+		out.write((const char*)header, sizeof(header));
+		out.write(jsonText.data(), jsonText.size());
+		if (binLength) {
+			const uint32_t chunk[2] = { (uint32_t)binLength, GLB_CHUNK_BIN };
+			out.write((const char*)chunk, sizeof(chunk));
+			GlbBinStream bin(out);
+			for (size_t i = 0; i < meshes.size(); i++) {
+				if (layouts[i].index_count) writeMeshBin(bin, *meshes[i].mesh, layouts[i], options);
+			}
+			bin.padTo(binLength);
+		}
+		return (bool)out;
+	}
+}
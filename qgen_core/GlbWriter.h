@@ -0,0 +1,36 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "MeshStructure.h"
+#include "FbxBinaryWriter.h"
+
+using namespace std;
+
+namespace qg {
+
+	// GLTF 2.0 BINARY (GLB) WRITER
+	// Writes MeshStructure only scenes as one .glb: a node (name, TRS) and a
+	// triangle mesh per entry, quads split on the fly as (0,1,2) (0,2,3).
+	// Everything is sized up front, so the JSON chunk goes first and the
+	// BIN chunk is streamed straight from the MeshStructure arrays: when
+	// every corner of a vert carries the same normal and UV the verts array
+	// is written as is (qvec3 is three tightly packed floats) and indexed by
+	// QuadFace::indices, otherwise each quad corner becomes its own vertex.
+	// POSITION accessors carry min / max, bufferViews are 4 byte aligned,
+	// indices are 16 bit when the vertex count allows.
+	typedef FbxWriterMesh GlbWriterMesh; // same mesh + node transform
+
+	struct GlbWriterOptions {
+		bool normals = true;      // only written if every face has_normals
+		bool uvs = true;          // only written if every face has_uvs
+		bool flip_v = true;       // glTF UV origin is top left, FBX bottom left
+		bool share_verts = true;  // use verts as glTF vertices when possible
+	};
+
+	// false if the file cannot be written
+	bool writeGlb(
+		const string& path,
+		const vector<GlbWriterMesh>& meshes,
+		const GlbWriterOptions& options = GlbWriterOptions()
+	);
+}
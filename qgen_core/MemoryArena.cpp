@@ -0,0 +1,109 @@
+#include "MemoryArena.h"
+#include "GenericUtils.h"
+
+namespace qg {
+
+	// ====================== MEMORY RESOURCES ===================== //
+
+	class HeapResource : public MemoryResource {
+	protected:
+		void* do_allocate(size_t bytes, size_t align) override {
+			if (align <= alignof(std::max_align_t)) return ::operator new(bytes);
+			return AlignedAllocator<char, 64>().allocate(bytes);
+		}
+		void do_deallocate(void* p, size_t bytes, size_t align) override {
+			if (align <= alignof(std::max_align_t)) {
+				::operator delete(p);
+				return;
+			}
+			AlignedAllocator<char, 64>().deallocate(static_cast<char*>(p), bytes);
+		}
+	};
+
+	MemoryResource* heapResource() {
+		static HeapResource heap;
+		return &heap;
+	}
+
+	static thread_local MemoryResource* tCurrentResource = nullptr;
+
+	MemoryResource* currentMemoryResource() {
+		return tCurrentResource ? tCurrentResource : heapResource();
+	}
+
+	ScopedMemoryResource::ScopedMemoryResource(MemoryResource* resource) {
+		previous = tCurrentResource;
+		tCurrentResource = resource;
+	}
+
+	ScopedMemoryResource::~ScopedMemoryResource() {
+		tCurrentResource = previous;
+	}
+
+	// ----- MonotonicArena ----- //
+
+	MonotonicArena::MonotonicArena(size_t initialBlockSize, MemoryResource* upstream)
+		: upstream(upstream), initial_block_size(initialBlockSize), next_block_size(initialBlockSize) {
+	}
+
+	MonotonicArena::~MonotonicArena() {
+		release();
+	}
+
+	void* MonotonicArena::do_allocate(size_t bytes, size_t align) {
+		if (bytes == 0) bytes = 1;
+		uintptr_t p = ((uintptr_t)cursor + (align - 1)) & ~(uintptr_t)(align - 1);
+		if (!cursor || p + bytes > (uintptr_t)limit) {
+			// New block, large enough for this request
+			size_t size = next_block_size;
+			while (size < bytes + align) size <<= 1;
+			void* data = upstream->allocate(size, alignof(std::max_align_t));
+			blocks.push_back(Block{ data, size });
+			reserved += size;
+			next_block_size = size << 1;
+			cursor = static_cast<char*>(data);
+			limit = cursor + size;
+			p = ((uintptr_t)cursor + (align - 1)) & ~(uintptr_t)(align - 1);
+		}
+		cursor = (char*)(p + bytes);
+		used += bytes;
+		return (void*)p;
+	}
+
+	void MonotonicArena::release() {
+		for (auto& block : blocks) {
+			upstream->deallocate(block.data, block.size, alignof(std::max_align_t));
+		}
+		blocks.clear();
+		cursor = nullptr;
+		limit = nullptr;
+		used = 0;
+		reserved = 0;
+		next_block_size = initial_block_size;
+	}
+
+	// ----- CountingResource ----- //
+
+	void* CountingResource::do_allocate(size_t bytes, size_t align) {
+		++allocations;
+		bytes_allocated += bytes;
+		bytes_in_use += bytes;
+		if (bytes_in_use > peak_bytes_in_use) peak_bytes_in_use = bytes_in_use;
+		return upstream->allocate(bytes, align);
+	}
+
+	void CountingResource::do_deallocate(void* p, size_t bytes, size_t align) {
+		++deallocations;
+		bytes_in_use -= bytes;
+		upstream->deallocate(p, bytes, align);
+	}
+
+	void CountingResource::reset() {
+		allocations = 0;
+		deallocations = 0;
+		bytes_allocated = 0;
+		bytes_in_use = 0;
+		peak_bytes_in_use = 0;
+	}
+	// ==================== end MEMORY RESOURCES =================== //
+}
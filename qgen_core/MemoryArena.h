@@ -0,0 +1,136 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include <cstddef>
+#include <new>
+
+using namespace std;
+
+namespace qg {
+
+	// MEMORY RESOURCES
+	// pmr style allocation for mesh containers (std::pmr needs C++17, the
+	// build is C++11). Containers use ArenaAllocator, which captures the
+	// thread's current resource when constructed: by default the global
+	// heap, or whatever a ScopedMemoryResource installed. A whole
+	// generation pass can then allocate from one MonotonicArena and be
+	// released at once.
+	class MemoryResource {
+	public:
+		virtual ~MemoryResource() {}
+		void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) { return do_allocate(bytes, align); };
+		void deallocate(void* p, size_t bytes, size_t align = alignof(std::max_align_t)) { do_deallocate(p, bytes, align); };
+	protected:
+		virtual void* do_allocate(size_t bytes, size_t align) = 0;
+		virtual void do_deallocate(void* p, size_t bytes, size_t align) = 0;
+	};
+
+	// Global operator new / delete
+	MemoryResource* heapResource();
+	// Resource new containers on this thread allocate from
+	MemoryResource* currentMemoryResource();
+
+	// Installs a resource as current for this thread until destroyed
+	class ScopedMemoryResource {
+	public:
+		explicit ScopedMemoryResource(MemoryResource* resource);
+		~ScopedMemoryResource();
+	private:
+		ScopedMemoryResource(const ScopedMemoryResource&);
+		ScopedMemoryResource& operator=(const ScopedMemoryResource&);
+		MemoryResource* previous;
+	};
+
+	// Bump allocator over a few large blocks taken from upstream. Deallocate
+	// is a no-op, release() returns every block in O(blocks). Blocks double
+	// in size, oversized requests get a dedicated block. Not thread safe:
+	// use one arena per thread
+	class MonotonicArena : public MemoryResource {
+	public:
+		explicit MonotonicArena(size_t initialBlockSize = 1 << 20, MemoryResource* upstream = heapResource());
+		~MonotonicArena();
+
+		void release();
+
+		size_t blockCount() const { return blocks.size(); };
+		// Bytes handed out since the last release
+		size_t bytesUsed() const { return used; };
+		// Bytes held from upstream
+		size_t bytesReserved() const { return reserved; };
+
+	protected:
+		void* do_allocate(size_t bytes, size_t align) override;
+		void do_deallocate(void*, size_t, size_t) override {}
+
+	private:
+		MonotonicArena(const MonotonicArena&);
+		MonotonicArena& operator=(const MonotonicArena&);
+
+		struct Block { void* data; size_t size; };
+		vector<Block> blocks;
+		MemoryResource* upstream;
+		size_t initial_block_size;
+		size_t next_block_size;
+		char* cursor = nullptr;
+		char* limit = nullptr;
+		size_t used = 0;
+		size_t reserved = 0;
+	};
+
+	// Forwards to upstream and counts calls and bytes
+	class CountingResource : public MemoryResource {
+	public:
+		explicit CountingResource(MemoryResource* upstream = heapResource()) : upstream(upstream) {};
+
+		size_t allocations = 0;
+		size_t deallocations = 0;
+		size_t bytes_allocated = 0;
+		size_t bytes_in_use = 0;
+		size_t peak_bytes_in_use = 0;
+		void reset();
+
+	protected:
+		void* do_allocate(size_t bytes, size_t align) override;
+		void do_deallocate(void* p, size_t bytes, size_t align) override;
+
+	private:
+		MemoryResource* upstream;
+	};
+
+	template <class T>
+	class ArenaAllocator {
+	public:
+		typedef T value_type;
+		// Like pmr: containers keep their resource, copies pick the current one
+		typedef std::false_type propagate_on_container_copy_assignment;
+		typedef std::false_type propagate_on_container_move_assignment;
+		typedef std::false_type propagate_on_container_swap;
+
+		ArenaAllocator() : resource(currentMemoryResource()) {}
+		ArenaAllocator(MemoryResource* r) : resource(r) {}
+		template <class U> ArenaAllocator(const ArenaAllocator<U>& other) : resource(other.resource) {}
+
+		T* allocate(size_t n) {
+			return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+		}
+		void deallocate(T* p, size_t n) {
+			resource->deallocate(p, n * sizeof(T), alignof(T));
+		}
+		ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+		template <class U> bool operator==(const ArenaAllocator<U>& other) const { return resource == other.resource; }
+		template <class U> bool operator!=(const ArenaAllocator<U>& other) const { return resource != other.resource; }
+
+		MemoryResource* resource;
+	};
+
+	// Containers with different resources must never be swapped: the
+	// allocator does not propagate on swap, so each would later free the
+	// other's memory through the wrong resource. Move assignment is safe
+	// (it copies element wise when the resources differ), or build the
+	// temporary with the target's get_allocator() before swapping
+	template <class T>
+	using mesh_vector = vector<T, ArenaAllocator<T>>;
+	template <class K, class V>
+	using mesh_unordered_map = unordered_map<K, V, std::hash<K>, std::equal_to<K>, ArenaAllocator<std::pair<const K, V>>>;
+}
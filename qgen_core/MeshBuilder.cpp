@@ -1,5 +1,6 @@
 #include "BaseWrapper.h"
 #include "MeshBuilder.h"
+#include "TraceLib.h"
 
 namespace qg {
 	// A simple open mesh with 3 quads
@@ -7,8 +8,8 @@ namespace qg {
 	MeshStructure* buildDemoMesh() {
 		MeshStructure* ms = new MeshStructure();
 
-		vector<qvec3> vc;// = ms->verts; // vert cloud
-		vector<QuadFace> qfList;// = ms->quadFaces; // vert cloud
+		mesh_vector<qvec3> vc;// = ms->verts; // vert cloud
+		mesh_vector<QuadFace> qfList;// = ms->quadFaces; // vert cloud
 
 		// Build the vert cloud
 		qvec3 p = { 0.0f, 0.0f, 0.0f };
@@ -79,8 +80,8 @@ namespace qg {
 			0.0f, 0.0f, 1.0f };
 		qfList.push_back(qf);
 		*/
-		ms->verts = vc; //copy
-		ms->quadFaces = qfList; //copy
+		ms->verts = std::move(vc);
+		ms->quadFaces = std::move(qfList);
 		/*
 		for (auto qf1 : ms->quadFaces) {
 			std::cout << qf1.indices[0] << std::endl;
@@ -90,10 +91,11 @@ namespace qg {
 	}
 
 	MeshStructure* buildDemoMesh_Cube() {
+		QG_TRACE_SCOPE_CAT("buildDemoMesh_Cube", "build");
 		MeshStructure* ms = new MeshStructure();
 
-		vector<qvec3> vc;// = ms->verts; // vert cloud
-		vector<QuadFace> qfList;// = ms->quadFaces; // vert cloud
+		mesh_vector<qvec3> vc;// = ms->verts; // vert cloud
+		mesh_vector<QuadFace> qfList;// = ms->quadFaces; // vert cloud
 
 		// Build the vert cloud
 		qvec3 p = { -50, 0, 50 };
@@ -212,8 +214,8 @@ namespace qg {
 			0.0f, -1.0f, 0.0f };
 		qfList.push_back(qf);
 		
-		ms->verts = vc; //copy
-		ms->quadFaces = qfList; //copy
+		ms->verts = std::move(vc);
+		ms->quadFaces = std::move(qfList);
 		/*
 		for (auto qf1 : ms->quadFaces) {
 			std::cout << qf1.indices[0] << std::endl;
@@ -222,4 +224,83 @@ namespace qg {
 		return ms;
 	}
 
+
+	MeshStructure* buildGridMesh(int nx, int nz, float cellSize) {
+		QG_TRACE_SCOPE_CAT("buildGridMesh", "build");
+		MeshStructure* ms = new MeshStructure();
+		const int rowLen = nx + 1;
+		ms->verts.reserve((size_t)rowLen * (nz + 1));
+		ms->quadFaces.reserve((size_t)nx * nz);
+
+		// Build the vert cloud, row by row along Z
+		for (int j = 0; j <= nz; j++) {
+			for (int i = 0; i <= nx; i++) {
+				ms->verts.push_back(qvec3{ i * cellSize, 0.0f, j * cellSize });
+			}
+		}
+
+		QuadFace qf;
+		qf.normals = {
+			0.0f, 1.0f, 0.0f,
+			0.0f, 1.0f, 0.0f,
+			0.0f, 1.0f, 0.0f,
+			0.0f, 1.0f, 0.0f };
+		qf.has_uvs = true;
+		qf.has_normals = true;
+		for (int j = 0; j < nz; j++) {
+			for (int i = 0; i < nx; i++) {
+				int v0 = j * rowLen + i;
+				qf.indices = { v0, v0 + rowLen, v0 + rowLen + 1, v0 + 1 };
+				float u0 = (float)i / nx, u1 = (float)(i + 1) / nx;
+				float w0 = (float)j / nz, w1 = (float)(j + 1) / nz;
+				qf.uvs = {
+					u0, w0,
+					u0, w1,
+					u1, w1,
+					u1, w0 };
+				ms->quadFaces.push_back(qf);
+			}
+		}
+		return ms;
+	}
+
+	MeshStreamBuilder::MeshStreamBuilder(size_t vertHint, size_t faceHint) {
+		ms.reserve(vertHint, faceHint);
+	}
+
+	MeshStructure MeshStreamBuilder::finish() {
+		MeshStructure out = std::move(ms);
+		ms = MeshStructure();
+		return out;
+	}
+
+	MeshStructure* MeshStreamBuilder::finishNew() {
+		MeshStructure* out = new MeshStructure(std::move(ms));
+		ms = MeshStructure();
+		return out;
+	}
+
+	MeshArenaPool::MeshArenaPool(size_t blockSize)
+		: upstream_counter(heapResource()), pool_arena(blockSize, &upstream_counter) {
+	}
+
+	MeshArenaPool::~MeshArenaPool() {
+		reset();
+	}
+
+	MeshStructure* MeshArenaPool::create() {
+		ScopedMemoryResource scope(&pool_arena);
+		void* mem = pool_arena.allocate(sizeof(MeshStructure), alignof(MeshStructure));
+		MeshStructure* ms = new (mem) MeshStructure();
+		meshes.push_back(ms);
+		return ms;
+	}
+
+	void MeshArenaPool::reset() {
+		for (MeshStructure* ms : meshes) {
+			ms->~MeshStructure();
+		}
+		meshes.clear();
+		pool_arena.release();
+	}
 }
\ No newline at end of file
@@ -4,4 +4,59 @@
 namespace qg {
 	MeshStructure* buildDemoMesh();
 	MeshStructure* buildDemoMesh_Cube();
+	// Flat grid of nx * nz quads in the XZ plane, facing +Y
+	MeshStructure* buildGridMesh(int nx, int nz, float cellSize);
+
+	// STREAMING MESH BUILDER
+	// Callers push faces as positions (QuadFaceDTO), verts are welded
+	// incrementally through the mesh's VertHashGrid. Storage is reserved
+	// from the hints up front and the finished mesh is moved out, no
+	// intermediate vert / face lists are copied.
+	class MeshStreamBuilder {
+	public:
+		explicit MeshStreamBuilder(size_t vertHint = 0, size_t faceHint = 0);
+
+		void addFace(const QuadFaceDTO& qface) { ms.addFace(qface); };
+		void addFaceBatch(const vector<QuadFaceDTO>& faceList) { ms.addFaceBatch(faceList); };
+
+		size_t vertCount() const { return ms.verts.size(); };
+		size_t faceCount() const { return ms.quadFaces.size(); };
+
+		// Moves the mesh out, the builder is left empty
+		MeshStructure finish();
+		MeshStructure* finishNew();
+
+	private:
+		MeshStructure ms;
+	};
+
+	// GENERATION ARENA POOL
+	// Meshes from create() and all their containers live in one
+	// MonotonicArena, so a generation pass allocates a few large blocks
+	// and reset() ends every mesh's lifetime at once. Builders that new
+	// their own MeshStructure can also be pointed at the arena with
+	// ScopedMemoryResource(&pool.arena()). Single threaded
+	class MeshArenaPool {
+	public:
+		explicit MeshArenaPool(size_t blockSize = 1 << 20);
+		~MeshArenaPool();
+
+		// Empty mesh allocating from the arena, owned by the pool
+		MeshStructure* create();
+		// Destroys all meshes (deallocation is a no-op) and releases the blocks
+		void reset();
+
+		size_t meshCount() const { return meshes.size(); };
+		MonotonicArena& arena() { return pool_arena; };
+		// Block allocations the arena made from the heap
+		const CountingResource& upstreamStats() const { return upstream_counter; };
+
+	private:
+		MeshArenaPool(const MeshArenaPool&);
+		MeshArenaPool& operator=(const MeshArenaPool&);
+
+		CountingResource upstream_counter;
+		MonotonicArena pool_arena;
+		vector<MeshStructure*> meshes;
+	};
 }
\ No newline at end of file
@@ -0,0 +1,419 @@
+#include "MeshDecimate.h"
+#include "MeshTopology.h"
+#include "ComputeLib.h"
+#include "TraceLib.h"
+
+namespace qg {
+
+	// ========================= QUADRICS ========================== //
+
+	static glm::dvec3 toDvec3(const qvec3& v) {
+		return glm::dvec3(v.x, v.y, v.z);
+	}
+
+	// Sum of squared distances to weighted planes n.p + d = 0, as the
+	// upper half of the symmetric 4x4 matrix
+	struct Quadric {
+		double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+		void addPlane(const glm::dvec3& n, double d, double w) {
+			a2 += w * n.x * n.x; ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+			b2 += w * n.y * n.y; bc += w * n.y * n.z; bd += w * n.y * d;
+			c2 += w * n.z * n.z; cd += w * n.z * d;
+			d2 += w * d * d;
+		};
+		Quadric& operator+=(const Quadric& q) {
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+			bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+			return *this;
+		};
+		double error(const glm::dvec3& p) const {
+			return a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+				+ b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+				+ c2 * p.z * p.z + 2 * cd * p.z + d2;
+		};
+		// A p + b, half the gradient
+		glm::dvec3 halfGradient(const glm::dvec3& p) const {
+			return glm::dvec3(
+				a2 * p.x + ab * p.y + ac * p.z + ad,
+				ab * p.x + b2 * p.y + bc * p.z + bd,
+				ac * p.x + bc * p.y + c2 * p.z + cd);
+		};
+		// d^T A d
+		double curvature(const glm::dvec3& d) const {
+			return a2 * d.x * d.x + b2 * d.y * d.y + c2 * d.z * d.z
+				+ 2 * (ab * d.x * d.y + ac * d.x * d.z + bc * d.y * d.z);
+		};
+	};
+
+	// Area weighted plane of a quad, through its diagonals' cross product
+	static glm::dvec3 quadNormal(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2, const glm::dvec3& p3) {
+		return glm::cross(p2 - p0, p3 - p1);
+	}
+
+	static vector<Quadric> initialQuadrics(const MeshStructure& ms, const MeshTopology& topo, double boundaryWeight) {
+		vector<Quadric> quadrics(ms.verts.size());
+		for (size_t f = 0; f < ms.quadFaces.size(); f++) {
+			const array<int, 4>& q = ms.quadFaces[f].indices;
+			glm::dvec3 p[4];
+			for (int c = 0; c < 4; c++) p[c] = toDvec3(ms.verts[q[c]]);
+			glm::dvec3 n = quadNormal(p[0], p[1], p[2], p[3]);
+			const double len = glm::length(n);
+			if (len <= 0.0) continue;
+			n /= len;
+			const double area = 0.5 * len;
+			const double d = -glm::dot(n, 0.25 * (p[0] + p[1] + p[2] + p[3]));
+			for (int c = 0; c < 4; c++) quadrics[q[c]].addPlane(n, d, area);
+
+			// Boundary edges: a plane through the edge, perpendicular to
+			// the face, keeps the outline in place
+			for (int c = 0; c < 4; c++) {
+				const int h = (int)f * 4 + c;
+				if (!topo.isBoundary(h)) continue;
+				const glm::dvec3 e = p[(c + 1) & 3] - p[c];
+				glm::dvec3 nb = glm::cross(e, n);
+				const double nbLen = glm::length(nb);
+				if (nbLen <= 0.0) continue;
+				nb /= nbLen;
+				const double db = -glm::dot(nb, p[c]);
+				const double w = boundaryWeight * glm::dot(e, e);
+				quadrics[q[c]].addPlane(nb, db, w);
+				quadrics[q[(c + 1) & 3]].addPlane(nb, db, w);
+			}
+		}
+		return quadrics;
+	}
+	// ======================= end QUADRICS ======================== //
+
+	// ===================== RING COLLAPSE ========================= //
+
+	struct RingCandidate {
+		bool valid = false;
+		double cost = 0.0;
+		vector<int> faces;      // strip removed by the collapse, sorted
+		vector<int> footprint;  // verts whose faces the collapse changes, sorted
+		vector<double> t;       // merge point along each ring edge
+	};
+
+	static void evaluateRing(
+		const MeshStructure& ms, // adjacency built
+		const MeshTopology& topo,
+		const vector<Quadric>& quadrics,
+		const vector<int>& ring,
+		const DecimateOptions& options,
+		RingCandidate& cand
+	) {
+		// Strip faces, each crossed along one axis only
+		vector<pair<int, int>> crossed;
+		for (int e : ring) {
+			crossed.push_back(std::make_pair(MeshTopology::face(e), MeshTopology::corner(e) & 1));
+			if (!topo.isBoundary(e)) {
+				const int t = topo.twin(e);
+				crossed.push_back(std::make_pair(MeshTopology::face(t), MeshTopology::corner(t) & 1));
+			}
+		}
+		std::sort(crossed.begin(), crossed.end());
+		crossed.erase(std::unique(crossed.begin(), crossed.end()), crossed.end());
+		for (size_t i = 0; i < crossed.size(); i++) {
+			if (i > 0 && crossed[i].first == crossed[i - 1].first) return; // strip crosses itself
+			cand.faces.push_back(crossed[i].first);
+		}
+
+		// Ring verts: each merged with exactly one other
+		vector<pair<int, int>> ringVerts; // vert, ring edge
+		for (size_t i = 0; i < ring.size(); i++) {
+			const int u = topo.origin(ring[i]);
+			const int v = topo.target(ring[i]);
+			// Joining two boundary verts across the interior pinches the mesh
+			if (!topo.isBoundary(ring[i]) && topo.boundaryOut(u) >= 0 && topo.boundaryOut(v) >= 0) return;
+			ringVerts.push_back(std::make_pair(u, (int)i));
+			ringVerts.push_back(std::make_pair(v, (int)i));
+		}
+		std::sort(ringVerts.begin(), ringVerts.end());
+		for (size_t i = 1; i < ringVerts.size(); i++) {
+			if (ringVerts[i].first == ringVerts[i - 1].first) return;
+		}
+
+		// Merge points and cost
+		vector<glm::dvec3> merged(ring.size());
+		cand.t.resize(ring.size());
+		for (size_t i = 0; i < ring.size(); i++) {
+			const int u = topo.origin(ring[i]);
+			const int v = topo.target(ring[i]);
+			Quadric q = quadrics[u];
+			q += quadrics[v];
+			const glm::dvec3 pu = toDvec3(ms.verts[u]);
+			const glm::dvec3 d = toDvec3(ms.verts[v]) - pu;
+			const double curvature = q.curvature(d);
+			double t = 0.5;
+			if (curvature > 1e-12 * glm::dot(d, d)) {
+				t = std::min(1.0, std::max(0.0, -glm::dot(q.halfGradient(pu), d) / curvature));
+			}
+			cand.t[i] = t;
+			merged[i] = pu + t * d;
+			cand.cost += std::max(0.0, q.error(merged[i]));
+		}
+
+		// Faces around the ring: none may degenerate, duplicate another or flip
+		auto findRingVert = [&](int w) -> int {
+			auto it = std::lower_bound(ringVerts.begin(), ringVerts.end(), std::make_pair(w, -1));
+			return it != ringVerts.end() && it->first == w ? it->second : -1;
+		};
+		vector<int> neighbours;
+		for (const auto& rv : ringVerts) {
+			for (int f : ms.facesOfVertBuilt(rv.first)) {
+				if (!std::binary_search(cand.faces.begin(), cand.faces.end(), f)) neighbours.push_back(f);
+			}
+		}
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+		vector<array<int, 4>> mergedFaces;
+		for (int f : neighbours) {
+			const array<int, 4>& q = ms.quadFaces[f].indices;
+			array<int, 4> m;
+			glm::dvec3 before[4], after[4];
+			for (int c = 0; c < 4; c++) {
+				const int edge = findRingVert(q[c]);
+				before[c] = toDvec3(ms.verts[q[c]]);
+				after[c] = edge < 0 ? before[c] : merged[edge];
+				m[c] = edge < 0 ? q[c] : topo.origin(ring[edge]);
+				cand.footprint.push_back(q[c]);
+			}
+			for (int c = 0; c < 4; c++) {
+				if (m[c] == m[(c + 1) & 3] || m[c] == m[(c + 2) & 3]) return;
+			}
+			const glm::dvec3 nb = quadNormal(before[0], before[1], before[2], before[3]);
+			const glm::dvec3 na = quadNormal(after[0], after[1], after[2], after[3]);
+			const double lb = glm::length(nb), la = glm::length(na);
+			if (la <= 1e-9 * lb || glm::dot(nb, na) < options.min_normal_dot * lb * la) return;
+			std::sort(m.begin(), m.end());
+			mergedFaces.push_back(m);
+		}
+		std::sort(mergedFaces.begin(), mergedFaces.end());
+		if (std::adjacent_find(mergedFaces.begin(), mergedFaces.end()) != mergedFaces.end()) return;
+
+		for (int f : cand.faces) {
+			for (int w : ms.quadFaces[f].indices) cand.footprint.push_back(w);
+		}
+		std::sort(cand.footprint.begin(), cand.footprint.end());
+		cand.footprint.erase(std::unique(cand.footprint.begin(), cand.footprint.end()), cand.footprint.end());
+		cand.valid = true;
+	}
+
+	static qvec3 normalized(const glm::dvec3& v) {
+		const double len = glm::length(v);
+		const glm::dvec3 n = len > 0.0 ? v / len : v;
+		return qvec3{ (float)n.x, (float)n.y, (float)n.z };
+	}
+
+	// Collapses the selected rings together, their footprints are disjoint
+	static void collapseRings(
+		MeshStructure& ms,
+		const MeshTopology& topo,
+		vector<Quadric>& quadrics,
+		const vector<vector<int>>& rings,
+		const vector<RingCandidate>& cands,
+		const vector<size_t>& selected
+	) {
+		const size_t numVerts = ms.verts.size();
+		vector<int> rep(numVerts);
+		for (size_t v = 0; v < numVerts; v++) rep[v] = (int)v;
+		vector<char> moved(numVerts, 0);
+		vector<glm::dvec2> uvShift(numVerts);
+		vector<glm::dvec3> normalShift(numVerts);
+		vector<char> stripFace(ms.quadFaces.size(), 0);
+
+		for (size_t r : selected) {
+			const vector<int>& ring = rings[r];
+			for (int f : cands[r].faces) stripFace[f] = 1;
+			for (size_t i = 0; i < ring.size(); i++) {
+				const int e = ring[i];
+				const int u = topo.origin(e);
+				const int v = topo.target(e);
+				const double t = cands[r].t[i];
+				// Corner attributes shift with their vert, measured on the strip
+				const QuadFace& qf = ms.quadFaces[MeshTopology::face(e)];
+				const int cu = MeshTopology::corner(e);
+				const int cv = MeshTopology::corner(MeshTopology::next(e));
+				const glm::dvec2 uvDelta(qf.uvs[cv].x - qf.uvs[cu].x, qf.uvs[cv].y - qf.uvs[cu].y);
+				const glm::dvec3 nDelta = toDvec3(qf.normals[cv]) - toDvec3(qf.normals[cu]);
+				uvShift[u] = t * uvDelta;
+				uvShift[v] = (t - 1.0) * uvDelta;
+				normalShift[u] = t * nDelta;
+				normalShift[v] = (t - 1.0) * nDelta;
+				moved[u] = moved[v] = 1;
+
+				const glm::dvec3 pu = toDvec3(ms.verts[u]);
+				const glm::dvec3 p = pu + t * (toDvec3(ms.verts[v]) - pu);
+				ms.verts[u] = qvec3{ (float)p.x, (float)p.y, (float)p.z };
+				quadrics[u] += quadrics[v];
+				rep[v] = u;
+			}
+		}
+
+		// Surviving faces, then the verts they still use. Built on the
+		// mesh's own resource: they are swapped into it
+		mesh_vector<QuadFace> faces(ms.quadFaces.get_allocator());
+		faces.reserve(ms.quadFaces.size());
+		vector<char> used(numVerts, 0);
+		for (size_t f = 0; f < ms.quadFaces.size(); f++) {
+			if (stripFace[f]) continue;
+			QuadFace qf = ms.quadFaces[f];
+			for (int c = 0; c < 4; c++) {
+				const int w = qf.indices[c];
+				if (moved[w]) {
+					qf.uvs[c].x = (float)(qf.uvs[c].x + uvShift[w].x);
+					qf.uvs[c].y = (float)(qf.uvs[c].y + uvShift[w].y);
+					qf.normals[c] = normalized(toDvec3(qf.normals[c]) + normalShift[w]);
+				}
+				qf.indices[c] = rep[w];
+				used[rep[w]] = 1;
+			}
+			faces.push_back(qf);
+		}
+
+		vector<int> remap(numVerts, -1);
+		mesh_vector<qvec3> verts(ms.verts.get_allocator());
+		vector<Quadric> keptQuadrics;
+		for (size_t v = 0; v < numVerts; v++) {
+			if (!used[v]) continue;
+			remap[v] = (int)verts.size();
+			verts.push_back(ms.verts[v]);
+			keptQuadrics.push_back(quadrics[v]);
+		}
+		for (auto& qf : faces) {
+			for (int c = 0; c < 4; c++) qf.indices[c] = remap[qf.indices[c]];
+		}
+		ms.verts.swap(verts);
+		ms.quadFaces.swap(faces);
+		quadrics.swap(keptQuadrics);
+		ms.invalidateAdjacency();
+	}
+
+	void decimateQuads(MeshStructure& ms, const DecimateOptions& options, DecimateStats* stats) {
+		QG_TRACE_SCOPE_CAT("decimateQuads", "decimate");
+		DecimateStats local;
+		local.faces_before = ms.quadFaces.size();
+		ms.holes_and_borders.clear();
+		ms.currentBorderIndices.clear();
+
+		MeshTopology topo;
+		topo.sync(ms);
+		vector<Quadric> quadrics = initialQuadrics(ms, topo, options.boundary_weight);
+
+		while (ms.quadFaces.size() > options.target_faces) {
+			QG_TRACE_SCOPE_CAT("decimate.pass", "decimate");
+			topo.sync(ms);
+			ms.buildAdjacency(); // evaluateRing workers only read it
+			const size_t numFaces = ms.quadFaces.size();
+
+			// Every ring once: a ring crosses each of its faces along one axis
+			vector<vector<int>> rings;
+			vector<char> seen(numFaces * 2, 0);
+			for (size_t f = 0; f < numFaces; f++) {
+				for (int axis = 0; axis < 2; axis++) {
+					if (seen[f * 2 + axis]) continue;
+					vector<int> ring = topo.edgeRing((int)f * 4 + axis);
+					for (int e : ring) {
+						seen[MeshTopology::face(e) * 2 + (MeshTopology::corner(e) & 1)] = 1;
+						if (!topo.isBoundary(e)) {
+							const int t = topo.twin(e);
+							seen[MeshTopology::face(t) * 2 + (MeshTopology::corner(t) & 1)] = 1;
+						}
+					}
+					rings.push_back(std::move(ring));
+				}
+			}
+
+			vector<RingCandidate> cands(rings.size());
+			{
+				QG_TRACE_SCOPE_CAT("decimate.cost", "decimate");
+				parallelFor(rings.size(), options.threads, [&](size_t r) {
+					evaluateRing(ms, topo, quadrics, rings[r], options, cands[r]);
+				});
+			}
+
+			// Cheapest first, non-overlapping, until the pass budget is spent
+			vector<size_t> order;
+			for (size_t r = 0; r < cands.size(); r++) {
+				if (cands[r].valid && cands[r].cost <= options.max_error) order.push_back(r);
+			}
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+				return cands[a].cost < cands[b].cost;
+			});
+			const size_t budget = numFaces - options.target_faces;
+			const size_t passCap = std::max<size_t>(1, (size_t)(options.pass_fraction * numFaces));
+			// Only the cheapest share of the rings: rings blocked by a
+			// cheaper neighbour wait for the next pass instead of making
+			// room for dearer ones
+			double costCap = 0.0;
+			if (!order.empty()) {
+				const size_t quantile = std::min(order.size() - 1, (size_t)(options.pass_fraction * order.size()));
+				costCap = cands[order[quantile]].cost;
+			}
+			vector<char> locked(ms.verts.size(), 0);
+			vector<size_t> selected;
+			size_t removed = 0;
+			for (size_t r : order) {
+				if (removed >= budget || removed >= passCap) break;
+				const RingCandidate& cand = cands[r];
+				if (cand.cost > costCap) break;
+				// Past the first ring, skip rings overshooting the target
+				if (removed > 0 && removed + cand.faces.size() > budget) continue;
+				bool free = true;
+				for (int v : cand.footprint) {
+					if (locked[v]) {
+						free = false;
+						break;
+					}
+				}
+				if (!free) continue;
+				for (int v : cand.footprint) locked[v] = 1;
+				selected.push_back(r);
+				removed += cand.faces.size();
+				local.max_ring_error = std::max(local.max_ring_error, cand.cost);
+			}
+			if (selected.empty()) break;
+
+			collapseRings(ms, topo, quadrics, rings, cands, selected);
+			local.rings_collapsed += selected.size();
+			++local.passes;
+			QG_TRACE_COUNTER("decimate.faces", ms.quadFaces.size());
+		}
+
+		local.faces_after = ms.quadFaces.size();
+		if (stats) *stats = local;
+	}
+	// =================== end RING COLLAPSE ======================= //
+
+	// ===================== LEVELS OF DETAIL ====================== //
+
+	vector<MeshStructure> buildLodChain(const MeshStructure& ms, const LodChainOptions& options, vector<DecimateStats>* stats) {
+		QG_TRACE_SCOPE_CAT("buildLodChain", "decimate");
+		vector<MeshStructure> levels;
+		if (stats) stats->clear();
+		for (size_t i = 0; i < options.ratios.size(); i++) {
+			DecimateStats levelStats;
+			if (i == 0) {
+				levels.push_back(ms);
+				levelStats.faces_before = levelStats.faces_after = ms.quadFaces.size();
+				if (options.ratios[0] < 1.0) {
+					DecimateOptions decimate = options.decimate;
+					decimate.target_faces = (size_t)(options.ratios[0] * ms.quadFaces.size());
+					decimateQuads(levels.back(), decimate, &levelStats);
+				}
+			}
+			else {
+				MeshStructure level = levels.back();
+				DecimateOptions decimate = options.decimate;
+				decimate.target_faces = (size_t)(options.ratios[i] * ms.quadFaces.size());
+				decimateQuads(level, decimate, &levelStats);
+				levels.push_back(std::move(level));
+			}
+			if (stats) stats->push_back(levelStats);
+		}
+		return levels;
+	}
+	// =================== end LEVELS OF DETAIL ==================== //
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "MeshStructure.h"
+
+using namespace std;
+
+namespace qg {
+
+	// QUAD PRESERVING DECIMATION
+	// Collapsing a single edge of a quad mesh leaves triangles, collapsing
+	// every edge of an edge ring (MeshTopology::edgeRing) removes the
+	// whole quad strip between them and leaves only quads. Each ring edge
+	// merges its two verts at the point of the edge minimizing the summed
+	// quadric error (Garland-Heckbert, area weighted face planes plus
+	// boundary planes); the ring costs the sum over its edges.
+	// Work goes in passes: every ring of the current mesh is validated and
+	// costed in parallel, then rings are taken cheapest first from a
+	// priority order, out of the cheapest pass_fraction of them, as long
+	// as their neighbourhoods do not overlap, and all of them are
+	// collapsed at once. Quadrics are accumulated across
+	// passes. A ring is refused if it would merge boundary verts across
+	// the interior, make a face degenerate or duplicate, or turn a face
+	// normal by more than min_normal_dot allows.
+	struct DecimateOptions {
+		size_t target_faces = 0;          // stop once at or below
+		double max_error = std::numeric_limits<double>::infinity(); // dearer rings are never collapsed
+		double boundary_weight = 10.0;    // boundary planes relative to face planes
+		double min_normal_dot = 0.5;      // cosine of the largest face normal change
+		double pass_fraction = 0.25;      // share of the faces one pass may remove, and of the rings it picks from
+		int threads = 0;                  // ring costing, hardware concurrency if <= 0
+	};
+
+	struct DecimateStats {
+		size_t faces_before = 0;
+		size_t faces_after = 0;
+		size_t passes = 0;
+		size_t rings_collapsed = 0;
+		double max_ring_error = 0.0;      // dearest ring collapsed
+	};
+
+	// Decimates ms in place. Face corner normals and UVs follow their verts.
+	// The result is a leaf mesh: holes_and_borders and currentBorderIndices
+	// are cleared
+	void decimateQuads(MeshStructure& ms, const DecimateOptions& options = DecimateOptions(), DecimateStats* stats = NULL);
+
+	// LEVELS OF DETAIL
+	struct LodChainOptions {
+		// Face count of each level relative to the source, level 0 first
+		vector<double> ratios = { 1.0, 0.5, 0.25, 0.125 };
+		DecimateOptions decimate;         // target_faces is set per level
+	};
+
+	// Each level decimated from the one before it, level 0 a copy of ms.
+	// A level that cannot get any smaller repeats the previous one
+	vector<MeshStructure> buildLodChain(const MeshStructure& ms, const LodChainOptions& options = LodChainOptions(), vector<DecimateStats>* stats = NULL);
+}
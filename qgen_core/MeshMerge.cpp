@@ -0,0 +1,149 @@
+#include "MeshMerge.h"
+#include "ComputeLib.h"
+#include <climits>
+
+namespace qg {
+
+	// ========================= MESH MERGE ======================== //
+
+	MeshStructure mergeMeshes(const vector<const MeshStructure*> &parts, const MeshMergeOptions &options) {
+		const size_t numParts = parts.size();
+		const int threads = options.threads;
+
+		vector<size_t> vertBase(numParts + 1, 0);
+		vector<size_t> faceBase(numParts + 1, 0);
+		for (size_t p = 0; p < numParts; p++) {
+			vertBase[p + 1] = vertBase[p] + parts[p]->verts.size();
+			faceBase[p + 1] = faceBase[p] + parts[p]->quadFaces.size();
+		}
+		const size_t totalVerts = vertBase[numParts];
+		if (totalVerts > (size_t)INT_MAX) throw std::length_error("mergeMeshes: too many verts");
+
+		// Global vert g is merged into owner[g], an earlier kept vert, or
+		// owns itself
+		vector<int> owner(totalVerts);
+		parallelFor(numParts, threads, [&](size_t p) {
+			for (size_t g = vertBase[p]; g < vertBase[p + 1]; g++) owner[g] = (int)g;
+		});
+
+		// Weld key of every border position and how many verts hit it
+		VertHashGrid borderGrid;
+		vector<int> keyHits;
+		if (options.weld == MeshWeldMode::BORDERS) {
+			int numKeys = 0;
+			for (const MeshStructure* part : parts) {
+				for (const auto &entry : part->holes_and_borders) {
+					for (const qvec3 &v : entry.second.verts) {
+						if (borderGrid.findOrInsert(v, numKeys) == numKeys) ++numKeys;
+					}
+				}
+			}
+
+			// Lookups are read only, so parts probe in parallel and only
+			// the few verts on a border go through the serial pass
+			vector<vector<pair<int, int>>> hits(numParts);
+			if (numKeys > 0) {
+				parallelFor(numParts, threads, [&](size_t p) {
+					const auto &verts = parts[p]->verts;
+					for (size_t i = 0; i < verts.size(); i++) {
+						int key = borderGrid.find(verts[i]);
+						if (key >= 0) hits[p].push_back(make_pair((int)(vertBase[p] + i), key));
+					}
+				});
+			}
+
+			vector<int> keyOwner(numKeys, -1);
+			keyHits.assign(numKeys, 0);
+			for (size_t p = 0; p < numParts; p++) {
+				for (const auto &hit : hits[p]) {
+					++keyHits[hit.second];
+					if (keyOwner[hit.second] < 0) keyOwner[hit.second] = hit.first;
+					else owner[hit.first] = keyOwner[hit.second];
+				}
+			}
+		}
+		else if (options.weld == MeshWeldMode::SPATIAL) {
+			VertHashGrid grid;
+			grid.reserve(totalVerts);
+			for (size_t p = 0; p < numParts; p++) {
+				const auto &verts = parts[p]->verts;
+				for (size_t i = 0; i < verts.size(); i++) {
+					int g = (int)(vertBase[p] + i);
+					owner[g] = grid.findOrInsert(verts[i], g);
+				}
+			}
+		}
+
+		// Output slot of every kept vert: count per part, prefix sum, fill
+		vector<size_t> keptBase(numParts + 1, 0);
+		parallelFor(numParts, threads, [&](size_t p) {
+			size_t kept = 0;
+			for (size_t g = vertBase[p]; g < vertBase[p + 1]; g++) {
+				if (owner[g] == (int)g) ++kept;
+			}
+			keptBase[p + 1] = kept;
+		});
+		for (size_t p = 0; p < numParts; p++) keptBase[p + 1] += keptBase[p];
+
+		MeshStructure out;
+		out.verts.resize(keptBase[numParts]);
+		out.quadFaces.resize(faceBase[numParts]);
+
+		vector<int> newIndex(totalVerts, -1);
+		parallelFor(numParts, threads, [&](size_t p) {
+			size_t slot = keptBase[p];
+			for (size_t g = vertBase[p]; g < vertBase[p + 1]; g++) {
+				if (owner[g] != (int)g) continue;
+				newIndex[g] = (int)slot;
+				out.verts[slot++] = parts[p]->verts[g - vertBase[p]];
+			}
+		});
+
+		// Owners always precede their welded verts and are all assigned
+		// above, so each part resolves its own welded verts then its faces
+		parallelFor(numParts, threads, [&](size_t p) {
+			const size_t base = vertBase[p];
+			for (size_t g = base; g < vertBase[p + 1]; g++) {
+				if (owner[g] != (int)g) newIndex[g] = newIndex[owner[g]];
+			}
+			const auto &faces = parts[p]->quadFaces;
+			QuadFace* dst = out.quadFaces.data() + faceBase[p];
+			for (size_t f = 0; f < faces.size(); f++) {
+				dst[f] = faces[f];
+				for (int c = 0; c < 4; c++) {
+					dst[f].indices[c] = newIndex[base + faces[f].indices[c]];
+				}
+			}
+		});
+
+		for (size_t p = 0; p < numParts; p++) {
+			for (const auto &entry : parts[p]->holes_and_borders) {
+				if (options.weld == MeshWeldMode::BORDERS) {
+					bool interior = !entry.second.verts.empty();
+					for (const qvec3 &v : entry.second.verts) {
+						if (keyHits[borderGrid.find(v)] < 2) {
+							interior = false;
+							break;
+						}
+					}
+					if (interior) continue;
+				}
+				string name = entry.first;
+				if (out.holes_and_borders.count(name)) name += "." + std::to_string(p);
+				out.holes_and_borders[name] = entry.second;
+			}
+		}
+
+		if (numParts > 0) {
+			const size_t last = numParts - 1;
+			for (int i : parts[last]->currentBorderIndices) {
+				out.currentBorderIndices.push_back(newIndex[vertBase[last] + i]);
+			}
+		}
+
+		// The welding index is rebuilt lazily by the next addFace
+		out.invalidateAdjacency();
+		return out;
+	}
+	// ======================= end MESH MERGE ====================== //
+}
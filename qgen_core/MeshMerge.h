@@ -0,0 +1,32 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "MeshStructure.h"
+
+using namespace std;
+
+namespace qg {
+
+	// MESH MERGE
+	// Assembles modules into one mesh. Vert and face streams are laid out
+	// by prefix sums, then every part copies its verts and remaps its face
+	// indices in parallel. Welding of coincident verts:
+	// NONE     plain concatenation
+	// BORDERS  only verts lying on a declared holes_and_borders string of
+	//          some part weld, the rest of each part is copied untouched
+	// SPATIAL  every vert goes through one VertHashGrid (serial, O(verts))
+	enum class MeshWeldMode { NONE, BORDERS, SPATIAL };
+
+	struct MeshMergeOptions {
+		MeshWeldMode weld = MeshWeldMode::BORDERS;
+		// Worker threads, 0 uses hardware concurrency
+		int threads = 0;
+	};
+
+	// Parts are assumed free of internal duplicate verts. Welded verts keep
+	// the first part's position. Border strings are kept, a name already
+	// taken gets a ".<part index>" suffix. In BORDERS mode strings whose
+	// verts all welded are interior now and dropped. currentBorderIndices
+	// of the last part carries over
+	MeshStructure mergeMeshes(const vector<const MeshStructure*> &parts, const MeshMergeOptions &options = MeshMergeOptions());
+}
@@ -1,87 +1,614 @@
 #include "MeshStructure.h"
+#include "MeshMerge.h"
 
 namespace qg {
 
+	// ======================= VERT HASH GRID ====================== //
+
+	VertHashGrid::VertHashGrid() {
+		rehash(16);
+	}
+
+	// Slots are taken over with their resource, as for any moved container
+	VertHashGrid::VertHashGrid(VertHashGrid&& other) :
+		weld_tolerance(other.weld_tolerance),
+		slots(std::move(other.slots)),
+		mask(other.mask),
+		count(other.count),
+		tombstones(other.tombstones) {
+		other.rehash(16);
+	}
+
+	VertHashGrid& VertHashGrid::operator=(VertHashGrid&& other) {
+		if (this == &other) return *this;
+		weld_tolerance = other.weld_tolerance;
+		slots = std::move(other.slots);
+		mask = other.mask;
+		count = other.count;
+		tombstones = other.tombstones;
+		other.rehash(16);
+		return *this;
+	}
+
+	void VertHashGrid::reserve(size_t n) {
+		// Keep load factor (incl. tombstones) under 0.7
+		size_t capacity = 16;
+		while (capacity * 7 < n * 10) capacity <<= 1;
+		if (capacity > slots.size()) rehash(capacity);
+	}
+
+	void VertHashGrid::clear() {
+		for (auto &slot : slots) slot.value = EMPTY;
+		count = 0;
+		tombstones = 0;
+	}
+
+	size_t VertHashGrid::hashCell(int32_t qx, int32_t qy, int32_t qz) {
+		uint64_t h = (uint64_t)(uint32_t)qx * 0x9E3779B97F4A7C15ULL;
+		h ^= (uint64_t)(uint32_t)qy * 0xC2B2AE3D27D4EB4FULL;
+		h ^= (uint64_t)(uint32_t)qz * 0x165667B19E3779F9ULL;
+		h ^= h >> 29;
+		return (size_t)h;
+	}
+
+	long VertHashGrid::findCell(int32_t qx, int32_t qy, int32_t qz) const {
+		size_t i = hashCell(qx, qy, qz) & mask;
+		while (true) {
+			const Slot &slot = slots[i];
+			if (slot.value == EMPTY) return -1;
+			if (slot.value != TOMBSTONE && slot.qx == qx && slot.qy == qy && slot.qz == qz) return (long)i;
+			i = (i + 1) & mask;
+		}
+	}
+
+	long VertHashGrid::findSlot(const qvec3 &v) const {
+		float s[3] = { v.x * VERT_PRECISION, v.y * VERT_PRECISION, v.z * VERT_PRECISION };
+		int32_t q[3] = { quantize(v.x), quantize(v.y), quantize(v.z) };
+
+		long hit = findCell(q[0], q[1], q[2]);
+		if (hit >= 0) return hit;
+
+		// Neighbour cell per axis when s sits within tolerance of a
+		// rounding boundary, 0 otherwise
+		int32_t nb[3];
+		bool near_boundary = false;
+		for (int a = 0; a < 3; a++) {
+			float d = s[a] - (float)q[a];
+			nb[a] = 0;
+			if (0.5f - std::fabs(d) <= weld_tolerance) {
+				nb[a] = d < 0 ? -1 : 1;
+				near_boundary = true;
+			}
+		}
+		if (!near_boundary) return -1;
+
+		// Probe up to 7 neighbour cells, verify actual distance
+		for (int m = 1; m < 8; m++) {
+			if (((m & 1) && !nb[0]) || ((m & 2) && !nb[1]) || ((m & 4) && !nb[2])) continue;
+			long i = findCell(
+				q[0] + ((m & 1) ? nb[0] : 0),
+				q[1] + ((m & 2) ? nb[1] : 0),
+				q[2] + ((m & 4) ? nb[2] : 0));
+			if (i < 0) continue;
+			const qvec3 &p = slots[i].pos;
+			if (std::fabs(p.x * VERT_PRECISION - s[0]) <= weld_tolerance &&
+				std::fabs(p.y * VERT_PRECISION - s[1]) <= weld_tolerance &&
+				std::fabs(p.z * VERT_PRECISION - s[2]) <= weld_tolerance) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	int VertHashGrid::find(const qvec3 &v) const {
+		long i = findSlot(v);
+		return i < 0 ? -1 : slots[i].value;
+	}
+
+	int VertHashGrid::findOrInsert(const qvec3 &v, int value) {
+		long hit = findSlot(v);
+		if (hit >= 0) return slots[hit].value;
+
+		if ((count + tombstones + 1) * 10 > slots.size() * 7) {
+			// Grow only if live entries need it, otherwise just purge tombstones
+			rehash((count + 1) * 10 > slots.size() * 5 ? slots.size() * 2 : slots.size());
+		}
+		int32_t qx = quantize(v.x), qy = quantize(v.y), qz = quantize(v.z);
+		size_t i = hashCell(qx, qy, qz) & mask;
+		while (slots[i].value >= 0) i = (i + 1) & mask;
+		if (slots[i].value == TOMBSTONE) --tombstones;
+		slots[i] = Slot{ v, qx, qy, qz, value };
+		++count;
+		return value;
+	}
+
+	bool VertHashGrid::update(const qvec3 &v, int value) {
+		long i = findSlot(v);
+		if (i < 0) return false;
+		slots[i].value = value;
+		return true;
+	}
+
+	bool VertHashGrid::erase(const qvec3 &v) {
+		long i = findSlot(v);
+		if (i < 0) return false;
+		slots[i].value = TOMBSTONE;
+		--count;
+		++tombstones;
+		return true;
+	}
+
+	void VertHashGrid::rehash(size_t capacity) {
+		mesh_vector<Slot> old(slots.get_allocator());
+		old.swap(slots);
+		slots.assign(capacity, Slot{ {0.0f, 0.0f, 0.0f}, 0, 0, 0, EMPTY });
+		mask = capacity - 1;
+		count = 0;
+		tombstones = 0;
+		for (const auto &slot : old) {
+			if (slot.value < 0) continue;
+			size_t i = hashCell(slot.qx, slot.qy, slot.qz) & mask;
+			while (slots[i].value != EMPTY) i = (i + 1) & mask;
+			slots[i] = slot;
+			++count;
+		}
+	}
+	// ===================== end VERT HASH GRID ==================== //
+
+	// ==================== VERT FACE ADJACENCY =================== //
+
+	void VertFaceAdjacency::build(size_t numVerts, const mesh_vector<QuadFace> &faces) {
+		// Pass 1: count faces per vert into offsets[v + 1]
+		offsets.assign(numVerts + 1, 0);
+		for (const auto &qf : faces) {
+			for (int c = 0; c < 4; c++) {
+				int ix = qf.indices[c];
+				// Degenerate quads may repeat a vert, count the face once
+				if ((c > 0 && qf.indices[0] == ix) || (c > 1 && qf.indices[1] == ix) || (c > 2 && qf.indices[2] == ix)) continue;
+				++offsets[ix + 1];
+			}
+		}
+		for (size_t v = 0; v < numVerts; v++) {
+			offsets[v + 1] += offsets[v];
+		}
+
+		// Pass 2: scatter face ids, faces visited in order keeps each run sorted
+		face_ids.resize(offsets[numVerts]);
+		mesh_vector<int> cursor(offsets.begin(), offsets.end() - 1);
+		int qf_index = 0;
+		for (const auto &qf : faces) {
+			for (int c = 0; c < 4; c++) {
+				int ix = qf.indices[c];
+				if ((c > 0 && qf.indices[0] == ix) || (c > 1 && qf.indices[1] == ix) || (c > 2 && qf.indices[2] == ix)) continue;
+				face_ids[cursor[ix]++] = qf_index;
+			}
+			++qf_index;
+		}
+	}
+
+	void VertFaceAdjacency::clear() {
+		offsets.clear();
+		face_ids.clear();
+	}
+	// ================== end VERT FACE ADJACENCY ================== //
+
 	// ======================= MESH STRUCTURE ====================== //
 
-	//void MeshStructure::addFace(const QuadFaceDTO& qface) {
-	//	//qface
-	//}
-	//void MeshStructure::addFaceBatch(const vector<QuadFaceDTO> faceList) {
+	void MeshStructure::addFace(const QuadFaceDTO& qface) {
+		// Verts added outside addFace are indexed first
+		if (vert_index_reverse_map.size() != verts.size()) rebuild_vert_index_reverse_map();
+
+		QuadFace qf;
+		for (int c = 0; c < 4; c++) {
+			int next = (int)verts.size();
+			int ix = vert_index_reverse_map.findOrInsert(qface.verts[c], next);
+			if (ix == next) verts.push_back(qface.verts[c]);
+			qf.indices[c] = ix;
+			qf.uvs[c] = qface.uvs[c];
+			qf.normals[c] = qface.normals[c];
+		}
+		qf.has_uvs = true;
+		qf.has_normals = true;
+		quadFaces.push_back(qf);
+		invalidateAdjacency();
+	}
+
+	void MeshStructure::addFaceBatch(const vector<QuadFaceDTO>& faceList) {
+		// Grid meshes share about one new vert per face
+		reserve(verts.size() + faceList.size(), quadFaces.size() + faceList.size());
+		for (const auto& qface : faceList) {
+			addFace(qface);
+		}
+	}
+
+	void MeshStructure::reserve(size_t numVerts, size_t numFaces) {
+		verts.reserve(numVerts);
+		quadFaces.reserve(numFaces);
+		vert_index_reverse_map.reserve(numVerts);
+	}
 
-	//}
 	//void MeshStructure::MeshStructure::deleteFace(long faceIndex) {
 
 	//}
 	// Atomic operation
+	// O(k log k) to sort the drop list, then single O(n + f) passes
+	// instead of one O(n) vector::erase per dropped vert
 	void MeshStructure::dropVerts(vector<int> indices) {
-		// Looks up verts from vert cloud vector. Should be called
-		// before erase from above.
-		dropVerts_update_vert_index_reverse_map(indices);
-		
-		std::set<int> index_set(indices.begin(), indices.end());
-		
-		// Use a reverse iterator
-		std::set<int>::reverse_iterator rit;
-		for (rit = index_set.rbegin(); rit != index_set.rend(); ++rit) {
-			verts.erase(verts.begin() + *rit);
+		std::sort(indices.begin(), indices.end());
+		indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+		if (indices.empty()) return;
+		if (indices.front() < 0 || indices.back() >= (int)verts.size()) {
+			throw std::out_of_range("dropVerts index out of range");
+		}
+
+		// Compact verts in place and record old -> new index, -1 if dropped
+		const bool has_reverse_map = vert_index_reverse_map.size() > 0;
+		mesh_vector<int> remap(verts.size());
+		size_t next = 0;
+		size_t k = 0;
+		for (size_t i = 0; i < verts.size(); i++) {
+			if (k < indices.size() && indices[k] == (int)i) {
+				if (has_reverse_map) vert_index_reverse_map.erase(verts[i]);
+				remap[i] = -1;
+				++k;
+				continue;
+			}
+			if (has_reverse_map && next != i) vert_index_reverse_map.update(verts[i], (int)next);
+			remap[i] = (int)next;
+			verts[next++] = verts[i];
 		}
+		verts.resize(next);
+
+		dropVerts_remap_faces(remap);
 
-		// Update face index map
-		dropVerts_update_indexFaceIndexList_map(indices);
+		// Face ids have shifted
+		invalidateAdjacency();
 	}
 
-	void MeshStructure::dropVerts_update_indexFaceIndexList_map(vector<int> indices) {
-		for (int ix : indices) {
-			indexFaceIndexList_map.erase(ix);
+	void MeshStructure::dropVerts_remap_faces(const mesh_vector<int> &remap) {
+		size_t next = 0;
+		for (size_t f = 0; f < quadFaces.size(); f++) {
+			QuadFace &qf = quadFaces[f];
+			bool dropped = false;
+			for (int &ix : qf.indices) {
+				ix = remap[ix];
+				dropped |= ix < 0;
+			}
+			if (dropped) continue;
+			if (next != f) quadFaces[next] = qf;
+			++next;
+		}
+		quadFaces.resize(next);
+
+		size_t b = 0;
+		for (int ix : currentBorderIndices) {
+			if (remap[ix] >= 0) currentBorderIndices[b++] = remap[ix];
 		}
+		currentBorderIndices.resize(b);
 	}
-	void MeshStructure::dropVerts_update_vert_index_reverse_map(vector<int> indices) {
-		for (int ix : indices) {
-			qvec3 v = verts[ix];
-			vert_index_reverse_map.erase(v);
+
+	static inline uint64_t edgeKey(int a, int b) {
+		if (a > b) std::swap(a, b);
+		return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+	}
+
+	static inline bool faceHasEdge(const QuadFace &qf, int a, int b) {
+		for (int c = 0; c < 4; c++) {
+			int p = qf.indices[c];
+			int q = qf.indices[(c + 1) & 3];
+			if ((p == a && q == b) || (p == b && q == a)) return true;
 		}
+		return false;
 	}
 
-	void MeshStructure::rebuild_indexFaceIndexList_map() {
-		indexFaceIndexList_map.clear(); // Erase all
-		int qf_index = 0;
-		for (auto qf : quadFaces) {
-			for (int ix : qf.indices) {
-				auto pos = indexFaceIndexList_map.find(ix);
-				if (pos == indexFaceIndexList_map.end()) {
-					// Add new list
-					vector<int> face_index_vec;
-					face_index_vec.push_back(qf_index);
-					indexFaceIndexList_map[ix] = face_index_vec;
+	void MeshStructure::cutHole(const vector<int> &loop, const string &name) {
+		const size_t n = loop.size();
+		if (n < 3) throw std::invalid_argument("cutHole: loop needs at least 3 verts");
+		for (int v : loop) {
+			if (v < 0 || v >= (int)verts.size()) throw std::out_of_range("cutHole index out of range");
+		}
+		unordered_set<uint64_t> loopEdges;
+		for (size_t i = 0; i < n; i++) loopEdges.insert(edgeKey(loop[i], loop[(i + 1) % n]));
+
+		// Seed faces on both sides, told apart by the direction in which
+		// the face runs along the loop edge
+		unordered_set<int> region[2];
+		vector<int> queue[2];
+		size_t head[2] = { 0, 0 };
+		for (size_t i = 0; i < n; i++) {
+			int a = loop[i];
+			int b = loop[(i + 1) % n];
+			for (int f : facesOfVert(a)) {
+				const auto &ix = quadFaces[f].indices;
+				for (int c = 0; c < 4; c++) {
+					int side = -1;
+					if (ix[c] == a && ix[(c + 1) & 3] == b) side = 0;
+					else if (ix[c] == b && ix[(c + 1) & 3] == a) side = 1;
+					if (side >= 0 && region[side].insert(f).second) queue[side].push_back(f);
+				}
+			}
+		}
+		if (queue[0].empty() && queue[1].empty()) {
+			throw std::invalid_argument("cutHole: loop edges are not mesh edges");
+		}
+		for (int f : region[0]) {
+			if (region[1].count(f)) throw std::invalid_argument("cutHole: loop does not separate the mesh");
+		}
+
+		// One face per side per round, never crossing the loop. A side
+		// without seeds lies past the mesh border and never wins
+		bool active[2] = { !queue[0].empty(), !queue[1].empty() };
+		int cut = -1;
+		while (cut < 0) {
+			for (int s = 0; s < 2 && cut < 0; s++) {
+				if (!active[s]) continue;
+				if (head[s] == queue[s].size()) {
+					cut = s;
+					break;
 				}
-				else {
-					// List is existing, append index 
-					vector<int> face_index_vec = pos->second;
-					face_index_vec.push_back(qf_index);
+				int f = queue[s][head[s]++];
+				for (int c = 0; c < 4; c++) {
+					int p = quadFaces[f].indices[c];
+					int q = quadFaces[f].indices[(c + 1) & 3];
+					if (p == q || loopEdges.count(edgeKey(p, q))) continue;
+					for (int g : facesOfVert(p)) {
+						if (g == f || !faceHasEdge(quadFaces[g], p, q)) continue;
+						if (region[1 - s].count(g)) throw std::invalid_argument("cutHole: loop does not separate the mesh");
+						if (region[s].insert(g).second) queue[s].push_back(g);
+					}
 				}
 			}
-			++qf_index;
 		}
+		const unordered_set<int> &cutFaces = region[cut];
+
+		// Interior verts: off the loop and used by removed faces only
+		unordered_set<int> loopVerts(loop.begin(), loop.end());
+		unordered_set<int> candidates;
+		for (int f : cutFaces) {
+			for (int v : quadFaces[f].indices) {
+				if (!loopVerts.count(v)) candidates.insert(v);
+			}
+		}
+		vector<int> deadVerts;
+		for (int v : candidates) {
+			bool inside = true;
+			for (int f : facesOfVert(v)) {
+				if (!cutFaces.count(f)) {
+					inside = false;
+					break;
+				}
+			}
+			if (inside) deadVerts.push_back(v);
+		}
+
+		// Fill dead vert slots from the back, highest first so the last
+		// vert is never dead. Adjacency is keyed by original ids, so moved
+		// verts are tracked both ways
+		std::sort(deadVerts.begin(), deadVerts.end(), std::greater<int>());
+		const bool has_reverse_map = vert_index_reverse_map.size() > 0;
+		unordered_map<int, int> slotOrigin;
+		unordered_map<int, int> movedTo;
+		for (int v : deadVerts) {
+			int last = (int)verts.size() - 1;
+			if (has_reverse_map) vert_index_reverse_map.erase(verts[v]);
+			if (v != last) {
+				auto it = slotOrigin.find(last);
+				int orig = it == slotOrigin.end() ? last : it->second;
+				for (int f : facesOfVert(orig)) {
+					for (int &ix : quadFaces[f].indices) {
+						if (ix == last) ix = v;
+					}
+				}
+				verts[v] = verts[last];
+				if (has_reverse_map) vert_index_reverse_map.update(verts[v], v);
+				slotOrigin[v] = orig;
+				movedTo[orig] = v;
+			}
+			slotOrigin.erase(last);
+			verts.pop_back();
+		}
+
+		vector<int> deadFaces(cutFaces.begin(), cutFaces.end());
+		std::sort(deadFaces.begin(), deadFaces.end(), std::greater<int>());
+		for (int f : deadFaces) {
+			if (f != (int)quadFaces.size() - 1) quadFaces[f] = quadFaces.back();
+			quadFaces.pop_back();
+		}
+
+		VertString hole;
+		hole.type = VertGroupType::BORDER_EDGE;
+		currentBorderIndices.clear();
+		for (int v : loop) {
+			auto it = movedTo.find(v);
+			int ix = it == movedTo.end() ? v : it->second;
+			currentBorderIndices.push_back(ix);
+			hole.verts.push_back(verts[ix]);
+		}
+		holes_and_borders[name] = std::move(hole);
+
+		invalidateAdjacency();
+	}
+
+	static string nextHoleName(const MeshStructure &ms) {
+		string name;
+		size_t k = ms.holes_and_borders.size();
+		do {
+			name = "hole_" + std::to_string(k++);
+		} while (ms.holes_and_borders.count(name));
+		return name;
+	}
+
+	MeshStructure MeshStructure::operator-(const VertString &rhs) const {
+		MeshStructure out = *this;
+		if (out.vert_index_reverse_map.size() != out.verts.size()) out.rebuild_vert_index_reverse_map();
+		vector<int> loop;
+		loop.reserve(rhs.verts.size());
+		for (const qvec3 &v : rhs.verts) {
+			int ix = out.findVertIndex(v);
+			if (ix < 0) throw std::invalid_argument("operator-: VertString vert is not on the mesh");
+			loop.push_back(ix);
+		}
+		// A closing vert repeating the first is accepted
+		if (loop.size() > 1 && loop.front() == loop.back()) loop.pop_back();
+		out.cutHole(loop, nextHoleName(out));
+		return out;
+	}
+
+	MeshStructure MeshStructure::operator-(const vector<int> &rhs_indices) const {
+		MeshStructure out = *this;
+		out.cutHole(rhs_indices, nextHoleName(out));
+		return out;
+	}
+
+	void MeshStructure::rebuild_indexFaceIndexList_map() {
+		indexFaceIndexList_map.build(verts.size(), quadFaces);
+		adjacency_dirty = false;
+	}
+
+	bool MeshStructure::allocatorsConsistent() const {
+		MemoryResource* r = memoryResource();
+		return quadFaces.get_allocator().resource == r
+			&& currentBorderIndices.get_allocator().resource == r
+			&& holes_and_borders.get_allocator().resource == r
+			&& vert_index_reverse_map.resource() == r
+			&& indexFaceIndexList_map.resource() == r;
+	}
+
+	IndexSpan MeshStructure::facesOfVert(int v) {
+		if (adjacency_dirty) rebuild_indexFaceIndexList_map();
+		return indexFaceIndexList_map.facesOfVert(v);
+	}
+
+	IndexSpan MeshStructure::facesOfVertBuilt(int v) const {
+		if (adjacency_dirty) throw logic_error("facesOfVertBuilt: adjacency not built, call buildAdjacency()");
+		return indexFaceIndexList_map.facesOfVert(v);
 	}
 #define DUPLICATE_VERT_CHECK true
 	void MeshStructure::rebuild_vert_index_reverse_map() {
 		vert_index_reverse_map.clear(); // Erase all
+		vert_index_reverse_map.reserve(verts.size());
 		int vert_index = 0;
-		for (auto v : verts) {
+		for (const auto &v : verts) {
 			// If vertex is already there, something is wrong with the data,
 			// or vertex is a duplicate
 			// TODO: Check if needed or made optional
-			if (DUPLICATE_VERT_CHECK && vert_index_reverse_map.count(v)) {
-				throw std::runtime_error("Duplicate vertex found at index " + vert_index);
-			}
-			else {
-				// Beautiful logic! Key is a vert object
-				vert_index_reverse_map[v] = vert_index;
+			int existing = vert_index_reverse_map.findOrInsert(v, vert_index);
+			if (DUPLICATE_VERT_CHECK && existing != vert_index) {
+				throw std::runtime_error("Duplicate vertex found at index " + std::to_string(vert_index));
 			}
 			++vert_index;
 		}
 	}
+
+	void MeshStructure::refresh_vert_index_reverse_map() {
+		if (vert_index_reverse_map.size() > 0) rebuild_vert_index_reverse_map();
+	}
+
+	int MeshStructure::findVertIndex(const qvec3 &v) const {
+		return vert_index_reverse_map.find(v);
+	}
+
+	MeshStructure MeshStructure::operator+(const MeshStructure &rhs) const {
+		return mergeMeshes({ this, &rhs });
+	}
+
+	MeshStructure MeshStructure::operator+(const VertString &rhs) const {
+		MeshStructure out = *this;
+		if (out.vert_index_reverse_map.size() != out.verts.size()) out.rebuild_vert_index_reverse_map();
+
+		// String verts weld into the existing ones
+		mesh_vector<int> to;
+		to.reserve(rhs.verts.size());
+		for (const qvec3 &v : rhs.verts) {
+			int next = (int)out.verts.size();
+			int ix = out.vert_index_reverse_map.findOrInsert(v, next);
+			if (ix == next) out.verts.push_back(v);
+			to.push_back(ix);
+		}
+
+		const mesh_vector<int> &from = currentBorderIndices;
+		if (!from.empty() && !to.empty()) {
+			if (from.size() != to.size()) {
+				throw std::invalid_argument("VertString length " + std::to_string(to.size()) +
+					" does not match the current border length " + std::to_string(from.size()));
+			}
+			const size_t n = to.size();
+			const size_t segments = rhs.type == VertGroupType::BORDER_EDGE ? n : n - 1;
+			out.quadFaces.reserve(out.quadFaces.size() + segments);
+			for (size_t s = 0; s < segments; s++) {
+				size_t t = (s + 1) % n;
+				QuadFace qf;
+				qf.indices = { from[s], from[t], to[t], to[s] };
+				// u runs along the string, v across the bridge
+				float u0 = (float)s / segments;
+				float u1 = (float)(s + 1) / segments;
+				float v0 = rhs.has_uv_scale && s < rhs.uv_scale.size() ? rhs.uv_scale[s] : 1.0f;
+				float v1 = rhs.has_uv_scale && t < rhs.uv_scale.size() ? rhs.uv_scale[t] : 1.0f;
+				qf.uvs = { qvec2{ u0, 0.0f }, qvec2{ u1, 0.0f }, qvec2{ u1, v1 }, qvec2{ u0, v0 } };
+				qf.has_uvs = true;
+				out.quadFaces.push_back(qf);
+			}
+		}
+
+		out.currentBorderIndices = std::move(to);
+		out.invalidateAdjacency();
+		return out;
+	}
+
+	// FNV-1a over 32 bit words
+	static inline void fnv_mix(uint64_t &h, uint32_t w) {
+		for (int b = 0; b < 4; b++) {
+			h ^= (w >> (b * 8)) & 0xFF;
+			h *= 0x100000001B3ULL;
+		}
+	}
+	static inline void fnv_mix_rounded(uint64_t &h, const qvec3 &v) {
+		fnv_mix(h, (uint32_t)(int32_t)std::lround(v.x * VERT_PRECISION));
+		fnv_mix(h, (uint32_t)(int32_t)std::lround(v.y * VERT_PRECISION));
+		fnv_mix(h, (uint32_t)(int32_t)std::lround(v.z * VERT_PRECISION));
+	}
+	static inline void fnv_mix_float(uint64_t &h, float f) {
+		f += 0.0f; // -0 and +0 compare equal, hash them alike
+		uint32_t w;
+		std::memcpy(&w, &f, sizeof(w));
+		fnv_mix(h, w);
+	}
+
+	uint64_t meshContentHash(const MeshStructure &ms) {
+		uint64_t h = 0xCBF29CE484222325ULL;
+		fnv_mix(h, (uint32_t)ms.verts.size());
+		fnv_mix(h, (uint32_t)ms.quadFaces.size());
+		for (const auto &v : ms.verts) {
+			fnv_mix_rounded(h, v);
+		}
+		for (const auto &qf : ms.quadFaces) {
+			for (int c = 0; c < 4; c++) {
+				fnv_mix(h, (uint32_t)qf.indices[c]);
+				fnv_mix_float(h, qf.uvs[c].x);
+				fnv_mix_float(h, qf.uvs[c].y);
+				fnv_mix_rounded(h, qf.normals[c]);
+			}
+			fnv_mix(h, (qf.has_uvs ? 1u : 0u) | (qf.has_normals ? 2u : 0u));
+		}
+		return h;
+	}
+
+	bool meshContentEqual(const MeshStructure &a, const MeshStructure &b) {
+		if (a.verts.size() != b.verts.size() || a.quadFaces.size() != b.quadFaces.size()) return false;
+		for (size_t i = 0; i < a.verts.size(); i++) {
+			if (a.verts[i] != b.verts[i]) return false;
+		}
+		for (size_t f = 0; f < a.quadFaces.size(); f++) {
+			const QuadFace &qa = a.quadFaces[f];
+			const QuadFace &qb = b.quadFaces[f];
+			if (qa.indices != qb.indices || qa.uvs != qb.uvs) return false;
+			if (qa.has_uvs != qb.has_uvs || qa.has_normals != qb.has_normals) return false;
+			for (int c = 0; c < 4; c++) {
+				if (qa.normals[c] != qb.normals[c]) return false;
+			}
+		}
+		return true;
+	}
 	// ====================== end MESH STRUCTURE =================== //
 
 }
\ No newline at end of file
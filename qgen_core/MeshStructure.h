@@ -2,6 +2,7 @@
 
 #include "BaseWrapper.h"
 #include "GenericUtils.h"
+#include "MemoryArena.h"
 
 using namespace std;
 namespace qg {
@@ -148,6 +149,108 @@ namespace std {
 	};*/
 }
 
+namespace qg {
+
+	// VERT WELDING INDEX
+	// Open addressing hash over verts quantized once at VERT_PRECISION.
+	// Replaces map<qvec3, int> where every comparison re-rounds six floats.
+	// Equality matches qvec3::operator== (same rounded cell). In addition, a
+	// vert lying within VERT_WELD_TOLERANCE of a rounding boundary probes the
+	// neighbouring cell(s), so 2.0004999 and 2.0005001 still weld.
+	// Quantized coords are int32, i.e. |coord| < 2^31 / VERT_PRECISION.
+	class VertHashGrid {
+	public:
+		VertHashGrid();
+		VertHashGrid(const VertHashGrid&) = default;
+		VertHashGrid& operator=(const VertHashGrid&) = default;
+		// Moved-from grids are left empty and usable
+		VertHashGrid(VertHashGrid&& other);
+		VertHashGrid& operator=(VertHashGrid&& other);
+
+		MemoryResource* resource() const { return slots.get_allocator().resource; };
+
+		// Max per-axis distance in quanta for cross-cell welds
+		float weld_tolerance = VERT_WELD_TOLERANCE;
+
+		void reserve(size_t n);
+		void clear();
+		size_t size() const { return count; };
+
+		// Returns the stored value or -1 if no vert welds with v
+		int find(const qvec3 &v) const;
+		// Returns the existing value if v welds with a stored vert,
+		// otherwise stores v -> value and returns value. value must be >= 0
+		int findOrInsert(const qvec3 &v, int value);
+		// Overwrites the value of an existing vert. Returns false if absent
+		bool update(const qvec3 &v, int value);
+		bool erase(const qvec3 &v);
+
+	private:
+		static const int32_t EMPTY = -1;
+		static const int32_t TOMBSTONE = -2;
+
+		struct Slot {
+			qvec3 pos; // original position, used for cross-cell weld checks
+			int32_t qx;
+			int32_t qy;
+			int32_t qz;
+			int32_t value; // EMPTY, TOMBSTONE or user value
+		};
+		// Flat slot table, size is a power of two
+		mesh_vector<Slot> slots;
+		size_t mask = 0;
+		size_t count = 0;
+		size_t tombstones = 0;
+
+		static int32_t quantize(float f) {
+			return (int32_t)std::lround(f * VERT_PRECISION);
+		};
+		static size_t hashCell(int32_t qx, int32_t qy, int32_t qz);
+		// Slot index holding the exact cell or -1
+		long findCell(int32_t qx, int32_t qy, int32_t qz) const;
+		// Slot index of the vert v welds with or -1
+		long findSlot(const qvec3 &v) const;
+		void rehash(size_t capacity);
+	};
+}
+
+namespace qg {
+
+	// Read only view over a contiguous run of ints
+	struct IndexSpan {
+		const int* first;
+		const int* last;
+
+		const int* begin() const { return first; };
+		const int* end() const { return last; };
+		size_t size() const { return last - first; };
+		bool empty() const { return first == last; };
+		int operator[](size_t i) const { return first[i]; };
+	};
+
+	// VERT -> FACE ADJACENCY
+	// Compressed sparse row layout: face ids of vert v are
+	// face_ids[offsets[v] .. offsets[v + 1]), ascending. Two flat vectors
+	// instead of one heap allocated vector per vert
+	class VertFaceAdjacency {
+	public:
+		// Two pass counting sort over face corners, O(verts + faces)
+		void build(size_t numVerts, const mesh_vector<QuadFace> &faces);
+		void clear();
+
+		size_t vertCount() const { return offsets.empty() ? 0 : offsets.size() - 1; };
+		MemoryResource* resource() const { return offsets.get_allocator().resource; };
+		IndexSpan facesOfVert(int v) const {
+			const int* base = face_ids.data();
+			return IndexSpan{ base + offsets[v], base + offsets[v + 1] };
+		};
+
+	private:
+		mesh_vector<int> offsets;
+		mesh_vector<int> face_ids;
+	};
+}
+
 namespace qg {
 	
 	enum class VertGroupType { GROUP, EDGE, BORDER_EDGE };
@@ -178,25 +281,98 @@ namespace qg {
 	};*/
 	// Long indices range based
 	// Contains the verts and the winding
+	// Containers allocate from the memory resource current when the mesh
+	// is constructed (see ScopedMemoryResource), the global heap by default
 	class MeshStructure {
 	public	:
+		// Every container of a mesh shares one resource:
+		// - construction and copy construction take the current one
+		// - move construction keeps the source's
+		// - assignment keeps the target's, copying element wise when the
+		//   resources differ
+		MeshStructure() = default;
+		MeshStructure(const MeshStructure&) = default;
+		MeshStructure(MeshStructure&&) = default;
+		MeshStructure& operator=(const MeshStructure&) = default;
+		MeshStructure& operator=(MeshStructure&&) = default;
+
+		MemoryResource* memoryResource() const { return verts.get_allocator().resource; };
+		// True if every container, lookups included, uses memoryResource()
+		bool allocatorsConsistent() const;
+
 		// ordered set of unique vertices
 		// VERT CLOUD
-		vector<qvec3> verts; // Ordered Unique Vert List - ordered by x,y,z in that order
+		mesh_vector<qvec3> verts; // Ordered Unique Vert List - ordered by x,y,z in that order
 		// FACE WIRING, NORMALS, UVS
-		vector<QuadFace> quadFaces; // Ordered Unique Face List - ordered by faceIndex
+		mesh_vector<QuadFace> quadFaces; // Ordered Unique Face List - ordered by faceIndex
 		// Current active border edge or hole for next addition iteration
-		vector<int> currentBorderIndices;
-		unordered_map<string, VertString> holes_and_borders; // string key, values are actual verts not indices
+		mesh_vector<int> currentBorderIndices;
+		mesh_unordered_map<string, VertString> holes_and_borders; // string key, values are actual verts not indices
 									//--- ATOMIC MESH OPERATIONS ---//
 		// Make a hole in the mesh by dropping verts and 
 		// re-adjustng the mesh structure
+		// Batched: one compaction pass over verts and faces, face indices are
+		// remapped and faces referencing a dropped vert are removed
 		void dropVerts(vector<int> indices);
 
-		//MeshStructure operator+(const MeshStructure &rhs) const; // mesh add operation
-		//MeshStructure operator+(const VertString &rhs) const; // mesh add operation
-		//MeshStructure operator-(const VertString &rhs) const; // mesh subtraction or create hole operation
-		//MeshStructure operator-(const vector<int> &rhs_indices) const; // mesh subtraction or create hole operation
+		// Streaming construction: face corners are given as positions and
+		// welded into verts on the fly through the reverse map
+		void addFace(const QuadFaceDTO& qface);
+		void addFaceBatch(const vector<QuadFaceDTO>& faceList);
+		// Capacity hints for verts, faces and the welding index
+		void reserve(size_t numVerts, size_t numFaces);
+
+		// Index of the vert welding with v, or -1. Reflects the reverse
+		// map as of the last rebuild_vert_index_reverse_map
+		int findVertIndex(const qvec3 &v) const;
+
+		// Face ids using vert v, O(1) once built. Rebuilt lazily after
+		// invalidateAdjacency()
+		IndexSpan facesOfVert(int v);
+		// Read only lookup, never rebuilds: call buildAdjacency() first.
+		// Throws logic_error while the adjacency is stale. Safe for
+		// concurrent readers
+		IndexSpan facesOfVertBuilt(int v) const;
+		// Rebuilds the adjacency if stale
+		void buildAdjacency() { if (adjacency_dirty) rebuild_indexFaceIndexList_map(); };
+		bool adjacencyBuilt() const { return !adjacency_dirty; };
+		// Call after editing verts / quadFaces directly. All or nothing:
+		// the whole adjacency is rebuilt on next use
+		void invalidateAdjacency() { adjacency_dirty = true; ++faces_version; };
+		// Bumped on every invalidation, lets derived structures
+		// (e.g. MeshTopology) rebuild lazily
+		uint64_t facesVersion() const { return faces_version; };
+
+		// Rebuild reverse lookups from verts / quadFaces
+		void rebuild_vert_index_reverse_map();
+		// Call after replacing verts wholesale: rebuilds the welding index
+		// if one was built, else leaves it for addFace to build on first use
+		void refresh_vert_index_reverse_map();
+		void rebuild_indexFaceIndexList_map();
+
+		// mesh add operation, see mergeMeshes (MeshMerge.h) for the welding
+		MeshStructure operator+(const MeshStructure &rhs) const;
+		// mesh add operation: bridges currentBorderIndices to the string with
+		// a quad strip (closed for BORDER_EDGE), the string becomes the new
+		// current border. With no current border the verts are only added
+		MeshStructure operator+(const VertString &rhs) const;
+		// mesh subtraction or create hole operation, see cutHole. The hole
+		// is recorded as "hole_<n>". Works on a copy: O(mesh) per call
+		MeshStructure operator-(const VertString &rhs) const;
+		MeshStructure operator-(const vector<int> &rhs_indices) const;
+
+		// Cut a hole bounded by a closed loop of vert indices, consecutive
+		// entries sharing an edge. Faces are flood filled from both sides of
+		// the loop in lockstep and the side that closes first is removed with
+		// its interior verts, so once the adjacency is built the flood is
+		// proportional to the cut region. The cut invalidates the adjacency,
+		// and the next cut or facesOfVert rebuilds it in O(verts + faces):
+		// repeated cuts cost O(mesh) each. Removed face and vert slots are
+		// refilled from the back, order is not preserved. The loop is stored
+		// as a BORDER_EDGE string under name and becomes currentBorderIndices.
+		// Throws invalid_argument if the loop is not on the mesh or does not
+		// separate it
+		void cutHole(const vector<int> &loop, const string &name);
 	private:
 		/*
 		## maps vs unordered_maps ##
@@ -210,17 +386,18 @@ namespace qg {
 		worst case complexity can be O(n) (In case all keys are in same bucket).
 		*/
 
-		map<qvec3, int> vert_index_reverse_map;
+		// Reverse lookup of vert index by position (welding index)
+		VertHashGrid vert_index_reverse_map;
 		// CRITICAL MAP FOR PERFORMANCE and SCALING 
 		// Enables reverse lookup of face objects by index
-		map<int, vector<int>> indexFaceIndexList_map;
+		VertFaceAdjacency indexFaceIndexList_map;
+		bool adjacency_dirty = true;
+		uint64_t faces_version = 0;
 
 
-		void rebuild_vert_index_reverse_map();
-		void rebuild_indexFaceIndexList_map();
-		void dropVerts_update_indexFaceIndexList_map(vector<int> indices);
-		
-		void dropVerts_update_vert_index_reverse_map(vector<int> indices); //TODO NEXT
+		// Rewrite face and border indices through an old -> new vert remap,
+		// -1 entries drop the referencing faces / border indices
+		void dropVerts_remap_faces(const mesh_vector<int> &remap);
 		/*
 		// Named groups store
 		unordered_map<string, VertGroup> vertGroupMap;
@@ -233,10 +410,15 @@ namespace qg {
 		unordered_map<long, vector<string>> indexFaceGroupNameMap; // Check if required and correct
 		
 		// Class Methods
-		void addFace(const QuadFaceDTO& qface);
-		void addFaceBatch(const vector<QuadFaceDTO> faceList);
 		void deleteFace(long faceIndex);
 		*/
 	};
+
+	// Hash of verts, face wiring, uvs and normals. Verts and normals are
+	// hashed at VERT_PRECISION, consistent with meshContentEqual
+	uint64_t meshContentHash(const MeshStructure &ms);
+	// Same geometry: verts and normals compared with qvec3::operator==,
+	// indices, uvs and flags exactly
+	bool meshContentEqual(const MeshStructure &a, const MeshStructure &b);
 }
 // end MESH DATA //
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "MeshStructureSoA.h"
+
+namespace qg {
+
+	// ==================== MESH STRUCTURE SOA ===================== //
+
+	void MeshStructureSoA::reserve(size_t numVerts, size_t numFaces) {
+		vx.reserve(numVerts);
+		vy.reserve(numVerts);
+		vz.reserve(numVerts);
+		indices.reserve(numFaces * 4);
+		u.reserve(numFaces * 4);
+		v.reserve(numFaces * 4);
+		nx.reserve(numFaces * 4);
+		ny.reserve(numFaces * 4);
+		nz.reserve(numFaces * 4);
+		has_uvs.reserve(numFaces);
+		has_normals.reserve(numFaces);
+	}
+
+	void MeshStructureSoA::resize(size_t numVerts, size_t numFaces) {
+		vx.resize(numVerts);
+		vy.resize(numVerts);
+		vz.resize(numVerts);
+		indices.resize(numFaces * 4);
+		u.resize(numFaces * 4);
+		v.resize(numFaces * 4);
+		nx.resize(numFaces * 4);
+		ny.resize(numFaces * 4);
+		nz.resize(numFaces * 4);
+		has_uvs.resize(numFaces);
+		has_normals.resize(numFaces);
+	}
+
+	void MeshStructureSoA::clear() {
+		resize(0, 0);
+	}
+
+	qvec3 MeshStructureSoA::vert(size_t i) const {
+		return qvec3{ vx[i], vy[i], vz[i] };
+	}
+
+	void MeshStructureSoA::setVert(size_t i, const qvec3 &p) {
+		vx[i] = p.x;
+		vy[i] = p.y;
+		vz[i] = p.z;
+	}
+
+	void MeshStructureSoA::pushVert(const qvec3 &p) {
+		vx.push_back(p.x);
+		vy.push_back(p.y);
+		vz.push_back(p.z);
+	}
+
+	QuadFace MeshStructureSoA::face(size_t f) const {
+		QuadFace qf;
+		for (size_t c = 0; c < 4; c++) {
+			size_t k = f * 4 + c;
+			qf.indices[c] = indices[k];
+			qf.uvs[c] = qvec2{ u[k], v[k] };
+			qf.normals[c] = qvec3{ nx[k], ny[k], nz[k] };
+		}
+		qf.has_uvs = has_uvs[f] != 0;
+		qf.has_normals = has_normals[f] != 0;
+		return qf;
+	}
+
+	void MeshStructureSoA::setFace(size_t f, const QuadFace &qf) {
+		for (size_t c = 0; c < 4; c++) {
+			size_t k = f * 4 + c;
+			indices[k] = qf.indices[c];
+			u[k] = qf.uvs[c].x;
+			v[k] = qf.uvs[c].y;
+			nx[k] = qf.normals[c].x;
+			ny[k] = qf.normals[c].y;
+			nz[k] = qf.normals[c].z;
+		}
+		has_uvs[f] = qf.has_uvs;
+		has_normals[f] = qf.has_normals;
+	}
+
+	void MeshStructureSoA::pushFace(const QuadFace &qf) {
+		size_t f = faceCount();
+		indices.resize(indices.size() + 4);
+		u.resize(u.size() + 4);
+		v.resize(v.size() + 4);
+		nx.resize(nx.size() + 4);
+		ny.resize(ny.size() + 4);
+		nz.resize(nz.size() + 4);
+		has_uvs.push_back(0);
+		has_normals.push_back(0);
+		setFace(f, qf);
+	}
+
+	MeshStructureSoA MeshStructureSoA::fromAoS(const MeshStructure &ms) {
+		MeshStructureSoA soa;
+		soa.resize(ms.verts.size(), ms.quadFaces.size());
+		for (size_t i = 0; i < ms.verts.size(); i++) {
+			soa.setVert(i, ms.verts[i]);
+		}
+		for (size_t f = 0; f < ms.quadFaces.size(); f++) {
+			soa.setFace(f, ms.quadFaces[f]);
+		}
+		return soa;
+	}
+
+	void MeshStructureSoA::toAoS(MeshStructure &ms) const {
+		ms.verts.resize(vertCount());
+		ms.quadFaces.resize(faceCount());
+		for (size_t i = 0; i < vertCount(); i++) {
+			ms.verts[i] = vert(i);
+		}
+		for (size_t f = 0; f < faceCount(); f++) {
+			ms.quadFaces[f] = face(f);
+		}
+	}
+
+	// Plain indexed loops over raw pointers so the compiler can vectorize
+	void MeshStructureSoA::translate(float dx, float dy, float dz) {
+		const size_t n = vertCount();
+		float* x = vx.data();
+		float* y = vy.data();
+		float* z = vz.data();
+		for (size_t i = 0; i < n; i++) x[i] += dx;
+		for (size_t i = 0; i < n; i++) y[i] += dy;
+		for (size_t i = 0; i < n; i++) z[i] += dz;
+	}
+
+	void MeshStructureSoA::scale(float sx, float sy, float sz) {
+		const size_t n = vertCount();
+		float* x = vx.data();
+		float* y = vy.data();
+		float* z = vz.data();
+		for (size_t i = 0; i < n; i++) x[i] *= sx;
+		for (size_t i = 0; i < n; i++) y[i] *= sy;
+		for (size_t i = 0; i < n; i++) z[i] *= sz;
+	}
+
+	void MeshStructureSoA::recomputeFaceNormals() {
+		const size_t numFaces = faceCount();
+		const int* ix = indices.data();
+		const float* x = vx.data();
+		const float* y = vy.data();
+		const float* z = vz.data();
+		for (size_t f = 0; f < numFaces; f++) {
+			const int* q = ix + f * 4;
+			// Cross product of the diagonals, robust for non planar quads
+			float ax = x[q[2]] - x[q[0]], ay = y[q[2]] - y[q[0]], az = z[q[2]] - z[q[0]];
+			float bx = x[q[3]] - x[q[1]], by = y[q[3]] - y[q[1]], bz = z[q[3]] - z[q[1]];
+			float cx = ay * bz - az * by;
+			float cy = az * bx - ax * bz;
+			float cz = ax * by - ay * bx;
+			float len = std::sqrt(cx * cx + cy * cy + cz * cz);
+			float inv = len > 0.0f ? 1.0f / len : 0.0f;
+			for (size_t c = 0; c < 4; c++) {
+				nx[f * 4 + c] = cx * inv;
+				ny[f * 4 + c] = cy * inv;
+				nz[f * 4 + c] = cz * inv;
+			}
+			has_normals[f] = 1;
+		}
+	}
+	// ================== end MESH STRUCTURE SOA =================== //
+}
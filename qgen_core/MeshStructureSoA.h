@@ -0,0 +1,69 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "GenericUtils.h"
+#include "MeshStructure.h"
+
+using namespace std;
+
+// Byte alignment of every SoA stream (AVX register width)
+#define SOA_ALIGNMENT 32
+
+namespace qg {
+
+	template <class T>
+	using soa_vector = vector<T, AlignedAllocator<T, SOA_ALIGNMENT>>;
+
+	// STRUCTURE OF ARRAYS MESH STORAGE
+	// Same content as MeshStructure, but each attribute lives in its own
+	// contiguous aligned stream so passes touching one attribute (transform,
+	// normal recompute, export) only pull that attribute through cache.
+	// Face corner c of face f is stored at f * 4 + c in every corner stream.
+	// Builders keep filling MeshStructure (AoS) and convert with fromAoS,
+	// or use the vert/face accessors which read and write QuadFace records.
+	class MeshStructureSoA {
+	public:
+		// VERT CLOUD
+		soa_vector<float> vx;
+		soa_vector<float> vy;
+		soa_vector<float> vz;
+		// FACE WIRING, 4 per face
+		soa_vector<int> indices;
+		// UVS, 4 per face
+		soa_vector<float> u;
+		soa_vector<float> v;
+		// NORMALS, 4 per face
+		soa_vector<float> nx;
+		soa_vector<float> ny;
+		soa_vector<float> nz;
+		// Per face flags
+		soa_vector<uint8_t> has_uvs;
+		soa_vector<uint8_t> has_normals;
+
+		size_t vertCount() const { return vx.size(); };
+		size_t faceCount() const { return has_uvs.size(); };
+
+		void reserve(size_t numVerts, size_t numFaces);
+		void resize(size_t numVerts, size_t numFaces);
+		void clear();
+
+		// AoS compatible view
+		qvec3 vert(size_t i) const;
+		void setVert(size_t i, const qvec3 &p);
+		void pushVert(const qvec3 &p);
+		QuadFace face(size_t f) const;
+		void setFace(size_t f, const QuadFace &qf);
+		void pushFace(const QuadFace &qf);
+
+		// Conversion to / from the AoS MeshStructure
+		static MeshStructureSoA fromAoS(const MeshStructure &ms);
+		void toAoS(MeshStructure &ms) const;
+
+		// --- SINGLE ATTRIBUTE PASSES --- //
+		void translate(float dx, float dy, float dz);
+		void scale(float sx, float sy, float sz);
+		// Flat (per face) normals from vert positions, written to all four
+		// corners. Sets has_normals on every face
+		void recomputeFaceNormals();
+	};
+}
@@ -0,0 +1,127 @@
+#include "MeshTopology.h"
+
+namespace qg {
+
+	// ======================= MESH TOPOLOGY ======================= //
+
+	void MeshTopology::build(const MeshStructure &ms) {
+		const size_t numFaces = ms.quadFaces.size();
+		const size_t numHalfEdges = numFaces * 4;
+
+		face_indices.resize(numHalfEdges);
+		for (size_t f = 0; f < numFaces; f++) {
+			for (int c = 0; c < 4; c++) {
+				face_indices[f * 4 + c] = ms.quadFaces[f].indices[c];
+			}
+		}
+
+		// Twin of a -> b is the b -> a half-edge in a face around b. Using the
+		// CSR adjacency keeps this linear for bounded valence
+		VertFaceAdjacency adjacency;
+		adjacency.build(ms.verts.size(), ms.quadFaces);
+		twins.assign(numHalfEdges, -1);
+		for (int h = 0; h < (int)numHalfEdges; h++) {
+			if (twins[h] >= 0) continue;
+			int a = origin(h);
+			int b = target(h);
+			if (a == b) continue; // collapsed edge of a degenerate quad
+			for (int f : adjacency.facesOfVert(b)) {
+				int h2 = f * 4;
+				for (; h2 < f * 4 + 4; h2++) {
+					if (h2 != h && twins[h2] < 0 && origin(h2) == b && target(h2) == a) break;
+				}
+				if (h2 < f * 4 + 4) {
+					twins[h] = h2;
+					twins[h2] = h;
+					break;
+				}
+			}
+		}
+
+		boundary_out.assign(ms.verts.size(), -1);
+		boundary_edges.clear();
+		for (int h = 0; h < (int)numHalfEdges; h++) {
+			if (twins[h] >= 0 || origin(h) == target(h)) continue;
+			boundary_out[origin(h)] = h;
+			boundary_edges.push_back(h);
+		}
+
+		built = true;
+		built_version = ms.facesVersion();
+	}
+
+	bool MeshTopology::sync(const MeshStructure &ms) {
+		if (built && built_version == ms.facesVersion() && face_indices.size() == ms.quadFaces.size() * 4) {
+			return false;
+		}
+		build(ms);
+		return true;
+	}
+
+	int MeshTopology::faceNeighbor(int f, int c) const {
+		int t = twins[f * 4 + c];
+		return t < 0 ? -1 : face(t);
+	}
+
+	vector<int> MeshTopology::boundaryLoop(int h) const {
+		vector<int> loop;
+		if (h < 0 || !isBoundary(h)) return loop;
+		int cur = h;
+		do {
+			loop.push_back(cur);
+			cur = nextBoundary(cur);
+		} while (cur >= 0 && cur != h && loop.size() <= boundary_edges.size());
+		return loop;
+	}
+
+	vector<vector<int>> MeshTopology::boundaryLoops() const {
+		vector<vector<int>> loops;
+		unordered_set<int> seen;
+		seen.reserve(boundary_edges.size());
+		for (int h : boundary_edges) {
+			if (seen.count(h)) continue;
+			vector<int> loop = boundaryLoop(h);
+			seen.insert(loop.begin(), loop.end());
+			loops.push_back(std::move(loop));
+		}
+		return loops;
+	}
+
+	vector<int> MeshTopology::edgeRing(int h) const {
+		// Each quad crossed contributes its opposite edge, so a strip of
+		// n quads gives n + 1 edges (n when the ring closes)
+		const size_t limit = twins.size() / 4 + 1;
+		vector<int> ring;
+		ring.push_back(h);
+		int cur = h;
+		while (ring.size() <= limit) {
+			int o = opposite(cur);
+			int t = twins[o];
+			if (t == h) return ring; // closed ring
+			ring.push_back(o);
+			if (t < 0) break;
+			cur = t;
+		}
+
+		// Open ring, walk the other way from h's twin
+		vector<int> back;
+		cur = twins[h];
+		while (cur >= 0 && back.size() <= limit) {
+			int o = opposite(cur);
+			back.push_back(o);
+			cur = twins[o];
+		}
+		ring.insert(ring.begin(), back.rbegin(), back.rend());
+		return ring;
+	}
+
+	VertString MeshTopology::boundaryVertString(const MeshStructure &ms, int h) const {
+		VertString vs;
+		vs.type = VertGroupType::BORDER_EDGE;
+		for (int b : boundaryLoop(h)) {
+			vs.verts.push_back(ms.verts[origin(b)]);
+		}
+		return vs;
+	}
+	// ===================== end MESH TOPOLOGY ===================== //
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "MeshStructure.h"
+
+using namespace std;
+
+namespace qg {
+
+	// HALF-EDGE TOPOLOGY FOR QUAD MESHES
+	// Half-edges are implicit: half-edge h = face * 4 + corner runs from
+	// indices[corner] to indices[(corner + 1) % 4] of that face, so next,
+	// prev, face and origin are arithmetic. Only twins and one outgoing
+	// boundary half-edge per vert are stored.
+	// Built in linear time from quadFaces and rebuilt lazily through
+	// sync() when MeshStructure::facesVersion() changes.
+	// Non-manifold input: edges shared by more than two faces pair the first
+	// two found, a vert on several boundary loops keeps one outgoing edge.
+	class MeshTopology {
+	public:
+		// Rebuild from the current faces
+		void build(const MeshStructure &ms);
+		// Rebuild only if the mesh changed since the last build.
+		// Returns true if a rebuild happened
+		bool sync(const MeshStructure &ms);
+
+		size_t halfEdgeCount() const { return twins.size(); };
+
+		// --- O(1) QUERIES --- //
+		static int face(int h) { return h >> 2; };
+		static int corner(int h) { return h & 3; };
+		static int next(int h) { return (h & ~3) | ((h + 1) & 3); };
+		static int prev(int h) { return (h & ~3) | ((h + 3) & 3); };
+		// Edge across the quad, same winding as its face
+		static int opposite(int h) { return (h & ~3) | ((h + 2) & 3); };
+		int origin(int h) const { return face_indices[h]; };
+		int target(int h) const { return face_indices[next(h)]; };
+		// -1 on a boundary
+		int twin(int h) const { return twins[h]; };
+		bool isBoundary(int h) const { return twins[h] < 0; };
+		// Face across edge `corner` of face f or -1
+		int faceNeighbor(int f, int c) const;
+		// A boundary half-edge starting at vert v or -1
+		int boundaryOut(int v) const { return boundary_out[v]; };
+		// Boundary half-edge continuing the loop after boundary half-edge h
+		int nextBoundary(int h) const { return boundary_out[target(h)]; };
+
+		// --- WALKS, linear in the walked length --- //
+		// Boundary half-edges of the loop containing boundary half-edge h
+		vector<int> boundaryLoop(int h) const;
+		// Every boundary loop, one walk per loop
+		vector<vector<int>> boundaryLoops() const;
+		// Half-edges crossing the quad strip through h: h, the opposite
+		// edge's twin, and so on in both directions until a boundary or
+		// the ring closes
+		vector<int> edgeRing(int h) const;
+
+		// Loop as a BORDER_EDGE VertString (positions, not indices)
+		VertString boundaryVertString(const MeshStructure &ms, int h) const;
+
+	private:
+		// Flattened quadFaces[].indices, face_indices[h] == origin(h)
+		vector<int> face_indices;
+		vector<int> twins;
+		vector<int> boundary_out;
+		// Every boundary half-edge, so loop discovery skips interior edges
+		vector<int> boundary_edges;
+		bool built = false;
+		uint64_t built_version = 0;
+	};
+}
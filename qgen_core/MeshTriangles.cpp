@@ -0,0 +1,248 @@
+#include "MeshTriangles.h"
+#include "TraceLib.h"
+#include <iomanip>
+
+namespace qg {
+
+	// ======================= TRIANGULATION ======================= //
+
+	static float distanceSquared(const qvec3& a, const qvec3& b) {
+		const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	TriangleMesh triangulateQuads(const MeshStructure& ms) {
+		QG_TRACE_SCOPE_CAT("triangulateQuads", "triangles");
+		TriangleMesh tm;
+		bool normals = !ms.quadFaces.empty();
+		bool uvs = !ms.quadFaces.empty();
+		for (const auto& qf : ms.quadFaces) {
+			normals = normals && qf.has_normals;
+			uvs = uvs && qf.has_uvs;
+		}
+
+		// Vertices created so far for each vert, usually one to four,
+		// chained through nextOfVert
+		const uint32_t none = ~0u;
+		vector<uint32_t> firstOfVert(ms.verts.size(), none);
+		vector<uint32_t> nextOfVert;
+		auto vertexFor = [&](const QuadFace& qf, int c) -> uint32_t {
+			const int v = qf.indices[c];
+			for (uint32_t id = firstOfVert[v]; id != none; id = nextOfVert[id]) {
+				if (normals && !(tm.normals[id].x == qf.normals[c].x && tm.normals[id].y == qf.normals[c].y && tm.normals[id].z == qf.normals[c].z)) continue;
+				if (uvs && !(tm.uvs[id] == qf.uvs[c])) continue;
+				return id;
+			}
+			uint32_t id = (uint32_t)tm.positions.size();
+			tm.positions.push_back(ms.verts[v]);
+			if (normals) tm.normals.push_back(qf.normals[c]);
+			if (uvs) tm.uvs.push_back(qf.uvs[c]);
+			tm.source_verts.push_back(v);
+			nextOfVert.push_back(firstOfVert[v]);
+			firstOfVert[v] = id;
+			return id;
+		};
+
+		tm.positions.reserve(ms.verts.size());
+		tm.source_verts.reserve(ms.verts.size());
+		nextOfVert.reserve(ms.verts.size());
+		if (normals) tm.normals.reserve(ms.verts.size());
+		if (uvs) tm.uvs.reserve(ms.verts.size());
+		tm.indices.reserve(ms.quadFaces.size() * 6);
+		for (const auto& qf : ms.quadFaces) {
+			const array<int, 4>& q = qf.indices;
+			// Shorter diagonal: flatter and better shaped triangles
+			const bool diagonal02 = distanceSquared(ms.verts[q[0]], ms.verts[q[2]]) <= distanceSquared(ms.verts[q[1]], ms.verts[q[3]]);
+			static const int split02[6] = { 0, 1, 2, 0, 2, 3 };
+			static const int split13[6] = { 0, 1, 3, 1, 2, 3 };
+			const int* corners = diagonal02 ? split02 : split13;
+			for (int t = 0; t < 6; t += 3) {
+				const int a = corners[t], b = corners[t + 1], c = corners[t + 2];
+				if (q[a] == q[b] || q[b] == q[c] || q[a] == q[c]) continue;
+				tm.indices.push_back(vertexFor(qf, a));
+				tm.indices.push_back(vertexFor(qf, b));
+				tm.indices.push_back(vertexFor(qf, c));
+			}
+		}
+		return tm;
+	}
+	// ===================== end TRIANGULATION ===================== //
+
+	// ======================= VERTEX CACHE ======================== //
+
+	VertexCacheStats analyzeVertexCache(const vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+		VertexCacheStats stats;
+		stats.triangles = indices.size() / 3;
+		// A vertex is in the FIFO while fewer than cacheSize misses
+		// happened since it was last transformed
+		vector<size_t> transformedAt(vertexCount, 0);
+		for (uint32_t v : indices) {
+			if (transformedAt[v] == 0) ++stats.vertices;
+			if (transformedAt[v] == 0 || stats.transforms + 1 - transformedAt[v] > (size_t)cacheSize) {
+				++stats.transforms;
+				transformedAt[v] = stats.transforms;
+			}
+		}
+		if (stats.triangles) stats.acmr = (double)stats.transforms / stats.triangles;
+		if (stats.vertices) stats.atvr = (double)stats.transforms / stats.vertices;
+		return stats;
+	}
+
+	// Forsyth's scoring constants
+	static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+	static const float FORSYTH_LAST_TRI_SCORE = 0.75f;
+	static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+	static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+	static const int FORSYTH_MAX_VALENCE = 64; // boost table size, higher valences share the last entry
+
+	void optimizeVertexCache(vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+		QG_TRACE_SCOPE_CAT("optimizeVertexCache", "triangles");
+		const size_t triCount = indices.size() / 3;
+		if (triCount < 2 || cacheSize < 4) return;
+
+		// Score tables: by cache position, and by triangles left to emit
+		vector<float> cacheScore(cacheSize);
+		for (int i = 0; i < cacheSize; i++) {
+			if (i < 3) cacheScore[i] = FORSYTH_LAST_TRI_SCORE;
+			else cacheScore[i] = std::pow(1.0f - (float)(i - 3) / (cacheSize - 3), FORSYTH_CACHE_DECAY_POWER);
+		}
+		vector<float> valenceScore(FORSYTH_MAX_VALENCE + 1, 0.0f);
+		for (int i = 1; i <= FORSYTH_MAX_VALENCE; i++) {
+			valenceScore[i] = FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+		}
+
+		// Triangles of each vertex, packed, the live ones first
+		vector<uint32_t> triOffset(vertexCount + 1, 0);
+		vector<uint32_t> live(vertexCount, 0);
+		for (uint32_t v : indices) ++live[v];
+		for (size_t v = 0; v < vertexCount; v++) triOffset[v + 1] = triOffset[v] + live[v];
+		vector<uint32_t> vertTris(indices.size());
+		{
+			vector<uint32_t> fill(triOffset.begin(), triOffset.end() - 1);
+			for (size_t t = 0; t < triCount; t++) {
+				for (int c = 0; c < 3; c++) vertTris[fill[indices[t * 3 + c]]++] = (uint32_t)t;
+			}
+		}
+
+		vector<int> cachePos(vertexCount, -1);
+		vector<float> vertScore(vertexCount);
+		auto scoreVertex = [&](uint32_t v) {
+			if (live[v] == 0) return -1.0f;
+			float score = cachePos[v] < 0 ? 0.0f : cacheScore[cachePos[v]];
+			return score + valenceScore[std::min<uint32_t>(live[v], FORSYTH_MAX_VALENCE)];
+		};
+		for (size_t v = 0; v < vertexCount; v++) vertScore[v] = scoreVertex((uint32_t)v);
+		vector<float> triScore(triCount);
+		for (size_t t = 0; t < triCount; t++) {
+			triScore[t] = vertScore[indices[t * 3]] + vertScore[indices[t * 3 + 1]] + vertScore[indices[t * 3 + 2]];
+		}
+
+		vector<bool> emitted(triCount, false);
+		vector<uint32_t> output;
+		output.reserve(indices.size());
+		vector<uint32_t> cache, nextCache;
+		cache.reserve(cacheSize + 3);
+		nextCache.reserve(cacheSize + 3);
+		size_t cursor = 0; // first triangle that may not be emitted yet
+		long best = 0;
+		for (size_t emittedCount = 0; emittedCount < triCount; emittedCount++) {
+			if (best < 0) {
+				// Nothing in the cache has triangles left: restart at the
+				// next triangle in input order
+				while (emitted[cursor]) ++cursor;
+				best = (long)cursor;
+			}
+			const uint32_t* tri = &indices[best * 3];
+			emitted[best] = true;
+			output.insert(output.end(), tri, tri + 3);
+
+			// Emitted triangle leaves its vertices' live lists
+			for (int c = 0; c < 3; c++) {
+				const uint32_t v = tri[c];
+				uint32_t* first = &vertTris[triOffset[v]];
+				uint32_t* last = first + live[v];
+				*std::find(first, last, (uint32_t)best) = *(last - 1);
+				--live[v];
+			}
+
+			// LRU: the triangle's vertices move to the front
+			nextCache.assign(tri, tri + 3);
+			for (uint32_t v : cache) {
+				if (v != tri[0] && v != tri[1] && v != tri[2]) nextCache.push_back(v);
+			}
+			cache.swap(nextCache);
+
+			// Rescore whatever was in the cache, then pick the best
+			// triangle touching it
+			for (size_t i = 0; i < cache.size(); i++) {
+				const uint32_t v = cache[i];
+				cachePos[v] = i < (size_t)cacheSize ? (int)i : -1;
+				const float score = scoreVertex(v);
+				const float delta = score - vertScore[v];
+				vertScore[v] = score;
+				for (uint32_t k = 0; k < live[v]; k++) triScore[vertTris[triOffset[v] + k]] += delta;
+			}
+			float bestScore = -1.0f;
+			best = -1;
+			for (size_t i = 0; i < cache.size() && i < (size_t)cacheSize; i++) {
+				const uint32_t v = cache[i];
+				for (uint32_t k = 0; k < live[v]; k++) {
+					const uint32_t t = vertTris[triOffset[v] + k];
+					if (triScore[t] > bestScore) {
+						bestScore = triScore[t];
+						best = (long)t;
+					}
+				}
+			}
+			if (cache.size() > (size_t)cacheSize) cache.resize(cacheSize);
+		}
+		indices.swap(output);
+	}
+
+	void optimizeVertexFetch(TriangleMesh& tm) {
+		QG_TRACE_SCOPE_CAT("optimizeVertexFetch", "triangles");
+		const uint32_t unused = ~0u;
+		vector<uint32_t> remap(tm.vertexCount(), unused);
+		uint32_t next = 0;
+		for (uint32_t& v : tm.indices) {
+			if (remap[v] == unused) remap[v] = next++;
+			v = remap[v];
+		}
+
+		TriangleMesh reordered;
+		reordered.positions.resize(next);
+		reordered.source_verts.resize(next);
+		if (!tm.normals.empty()) reordered.normals.resize(next);
+		if (!tm.uvs.empty()) reordered.uvs.resize(next);
+		for (size_t v = 0; v < remap.size(); v++) {
+			const uint32_t r = remap[v];
+			if (r == unused) continue;
+			reordered.positions[r] = tm.positions[v];
+			reordered.source_verts[r] = tm.source_verts[v];
+			if (!tm.normals.empty()) reordered.normals[r] = tm.normals[v];
+			if (!tm.uvs.empty()) reordered.uvs[r] = tm.uvs[v];
+		}
+		tm.positions.swap(reordered.positions);
+		tm.source_verts.swap(reordered.source_verts);
+		tm.normals.swap(reordered.normals);
+		tm.uvs.swap(reordered.uvs);
+	}
+
+	TriangleOptimizeReport optimizeTriangleMesh(TriangleMesh& tm, const TriangleOptimizeOptions& options) {
+		QG_TRACE_SCOPE_CAT("optimizeTriangleMesh", "triangles");
+		TriangleOptimizeReport report;
+		report.before = analyzeVertexCache(tm.indices, tm.vertexCount(), options.analyze_cache_size);
+		optimizeVertexCache(tm.indices, tm.vertexCount(), options.cache_size);
+		if (options.reorder_vertices) optimizeVertexFetch(tm);
+		report.after = analyzeVertexCache(tm.indices, tm.vertexCount(), options.analyze_cache_size);
+		return report;
+	}
+
+	void printTriangleOptimizeReport(const TriangleOptimizeReport& report, ostream& out) {
+		out << std::fixed << std::setprecision(3)
+			<< "triangles " << report.after.triangles << ", vertices " << report.after.vertices
+			<< ", ACMR " << report.before.acmr << " -> " << report.after.acmr
+			<< ", ATVR " << report.before.atvr << " -> " << report.after.atvr << endl;
+	}
+	// ===================== end VERTEX CACHE ====================== //
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "MeshStructure.h"
+
+using namespace std;
+
+namespace qg {
+
+	// TRIANGLE LISTS
+	// GPU ready triangles from quads. Each QuadFace is split along its
+	// shorter diagonal (winding kept), corners with the same vert, normal
+	// and UV become one vertex. optimizeTriangleMesh then reorders the
+	// triangles for the post-transform vertex cache (Forsyth, "Linear-Speed
+	// Vertex Cache Optimisation") and the vertices in first use order for
+	// fetch locality, and measures both orders on a FIFO cache.
+	struct TriangleMesh {
+		vector<qvec3> positions;
+		vector<qvec3> normals;    // per vertex, empty unless every quad has_normals
+		vector<qvec2> uvs;        // per vertex, empty unless every quad has_uvs
+		vector<int> source_verts; // MeshStructure vert of each vertex
+		vector<uint32_t> indices; // three per triangle
+
+		size_t vertexCount() const { return positions.size(); };
+		size_t triangleCount() const { return indices.size() / 3; };
+	};
+
+	// Degenerate triangles (a vert used twice) are dropped
+	TriangleMesh triangulateQuads(const MeshStructure& ms);
+
+	// Post-transform cache simulation: a FIFO of cacheSize vertices
+	struct VertexCacheStats {
+		size_t triangles = 0;
+		size_t vertices = 0;   // distinct vertices referenced
+		size_t transforms = 0; // cache misses
+		double acmr = 0.0;     // transforms per triangle, 0.5 at best, 3 at worst
+		double atvr = 0.0;     // transforms per vertex, 1 at best
+	};
+	VertexCacheStats analyzeVertexCache(const vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 16);
+
+	// Forsyth reordering of a triangle list, modelling an LRU cache of
+	// cacheSize entries. Same triangles, same winding
+	void optimizeVertexCache(vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 32);
+	// Vertices renumbered in first use order, unused ones dropped
+	void optimizeVertexFetch(TriangleMesh& tm);
+
+	struct TriangleOptimizeOptions {
+		int cache_size = 32;          // LRU model of optimizeVertexCache
+		int analyze_cache_size = 16;  // FIFO of analyzeVertexCache
+		bool reorder_vertices = true; // optimizeVertexFetch afterwards
+	};
+
+	struct TriangleOptimizeReport {
+		VertexCacheStats before;
+		VertexCacheStats after;
+	};
+
+	TriangleOptimizeReport optimizeTriangleMesh(TriangleMesh& tm, const TriangleOptimizeOptions& options = TriangleOptimizeOptions());
+
+	// "triangles N, vertices N, ACMR a -> b, ATVR a -> b"
+	void printTriangleOptimizeReport(const TriangleOptimizeReport& report, ostream& out);
+}
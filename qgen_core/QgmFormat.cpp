@@ -0,0 +1,321 @@
+#include "QgmFormat.h"
+#include "TraceLib.h"
+#include <cstddef>
+#include <fstream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace qg {
+
+	// The file stores these structs byte for byte: a layout change here
+	// must bump QGM_VERSION
+	static_assert(sizeof(qvec3) == 12, "qvec3 layout changed, bump QGM_VERSION");
+	static_assert(sizeof(QuadFace) == 100, "QuadFace layout changed, bump QGM_VERSION");
+	static_assert(sizeof(QgmHeader) == 64, "QgmHeader must stay 64 bytes");
+	static_assert(sizeof(QgmSection) == 32, "QgmSection must stay 32 bytes");
+
+	static const char QGM_MAGIC[4] = { 'Q', 'G', 'M', 0x1a };
+	static const uint32_t QGM_ENDIAN = 0x01020304;
+	static const uint32_t QGM_SECTION_COUNT = 4;
+
+	static uint64_t alignSection(uint64_t offset) {
+		return (offset + QGM_SECTION_ALIGN - 1) / QGM_SECTION_ALIGN * QGM_SECTION_ALIGN;
+	}
+
+	static size_t align4(size_t n) {
+		return (n + 3) & ~(size_t)3;
+	}
+
+	// Packed VertString: name length, type, has_uv_scale, vert count and
+	// uv_scale count as uint32, then the name padded to 4, verts, uv_scale
+	static size_t packedVertStringBytes(const string& name, const VertString& vs) {
+		return 5 * 4 + align4(name.size()) + vs.verts.size() * sizeof(qvec3) + vs.uv_scale.size() * sizeof(float);
+	}
+
+	// ========================= QGM WRITER ======================== //
+
+	class QgmWriteStream {
+	public:
+		explicit QgmWriteStream(ostream& out) : out(out) {};
+
+		void write(const void* p, size_t bytes) {
+			out.write((const char*)p, bytes);
+			position += bytes;
+		};
+		template <class T>
+		void put(T v) { write(&v, sizeof(T)); };
+		void padTo(uint64_t offset) {
+			static const char zeros[QGM_SECTION_ALIGN] = {};
+			while (position < offset) write(zeros, (size_t)std::min<uint64_t>(offset - position, QGM_SECTION_ALIGN));
+		};
+		uint64_t position = 0;
+
+	private:
+		ostream& out;
+	};
+
+	bool writeQgm(const string& path, const MeshStructure& ms) {
+		QG_TRACE_SCOPE_CAT("writeQgm", "qgm");
+		// Sorted so the same mesh always gives the same file
+		vector<const pair<const string, VertString>*> strings;
+		for (const auto& entry : ms.holes_and_borders) strings.push_back(&entry);
+		std::sort(strings.begin(), strings.end(), [](const pair<const string, VertString>* a, const pair<const string, VertString>* b) {
+			return a->first < b->first;
+		});
+		size_t holesBytes = 0;
+		for (auto entry : strings) holesBytes += packedVertStringBytes(entry->first, entry->second);
+
+		// Whole layout first, then one sequential pass
+		QgmSection sections[QGM_SECTION_COUNT] = {
+			{ QGM_VERTS, sizeof(qvec3), 0, ms.verts.size(), ms.verts.size() * sizeof(qvec3) },
+			{ QGM_FACES, sizeof(QuadFace), 0, ms.quadFaces.size(), ms.quadFaces.size() * sizeof(QuadFace) },
+			{ QGM_BORDER_INDICES, sizeof(int32_t), 0, ms.currentBorderIndices.size(), ms.currentBorderIndices.size() * sizeof(int32_t) },
+			{ QGM_HOLES_AND_BORDERS, 0, 0, strings.size(), holesBytes }
+		};
+		uint64_t offset = sizeof(QgmHeader) + sizeof(sections);
+		for (auto& section : sections) {
+			section.offset = alignSection(offset);
+			offset = section.offset + section.bytes;
+		}
+
+		QgmHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, QGM_MAGIC, 4);
+		header.version = QGM_VERSION;
+		header.endian = QGM_ENDIAN;
+		header.header_size = sizeof(QgmHeader);
+		header.vert_size = sizeof(qvec3);
+		header.face_size = sizeof(QuadFace);
+		header.section_count = QGM_SECTION_COUNT;
+		header.file_size = offset;
+		header.content_hash = meshContentHash(ms);
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file) return false;
+		QgmWriteStream out(file);
+		out.put(header);
+		out.write(sections, sizeof(sections));
+
+		out.padTo(sections[0].offset);
+		out.write(ms.verts.data(), (size_t)sections[0].bytes);
+
+		// Faces go through a staging buffer with the padding bytes zeroed,
+		// so identical meshes give identical files
+		out.padTo(sections[1].offset);
+		const size_t padding = offsetof(QuadFace, has_normals) + sizeof(bool);
+		const size_t CHUNK = 1024;
+		vector<QuadFace> staging(std::min(CHUNK, ms.quadFaces.size()));
+		for (size_t first = 0; first < ms.quadFaces.size(); first += CHUNK) {
+			const size_t n = std::min(CHUNK, ms.quadFaces.size() - first);
+			memcpy(staging.data(), ms.quadFaces.data() + first, n * sizeof(QuadFace));
+			for (size_t i = 0; i < n; i++) {
+				memset((char*)&staging[i] + padding, 0, sizeof(QuadFace) - padding);
+			}
+			out.write(staging.data(), n * sizeof(QuadFace));
+		}
+
+		out.padTo(sections[2].offset);
+		for (int index : ms.currentBorderIndices) out.put<int32_t>(index);
+
+		out.padTo(sections[3].offset);
+		for (auto entry : strings) {
+			const string& name = entry->first;
+			const VertString& vs = entry->second;
+			out.put<uint32_t>((uint32_t)name.size());
+			out.put<uint32_t>((uint32_t)vs.type);
+			out.put<uint32_t>(vs.has_uv_scale ? 1 : 0);
+			out.put<uint32_t>((uint32_t)vs.verts.size());
+			out.put<uint32_t>((uint32_t)vs.uv_scale.size());
+			out.write(name.data(), name.size());
+			out.padTo(out.position + align4(name.size()) - name.size());
+			out.write(vs.verts.data(), vs.verts.size() * sizeof(qvec3));
+			out.write(vs.uv_scale.data(), vs.uv_scale.size() * sizeof(float));
+		}
+		return (bool)file && out.position == header.file_size;
+	}
+	// ======================= end QGM WRITER ====================== //
+
+	// ========================= QGM MAPPING ======================= //
+
+	static bool qgmFail(string* error, const string& message) {
+		if (error) *error = message;
+		return false;
+	}
+
+	bool QgmMapping::open(const string& path, string* error) {
+		QG_TRACE_SCOPE_CAT("QgmMapping::open", "qgm");
+		close();
+#ifdef _WIN32
+		HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (hFile == INVALID_HANDLE_VALUE) return qgmFail(error, "cannot open " + path);
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(QgmHeader)) {
+			CloseHandle(hFile);
+			return qgmFail(error, "not a qgm file: " + path);
+		}
+		HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		const void* view = hMapping ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (!view) {
+			if (hMapping) CloseHandle(hMapping);
+			CloseHandle(hFile);
+			return qgmFail(error, "cannot map " + path);
+		}
+		file_handle = hFile;
+		mapping_handle = hMapping;
+		data = (const char*)view;
+		size = (size_t)fileSize.QuadPart;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return qgmFail(error, "cannot open " + path);
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(QgmHeader)) {
+			::close(fd);
+			return qgmFail(error, "not a qgm file: " + path);
+		}
+		void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// The mapping keeps the file alive
+		::close(fd);
+		if (view == MAP_FAILED) return qgmFail(error, "cannot map " + path);
+		data = (const char*)view;
+		size = (size_t)st.st_size;
+#endif
+
+		const QgmHeader& h = header();
+		string problem;
+		if (memcmp(h.magic, QGM_MAGIC, 4) != 0) problem = "not a qgm file";
+		else if (h.version != QGM_VERSION) problem = "qgm version " + to_string(h.version) + ", expected " + to_string(QGM_VERSION);
+		else if (h.endian != QGM_ENDIAN) problem = "qgm written with a different byte order";
+		else if (h.header_size != sizeof(QgmHeader) || h.vert_size != sizeof(qvec3) || h.face_size != sizeof(QuadFace)) problem = "qgm struct sizes differ from this build";
+		else if (h.file_size != size) problem = "qgm file truncated";
+		else if (sizeof(QgmHeader) + (uint64_t)h.section_count * sizeof(QgmSection) > size) problem = "qgm section table truncated";
+
+		const QgmSection* table = (const QgmSection*)(data + sizeof(QgmHeader));
+		for (uint32_t i = 0; problem.empty() && i < h.section_count; i++) {
+			const QgmSection& s = table[i];
+			if (s.offset % QGM_SECTION_ALIGN != 0 || s.offset > size || s.bytes > size - s.offset) {
+				problem = "qgm section " + to_string(i) + " out of bounds";
+				break;
+			}
+			// Known sections are used as typed arrays: their element size
+			// must be the one this build reads them with
+			uint32_t expected = s.element_size;
+			switch (s.type) {
+			case QGM_VERTS: expected = sizeof(qvec3); break;
+			case QGM_FACES: expected = sizeof(QuadFace); break;
+			case QGM_BORDER_INDICES: expected = sizeof(int32_t); break;
+			case QGM_HOLES_AND_BORDERS: expected = 0; break;
+			default: break;
+			}
+			if (s.element_size != expected) {
+				problem = "qgm section " + to_string(i) + " element size " + to_string(s.element_size) + ", expected " + to_string(expected);
+				break;
+			}
+			if (s.element_size && (s.count > s.bytes || s.bytes != s.count * s.element_size)) {
+				problem = "qgm section " + to_string(i) + " size mismatch";
+				break;
+			}
+			const char* p = data + s.offset;
+			switch (s.type) {
+			case QGM_VERTS:
+				vert_data = (const qvec3*)p;
+				vert_count = (size_t)s.count;
+				break;
+			case QGM_FACES:
+				face_data = (const QuadFace*)p;
+				face_count = (size_t)s.count;
+				break;
+			case QGM_BORDER_INDICES:
+				border_data = (const int32_t*)p;
+				border_count = (size_t)s.count;
+				break;
+			case QGM_HOLES_AND_BORDERS:
+				holes_data = p;
+				holes_bytes = (size_t)s.bytes;
+				holes_count = (size_t)s.count;
+				break;
+			default:
+				// Newer optional section
+				break;
+			}
+		}
+		if (!problem.empty()) {
+			close();
+			return qgmFail(error, problem + ": " + path);
+		}
+		return true;
+	}
+
+	void QgmMapping::close() {
+		if (data) {
+#ifdef _WIN32
+			UnmapViewOfFile(data);
+			CloseHandle((HANDLE)mapping_handle);
+			CloseHandle((HANDLE)file_handle);
+			file_handle = NULL;
+			mapping_handle = NULL;
+#else
+			munmap((void*)data, size);
+#endif
+		}
+		data = NULL;
+		size = 0;
+		vert_data = NULL;
+		vert_count = 0;
+		face_data = NULL;
+		face_count = 0;
+		border_data = NULL;
+		border_count = 0;
+		holes_data = NULL;
+		holes_bytes = 0;
+		holes_count = 0;
+	}
+
+	void QgmMapping::readHolesAndBorders(mesh_unordered_map<string, VertString>& out) const {
+		const char* p = holes_data;
+		const char* end = holes_data + holes_bytes;
+		for (size_t i = 0; i < holes_count; i++) {
+			uint32_t fields[5];
+			if (end - p < (ptrdiff_t)sizeof(fields)) throw std::runtime_error("qgm holes_and_borders truncated");
+			memcpy(fields, p, sizeof(fields));
+			p += sizeof(fields);
+			const size_t nameBytes = fields[0];
+			const size_t payload = align4(nameBytes) + (size_t)fields[3] * sizeof(qvec3) + (size_t)fields[4] * sizeof(float);
+			if ((size_t)(end - p) < payload) throw std::runtime_error("qgm holes_and_borders truncated");
+
+			VertString vs;
+			vs.type = (VertGroupType)fields[1];
+			vs.has_uv_scale = fields[2] != 0;
+			string name(p, nameBytes);
+			p += align4(nameBytes);
+			vs.verts.resize(fields[3]);
+			memcpy(vs.verts.data(), p, vs.verts.size() * sizeof(qvec3));
+			p += vs.verts.size() * sizeof(qvec3);
+			vs.uv_scale.resize(fields[4]);
+			memcpy(vs.uv_scale.data(), p, vs.uv_scale.size() * sizeof(float));
+			p += vs.uv_scale.size() * sizeof(float);
+			out[name] = vs;
+		}
+	}
+
+	void QgmMapping::load(MeshStructure& ms) const {
+		QG_TRACE_SCOPE_CAT("QgmMapping::load", "qgm");
+		ms.verts.assign(vert_data, vert_data + vert_count);
+		ms.quadFaces.assign(face_data, face_data + face_count);
+		ms.currentBorderIndices.assign(border_data, border_data + border_count);
+		ms.holes_and_borders.clear();
+		readHolesAndBorders(ms.holes_and_borders);
+		ms.invalidateAdjacency();
+		// A previously used mesh may hold an index of its old verts, same
+		// size or not
+		ms.refresh_vert_index_reverse_map();
+	}
+	// ======================= end QGM MAPPING ===================== //
+}
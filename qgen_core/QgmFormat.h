@@ -0,0 +1,102 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "MeshStructure.h"
+
+using namespace std;
+
+namespace qg {
+
+	// NATIVE MESH CACHE FORMAT (.qgm)
+	// MeshStructure as stored in memory, for warm starts: a 64 byte header,
+	// a section table, then one 64 byte aligned section per array. Verts
+	// and faces are the raw qvec3 / QuadFace arrays (little endian, the
+	// struct sizes are recorded and checked), so a mapped file is used in
+	// place with no parsing. holes_and_borders are packed entry by entry
+	// and decoded on demand. Written in one sequential pass.
+	// Any change to the layout of qvec3, QuadFace or a section bumps
+	// QGM_VERSION; readers refuse other versions, and skip unknown section
+	// types.
+	static const uint32_t QGM_VERSION = 1;
+	static const uint32_t QGM_SECTION_ALIGN = 64;
+
+	enum QgmSectionType : uint32_t {
+		QGM_VERTS = 1,               // qvec3[]
+		QGM_FACES = 2,               // QuadFace[]
+		QGM_BORDER_INDICES = 3,      // int32[] currentBorderIndices
+		QGM_HOLES_AND_BORDERS = 4    // packed VertStrings, sorted by name
+	};
+
+	struct QgmHeader {
+		char magic[4];           // "QGM\x1a"
+		uint32_t version;
+		uint32_t endian;         // 0x01020304 as written
+		uint32_t header_size;
+		uint32_t vert_size;      // sizeof(qvec3)
+		uint32_t face_size;      // sizeof(QuadFace)
+		uint32_t section_count;  // QgmSection entries right after the header
+		uint32_t reserved0;
+		uint64_t file_size;
+		uint64_t content_hash;   // meshContentHash of the stored mesh
+		uint8_t reserved[16];
+	};
+
+	struct QgmSection {
+		uint32_t type;
+		uint32_t element_size;   // 0 for packed sections
+		uint64_t offset;         // from the start of the file
+		uint64_t count;          // elements, or entries for packed sections
+		uint64_t bytes;
+	};
+
+	// false if the file cannot be written
+	bool writeQgm(const string& path, const MeshStructure& ms);
+
+	// Read only mapping of a .qgm file (mmap, MapViewOfFile on Windows).
+	// Pointers stay valid until close() or destruction
+	class QgmMapping {
+	public:
+		QgmMapping() {};
+		~QgmMapping() { close(); };
+
+		// Maps and validates the file; on failure the reason goes to error
+		bool open(const string& path, string* error = NULL);
+		void close();
+		bool isOpen() const { return data != NULL; };
+
+		const QgmHeader& header() const { return *(const QgmHeader*)data; };
+		const qvec3* verts() const { return vert_data; };
+		size_t vertCount() const { return vert_count; };
+		const QuadFace* faces() const { return face_data; };
+		size_t faceCount() const { return face_count; };
+		const int32_t* borderIndices() const { return border_data; };
+		size_t borderIndexCount() const { return border_count; };
+
+		// Decodes the packed holes_and_borders section into out
+		void readHolesAndBorders(mesh_unordered_map<string, VertString>& out) const;
+		// Copies everything into ms, one memcpy per array. Adjacency is left
+		// to rebuild; a welding index already built on ms is rebuilt for
+		// the new verts
+		void load(MeshStructure& ms) const;
+
+	private:
+		QgmMapping(const QgmMapping&);
+		QgmMapping& operator=(const QgmMapping&);
+
+		const char* data = NULL;
+		size_t size = 0;
+#ifdef _WIN32
+		void* file_handle = NULL;
+		void* mapping_handle = NULL;
+#endif
+		const qvec3* vert_data = NULL;
+		size_t vert_count = 0;
+		const QuadFace* face_data = NULL;
+		size_t face_count = 0;
+		const int32_t* border_data = NULL;
+		size_t border_count = 0;
+		const char* holes_data = NULL;
+		size_t holes_bytes = 0;
+		size_t holes_count = 0;
+	};
+}
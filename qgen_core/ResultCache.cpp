@@ -0,0 +1,436 @@
+#include "ResultCache.h"
+#include "QgmFormat.h"
+#include "TraceLib.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#endif
+
+namespace qg {
+
+	static const char* RESULT_CACHE_INDEX_MAGIC = "qgen-result-cache";
+	static const int RESULT_CACHE_INDEX_VERSION = 1;
+
+	// ======================== CACHE KEYS ========================= //
+
+	// Separators and line breaks are escaped so that distinct parameter
+	// lists never produce the same text, and the text fits on one line
+	static string escapeKeyPart(const string& s) {
+		string out;
+		out.reserve(s.size());
+		for (char c : s) {
+			if (c == '%' || c == ';' || c == '=' || c == '\n' || c == '\r') {
+				char hex[4];
+				snprintf(hex, sizeof(hex), "%%%02X", (unsigned char)c);
+				out += hex;
+			}
+			else out += c;
+		}
+		return out;
+	}
+
+	CacheKey::CacheKey(const string& kind) {
+		key_text = "qgen=" QGEN_VERSION ";cache=" + to_string(RESULT_CACHE_VERSION) + ";kind=" + escapeKeyPart(kind);
+	}
+
+	CacheKey& CacheKey::add(const string& name, const string& value) {
+		key_text += ";" + escapeKeyPart(name) + "=" + escapeKeyPart(value);
+		return *this;
+	}
+
+	CacheKey& CacheKey::add(const string& name, const char* value) {
+		return add(name, string(value));
+	}
+
+	CacheKey& CacheKey::add(const string& name, int value) {
+		return add(name, to_string(value));
+	}
+
+	CacheKey& CacheKey::add(const string& name, double value) {
+		char text[32];
+		snprintf(text, sizeof(text), "%.17g", value);
+		return add(name, string(text));
+	}
+
+	CacheKey& CacheKey::add(const string& name, bool value) {
+		return add(name, string(value ? "1" : "0"));
+	}
+
+	CacheKey& CacheKey::add(const string& name, const SpreaderInput& p) {
+		add(name + ".count", p.count);
+		add(name + ".radius", (double)p.radius);
+		add(name + ".radial_index", p.radial_index);
+		add(name + ".step_index", p.step_index);
+		add(name + ".step_delta", (double)p.step_delta);
+		return add(name + ".direction", p.direction);
+	}
+
+	uint64_t CacheKey::hash() const {
+		// FNV-1a, as meshContentHash
+		uint64_t h = 0xCBF29CE484222325ULL;
+		for (char c : key_text) {
+			h ^= (unsigned char)c;
+			h *= 0x100000001B3ULL;
+		}
+		return h;
+	}
+
+	string CacheKey::hex() const {
+		char text[17];
+		snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash());
+		return text;
+	}
+
+	CacheKey GenMeshJobKey(const GenMeshJob& job, const string& builderKey) {
+		CacheKey key("mesh");
+		key.add("builder", builderKey)
+			.add("qgm", (int)QGM_VERSION)
+			.add("name", job.name)
+			.add("x", job.x)
+			.add("y", job.y)
+			.add("z", job.z)
+			.add("rotate", job.rotateAxis);
+		return key;
+	}
+
+	CacheKey GenJobKey(const GenJobSpec& job, const string& builderKey) {
+		// The writer is picked from the extension when no format is given
+		size_t dot = job.output.find_last_of("./\\");
+		string extension = dot != string::npos && job.output[dot] == '.' ? job.output.substr(dot + 1) : "";
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+		CacheKey key("job");
+		key.add("builder", builderKey)
+			.add("fbxsdk", FBXSDK_VERSION_STRING)
+			.add("meshes", job.meshes)
+			.add("format", job.format)
+			.add("extension", extension)
+			.add("texture", job.texture)
+			.add("animate", job.animate)
+			.add("embed", job.embed);
+		return key;
+	}
+
+	// ======================== FILE HELPERS ======================= //
+
+	static bool fileSize(const string& path, uint64_t& size) {
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		if (!in) return false;
+		size = (uint64_t)in.tellg();
+		return true;
+	}
+
+	static bool copyFile(const string& from, const string& to) {
+		std::ifstream in(from, std::ios::binary);
+		if (!in) return false;
+		std::ofstream out(to, std::ios::binary | std::ios::trunc);
+		if (!out) return false;
+		if (in.peek() != std::ifstream::traits_type::eof()) out << in.rdbuf();
+		out.close();
+		return !out.fail();
+	}
+
+	// Atomic where the platform allows it: readers see the old or the new
+	// file, never a partial one
+	static bool replaceFile(const string& from, const string& to) {
+#ifdef _WIN32
+		return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+	}
+
+	static bool isDirectory(const string& path) {
+#ifdef _WIN32
+		struct _stat info;
+		return _stat(path.c_str(), &info) == 0 && (info.st_mode & _S_IFDIR);
+#else
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+	}
+
+	// mkdir -p
+	static bool makeDirectories(const string& path) {
+		for (size_t i = 1; i <= path.size(); i++) {
+			if (i < path.size() && path[i] != '/' && path[i] != '\\') continue;
+			string part = path.substr(0, i);
+			if (isDirectory(part)) continue;
+#ifdef _WIN32
+			int rc = _mkdir(part.c_str());
+#else
+			int rc = mkdir(part.c_str(), 0777);
+#endif
+			if (rc != 0 && errno != EEXIST) return false;
+		}
+		return isDirectory(path);
+	}
+
+	// Unique per process, so threads storing the same key never share one
+	static string tempSuffix() {
+		static std::atomic<uint64_t> counter(0);
+		return "." + to_string(counter++) + ".tmp";
+	}
+
+	// ======================= RESULT CACHE ======================== //
+
+	ResultCache::ResultCache(const string& dir, uint64_t maxBytes) : dir(dir), max_bytes(maxBytes) {
+	}
+
+	ResultCache::~ResultCache() {
+		flush();
+	}
+
+	string ResultCache::entryPath(const string& hex) const {
+		return dir + "/" + hex;
+	}
+
+	bool ResultCache::open(string* error) {
+		QG_TRACE_SCOPE_CAT("ResultCache::open", "cache");
+		std::lock_guard<std::mutex> lock(mutex);
+		lru.clear();
+		entries.clear();
+		counters = ResultCacheStats();
+		opened = false;
+		if (!makeDirectories(dir)) {
+			if (error) *error = "cannot create cache directory " + dir;
+			return false;
+		}
+
+		// A missing index is an empty cache
+		std::ifstream in(dir + "/index");
+		string line;
+		if (in && std::getline(in, line)) {
+			std::istringstream header(line);
+			string magic;
+			int version = 0;
+			header >> magic >> version;
+			if (magic != RESULT_CACHE_INDEX_MAGIC || version != RESULT_CACHE_INDEX_VERSION) {
+				if (error) *error = "unknown cache index format in " + dir;
+				return false;
+			}
+			vector<pair<uint64_t, string>> order;
+			while (std::getline(in, line)) {
+				std::istringstream fields(line);
+				string hex;
+				Entry entry;
+				if (!(fields >> hex >> entry.bytes >> entry.tick) || fields.get() != ' ' || entries.count(hex)) continue;
+				std::getline(fields, entry.key_text);
+				uint64_t size = 0;
+				if (!fileSize(entryPath(hex), size) || size != entry.bytes) continue;
+				next_tick = std::max(next_tick, entry.tick + 1);
+				order.push_back(std::make_pair(entry.tick, hex));
+				counters.bytes += entry.bytes;
+				entries[hex] = entry;
+			}
+			std::sort(order.begin(), order.end(), [](const pair<uint64_t, string>& a, const pair<uint64_t, string>& b) {
+				return a.first > b.first;
+			});
+			for (const auto& o : order) {
+				lru.push_back(o.second);
+				entries[o.second].lru = std::prev(lru.end());
+			}
+		}
+
+		// The budget may have shrunk since the last run
+		bool evicted = false;
+		while (max_bytes && counters.bytes > max_bytes && !lru.empty()) {
+			evict(lru.back());
+			++counters.evictions;
+			evicted = true;
+		}
+		counters.entries = entries.size();
+		opened = true;
+		if (evicted) writeIndex();
+		return true;
+	}
+
+	ResultCache::Entry* ResultCache::lookup(const CacheKey& key) {
+		auto it = opened ? entries.find(key.hex()) : entries.end();
+		if (it == entries.end() || it->second.key_text != key.text()) {
+			++counters.misses;
+			QG_TRACE_COUNTER("resultCache.misses", counters.misses);
+			return NULL;
+		}
+		++counters.hits;
+		QG_TRACE_COUNTER("resultCache.hits", counters.hits);
+		Entry& entry = it->second;
+		entry.tick = next_tick++;
+		lru.splice(lru.begin(), lru, entry.lru);
+		dirty = true;
+		return &entry;
+	}
+
+	bool ResultCache::contains(const CacheKey& key) const {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = entries.find(key.hex());
+		return it != entries.end() && it->second.key_text == key.text();
+	}
+
+	bool ResultCache::fetchFile(const CacheKey& key, const string& dest) {
+		QG_TRACE_SCOPE_CAT("ResultCache::fetchFile", "cache");
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!lookup(key)) return false;
+		return copyFile(entryPath(key.hex()), dest);
+	}
+
+	bool ResultCache::fetchMesh(const CacheKey& key, MeshStructure& ms) {
+		QG_TRACE_SCOPE_CAT("ResultCache::fetchMesh", "cache");
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!lookup(key)) return false;
+		QgmMapping mapping;
+		if (!mapping.open(entryPath(key.hex()))) {
+			// Damaged entry: drop it, the caller rebuilds and stores again
+			evict(key.hex());
+			writeIndex();
+			--counters.hits;
+			++counters.misses;
+			return false;
+		}
+		mapping.load(ms);
+		return true;
+	}
+
+	bool ResultCache::storeFile(const CacheKey& key, const string& src) {
+		QG_TRACE_SCOPE_CAT("ResultCache::storeFile", "cache");
+		if (!opened) return false;
+		string tmpPath = entryPath(key.hex()) + tempSuffix();
+		if (!copyFile(src, tmpPath)) {
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		return commit(key, tmpPath);
+	}
+
+	bool ResultCache::storeMesh(const CacheKey& key, const MeshStructure& ms) {
+		QG_TRACE_SCOPE_CAT("ResultCache::storeMesh", "cache");
+		if (!opened) return false;
+		string tmpPath = entryPath(key.hex()) + tempSuffix();
+		if (!writeQgm(tmpPath, ms)) {
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		return commit(key, tmpPath);
+	}
+
+	bool ResultCache::commit(const CacheKey& key, const string& tmpPath) {
+		string hex = key.hex();
+		uint64_t bytes = 0;
+		// An entry over the whole budget would only evict everything else
+		if (!fileSize(tmpPath, bytes) || (max_bytes && bytes > max_bytes)) {
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+		if (entries.count(hex)) evict(hex);
+		if (!replaceFile(tmpPath, entryPath(hex))) {
+			std::remove(tmpPath.c_str());
+			writeIndex();
+			return false;
+		}
+
+		lru.push_front(hex);
+		Entry& entry = entries[hex];
+		entry.key_text = key.text();
+		entry.bytes = bytes;
+		entry.tick = next_tick++;
+		entry.lru = lru.begin();
+		counters.bytes += bytes;
+		++counters.stores;
+
+		while (max_bytes && counters.bytes > max_bytes) {
+			evict(lru.back());
+			++counters.evictions;
+		}
+		counters.entries = entries.size();
+		QG_TRACE_COUNTER("resultCache.bytes", counters.bytes);
+		return writeIndex();
+	}
+
+	void ResultCache::evict(const string& hex) {
+		auto it = entries.find(hex);
+		if (it == entries.end()) return;
+		std::remove(entryPath(hex).c_str());
+		counters.bytes -= it->second.bytes;
+		lru.erase(it->second.lru);
+		entries.erase(it);
+		counters.entries = entries.size();
+	}
+
+	bool ResultCache::writeIndex() {
+		string tmpPath = dir + "/index" + tempSuffix();
+		{
+			std::ofstream out(tmpPath, std::ios::trunc);
+			if (!out) return false;
+			out << RESULT_CACHE_INDEX_MAGIC << " " << RESULT_CACHE_INDEX_VERSION << "\n";
+			for (const auto& hex : lru) {
+				const Entry& entry = entries[hex];
+				out << hex << " " << entry.bytes << " " << entry.tick << " " << entry.key_text << "\n";
+			}
+			out.close();
+			if (out.fail()) {
+				std::remove(tmpPath.c_str());
+				return false;
+			}
+		}
+		if (!replaceFile(tmpPath, dir + "/index")) {
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+		dirty = false;
+		return true;
+	}
+
+	bool ResultCache::flush() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!opened || !dirty) return true;
+		return writeIndex();
+	}
+
+	void ResultCache::clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!lru.empty()) evict(lru.back());
+		if (opened) writeIndex();
+	}
+
+	ResultCacheStats ResultCache::stats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return counters;
+	}
+
+	void PrintResultCacheStats(const ResultCacheStats& stats, ostream& out) {
+		size_t lookups = stats.hits + stats.misses;
+		out << std::fixed << std::setprecision(1);
+		out << "Cache hits: " << stats.hits << ", misses: " << stats.misses
+			<< ", hit rate: " << (lookups ? 100.0 * stats.hits / lookups : 0.0) << "%"
+			<< ", stores: " << stats.stores << ", evictions: " << stats.evictions
+			<< ", entries: " << stats.entries << ", size: " << stats.bytes / (1024.0 * 1024.0) << " MB" << endl;
+	}
+
+	GenMeshBuilder CachedGenMeshBuilder(const GenMeshBuilder& builder, const string& builderKey, ResultCache& cache) {
+		ResultCache* lCache = &cache;
+		return [builder, builderKey, lCache](const GenMeshJob& job) -> MeshStructure* {
+			CacheKey key = GenMeshJobKey(job, builderKey);
+			unique_ptr<MeshStructure> ms(new MeshStructure());
+			if (lCache->fetchMesh(key, *ms)) return ms.release();
+			MeshStructure* built = builder(job);
+			// NULL is passed on for the batch to report, never stored.
+			// A failed store only costs the next run a rebuild
+			if (built) lCache->storeMesh(key, *built);
+			return built;
+		};
+	}
+	// ===================== end RESULT CACHE ====================== //
+}
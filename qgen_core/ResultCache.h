@@ -0,0 +1,132 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include "MeshStructure.h"
+#include "ComputeLib.h"
+#include "GenCore.h"
+#include <list>
+#include <mutex>
+
+using namespace std;
+
+namespace qg {
+
+	// CONTENT ADDRESSED RESULT CACHE
+	// On disk store of generator results (exported files, or MeshStructures
+	// as .qgm) keyed by their inputs. A CacheKey is the canonical text of
+	// every parameter plus the code version; its 64 bit hash names the
+	// entry file and the full text is kept in the index, so a hash
+	// collision is a miss, never a wrong result.
+	// Entries are evicted least recently used first once the store goes
+	// over its byte budget. The index (dir/index) is rewritten after every
+	// store and eviction, and on flush() for recency updates. Blobs are
+	// written to a temporary file and renamed into place. Safe to share
+	// between threads; one process per directory at a time.
+	// Bump RESULT_CACHE_VERSION whenever the generators change output
+	// without a QGEN_VERSION change: every existing entry then misses.
+	static const int RESULT_CACHE_VERSION = 1;
+
+	class CacheKey {
+	public:
+		// kind separates result types ("job", "mesh", ...)
+		explicit CacheKey(const string& kind);
+
+		CacheKey& add(const string& name, const string& value);
+		CacheKey& add(const string& name, const char* value);
+		CacheKey& add(const string& name, int value);
+		CacheKey& add(const string& name, double value); // exact, round trips
+		CacheKey& add(const string& name, bool value);
+		CacheKey& add(const string& name, const SpreaderInput& p);
+
+		const string& text() const { return key_text; };
+		uint64_t hash() const;
+		string hex() const; // entry file name
+
+	private:
+		string key_text;
+	};
+
+	// Key of a GenMeshJob built by the builder called builderKey
+	CacheKey GenMeshJobKey(const GenMeshJob& job, const string& builderKey);
+	// Key of the file a batch job exports, scenes built by builderKey
+	CacheKey GenJobKey(const GenJobSpec& job, const string& builderKey);
+
+	struct ResultCacheStats {
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t stores = 0;
+		size_t evictions = 0;
+		size_t entries = 0;
+		uint64_t bytes = 0;
+	};
+
+	class ResultCache {
+	public:
+		// maxBytes is the budget for entry files, 0 = unbounded
+		ResultCache(const string& dir, uint64_t maxBytes);
+		~ResultCache();
+
+		// Creates dir if needed and loads the index; index entries whose
+		// file is gone or has the wrong size are dropped
+		bool open(string* error = NULL);
+		bool isOpen() const { return opened; };
+
+		// Copy of the cached file to dest, false on a miss
+		bool fetchFile(const CacheKey& key, const string& dest);
+		// Stores a copy of src, replacing any entry with the same key
+		bool storeFile(const CacheKey& key, const string& src);
+
+		// Cached mesh loaded into ms (as QgmMapping::load), false on a miss
+		bool fetchMesh(const CacheKey& key, MeshStructure& ms);
+		bool storeMesh(const CacheKey& key, const MeshStructure& ms);
+
+		bool contains(const CacheKey& key) const;
+		// Removes every entry
+		void clear();
+		// Writes the index if recency changed since the last write
+		bool flush();
+
+		ResultCacheStats stats() const;
+		const string& directory() const { return dir; };
+		uint64_t maxBytes() const { return max_bytes; };
+
+	private:
+		ResultCache(const ResultCache&);
+		ResultCache& operator=(const ResultCache&);
+
+		struct Entry {
+			string key_text;
+			uint64_t bytes;
+			uint64_t tick; // last use
+			list<string>::iterator lru;
+		};
+
+		string dir;
+		uint64_t max_bytes;
+		bool opened = false;
+		bool dirty = false;
+		uint64_t next_tick = 1;
+		list<string> lru; // hex names, most recent first
+		unordered_map<string, Entry> entries;
+		ResultCacheStats counters;
+		mutable std::mutex mutex;
+
+		string entryPath(const string& hex) const;
+		// Entry for key if present and its key text matches, counts the hit
+		// or miss and refreshes recency on a hit
+		Entry* lookup(const CacheKey& key);
+		// Takes ownership of a written temporary file as the entry for key
+		bool commit(const CacheKey& key, const string& tmpPath);
+		void evict(const string& hex);
+		bool writeIndex();
+	};
+
+	// One line summary: hits, misses, hit rate, stores, evictions, size
+	void PrintResultCacheStats(const ResultCacheStats& stats, ostream& out);
+
+	// builder wrapped with a lookup in cache: meshes are loaded from the
+	// cache when present, built and stored otherwise. builderKey names the
+	// builder and must change whenever its output does. A NULL from
+	// builder is returned as is and not stored
+	GenMeshBuilder CachedGenMeshBuilder(const GenMeshBuilder& builder, const string& builderKey, ResultCache& cache);
+}
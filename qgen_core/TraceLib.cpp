@@ -0,0 +1,204 @@
+#include "TraceLib.h"
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace qg {
+
+	// =========================== TRACE =========================== //
+
+	std::atomic<bool> gTraceEnabled(false);
+
+	struct TraceEvent {
+		const char* name;
+		const char* category;
+		int64_t start;
+		int64_t duration; // -1 for counters
+		double value;
+	};
+
+	// Owned by the registry so events survive the thread that wrote them
+	// (e.g. parallelFor workers)
+	struct TraceThreadBuffer {
+		int tid;
+		vector<TraceEvent> events;
+		size_t dropped = 0;
+	};
+
+	static std::mutex gTraceRegistryMutex;
+	static vector<unique_ptr<TraceThreadBuffer>> gTraceBuffers;
+	static thread_local TraceThreadBuffer* tTraceBuffer = nullptr;
+	static std::atomic<size_t> gTraceMaxEvents(256 * 1024);
+
+	static TraceThreadBuffer& traceBuffer() {
+		if (!tTraceBuffer) {
+			std::lock_guard<std::mutex> lock(gTraceRegistryMutex);
+			gTraceBuffers.push_back(unique_ptr<TraceThreadBuffer>(new TraceThreadBuffer()));
+			tTraceBuffer = gTraceBuffers.back().get();
+			tTraceBuffer->tid = (int)gTraceBuffers.size();
+			tTraceBuffer->events.reserve(1024);
+		}
+		return *tTraceBuffer;
+	}
+
+	static const std::chrono::steady_clock::time_point gTraceEpoch = std::chrono::steady_clock::now();
+
+	int64_t traceNow() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gTraceEpoch).count();
+	}
+
+	void traceEnable(bool enable) {
+		gTraceEnabled.store(enable);
+	}
+
+	void traceReset() {
+		std::lock_guard<std::mutex> lock(gTraceRegistryMutex);
+		for (auto &buffer : gTraceBuffers) {
+			buffer->events.clear();
+			buffer->dropped = 0;
+		}
+	}
+
+	void traceSetMaxEventsPerThread(size_t maxEvents) {
+		gTraceMaxEvents.store(maxEvents);
+	}
+
+	size_t traceMaxEventsPerThread() {
+		return gTraceMaxEvents.load();
+	}
+
+	static void traceRecord(const TraceEvent &e) {
+		TraceThreadBuffer &buffer = traceBuffer();
+		size_t maxEvents = gTraceMaxEvents.load(std::memory_order_relaxed);
+		if (maxEvents && buffer.events.size() >= maxEvents) {
+			buffer.dropped++;
+			return;
+		}
+		buffer.events.push_back(e);
+	}
+
+	void traceRecordScope(const char* name, const char* category, int64_t start, int64_t end) {
+		traceRecord(TraceEvent{ name, category, start, end - start, 0.0 });
+	}
+
+	void traceCounter(const char* name, double value) {
+		if (!traceEnabled()) return;
+		traceRecord(TraceEvent{ name, "counter", traceNow(), -1, value });
+	}
+
+	size_t traceEventCount() {
+		std::lock_guard<std::mutex> lock(gTraceRegistryMutex);
+		size_t n = 0;
+		for (const auto &buffer : gTraceBuffers) n += buffer->events.size();
+		return n;
+	}
+
+	size_t traceDroppedCount() {
+		std::lock_guard<std::mutex> lock(gTraceRegistryMutex);
+		size_t n = 0;
+		for (const auto &buffer : gTraceBuffers) n += buffer->dropped;
+		return n;
+	}
+
+	vector<TraceSummaryRow> traceSummary() {
+		std::lock_guard<std::mutex> lock(gTraceRegistryMutex);
+		// Keyed by string, the same literal may live at several addresses
+		map<pair<string, bool>, TraceSummaryRow> rows;
+		for (const auto &buffer : gTraceBuffers) {
+			for (const auto &e : buffer->events) {
+				bool counter = e.duration < 0;
+				double v = counter ? e.value : e.duration / 1e6;
+				auto key = make_pair(string(e.name), counter);
+				auto it = rows.find(key);
+				if (it == rows.end()) {
+					rows[key] = TraceSummaryRow{ key.first, counter, 1, v, v, v };
+					continue;
+				}
+				TraceSummaryRow &row = it->second;
+				row.count++;
+				row.total_ms += v;
+				row.min_ms = std::min(row.min_ms, v);
+				row.max_ms = std::max(row.max_ms, v);
+			}
+		}
+		vector<TraceSummaryRow> out;
+		for (auto &row : rows) out.push_back(row.second);
+		std::sort(out.begin(), out.end(), [](const TraceSummaryRow &a, const TraceSummaryRow &b) {
+			if (a.counter != b.counter) return !a.counter;
+			return a.total_ms > b.total_ms;
+		});
+		return out;
+	}
+
+	void tracePrintSummary(ostream &out) {
+		vector<TraceSummaryRow> rows = traceSummary();
+		out << std::left << std::setw(32) << "phase" << std::right << std::setw(8) << "count"
+			<< std::setw(12) << "total ms" << std::setw(12) << "mean ms"
+			<< std::setw(12) << "min ms" << std::setw(12) << "max ms" << endl;
+		for (const auto &row : rows) {
+			if (row.counter) continue;
+			out << std::left << std::setw(32) << row.name << std::right << std::setw(8) << row.count
+				<< std::fixed << std::setprecision(3)
+				<< std::setw(12) << row.total_ms << std::setw(12) << row.total_ms / row.count
+				<< std::setw(12) << row.min_ms << std::setw(12) << row.max_ms << endl;
+		}
+		bool header = false;
+		for (const auto &row : rows) {
+			if (!row.counter) continue;
+			if (!header) {
+				out << std::left << std::setw(32) << "counter" << std::right << std::setw(8) << "count"
+					<< std::setw(12) << "sum" << std::setw(12) << "mean" << std::setw(12) << "min"
+					<< std::setw(12) << "max" << endl;
+				header = true;
+			}
+			out << std::left << std::setw(32) << row.name << std::right << std::setw(8) << row.count
+				<< std::fixed << std::setprecision(1)
+				<< std::setw(12) << row.total_ms << std::setw(12) << row.total_ms / row.count
+				<< std::setw(12) << row.min_ms << std::setw(12) << row.max_ms << endl;
+		}
+		size_t dropped = traceDroppedCount();
+		if (dropped) out << "dropped events: " << dropped << " (cap " << traceMaxEventsPerThread() << " per thread)" << endl;
+	}
+
+	static void writeJsonString(ostream &out, const char* s) {
+		out << '"';
+		for (; *s; s++) {
+			if (*s == '"' || *s == '\\') out << '\\';
+			out << *s;
+		}
+		out << '"';
+	}
+
+	bool traceWriteChrome(const string &path) {
+		std::ofstream out(path);
+		if (!out) return false;
+		std::lock_guard<std::mutex> lock(gTraceRegistryMutex);
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		out << std::fixed << std::setprecision(3);
+		bool first = true;
+		for (const auto &buffer : gTraceBuffers) {
+			for (const auto &e : buffer->events) {
+				if (!first) out << ",\n";
+				first = false;
+				out << "{\"name\":";
+				writeJsonString(out, e.name);
+				out << ",\"cat\":";
+				writeJsonString(out, e.category);
+				// Chrome expects microseconds
+				out << ",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":" << e.start / 1000.0;
+				if (e.duration >= 0) {
+					out << ",\"ph\":\"X\",\"dur\":" << e.duration / 1000.0 << "}";
+				}
+				else {
+					out << ",\"ph\":\"C\",\"args\":{\"value\":" << e.value << "}}";
+				}
+			}
+		}
+		size_t dropped = 0;
+		for (const auto &buffer : gTraceBuffers) dropped += buffer->dropped;
+		out << "\n],\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+		return (bool)out;
+	}
+	// ========================= end TRACE ========================= //
+}
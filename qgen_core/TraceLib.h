@@ -0,0 +1,83 @@
+#pragma once
+
+#include "BaseWrapper.h"
+#include <atomic>
+
+using namespace std;
+
+// PHASE TIMING / TRACE
+// QG_TRACE_SCOPE("name") times the enclosing scope, QG_TRACE_COUNTER records
+// a value. Events go to a per thread buffer (no lock on the hot path) and
+// can be written as a Chrome trace_event JSON file (chrome://tracing,
+// Perfetto) or summarised per name.
+// Recording is off until traceEnable(true): a disabled scope costs one
+// relaxed atomic load. Defining QG_TRACE_DISABLED compiles the macros out.
+// Names and categories must be string literals (or otherwise outlive the
+// trace), they are stored as pointers.
+// Each thread keeps at most traceMaxEventsPerThread() events, later ones
+// are counted and dropped so a long running server stays bounded.
+#ifdef QG_TRACE_DISABLED
+#define QG_TRACE_SCOPE(name)
+#define QG_TRACE_SCOPE_CAT(name, category)
+#define QG_TRACE_COUNTER(name, value)
+#else
+#define QG_TRACE_CONCAT_IMPL(a, b) a##b
+#define QG_TRACE_CONCAT(a, b) QG_TRACE_CONCAT_IMPL(a, b)
+#define QG_TRACE_SCOPE(name) qg::TraceScope QG_TRACE_CONCAT(qgTraceScope, __LINE__)(name, "qgen")
+#define QG_TRACE_SCOPE_CAT(name, category) qg::TraceScope QG_TRACE_CONCAT(qgTraceScope, __LINE__)(name, category)
+#define QG_TRACE_COUNTER(name, value) do { if (qg::traceEnabled()) qg::traceCounter(name, (double)(value)); } while (0)
+#endif
+
+namespace qg {
+
+	extern std::atomic<bool> gTraceEnabled;
+
+	inline bool traceEnabled() { return gTraceEnabled.load(std::memory_order_relaxed); };
+	void traceEnable(bool enable);
+	// Drops every recorded event and the dropped count. Not safe while
+	// other threads record
+	void traceReset();
+	// Per thread event cap, 0 = unbounded. Default 256K (~10 MB per thread)
+	void traceSetMaxEventsPerThread(size_t maxEvents);
+	size_t traceMaxEventsPerThread();
+
+	// Nanoseconds since the trace clock started
+	int64_t traceNow();
+	void traceRecordScope(const char* name, const char* category, int64_t start, int64_t end);
+	void traceCounter(const char* name, double value);
+
+	class TraceScope {
+	public:
+		TraceScope(const char* name, const char* category)
+			: name(name), category(category), start(traceEnabled() ? traceNow() : -1) {};
+		~TraceScope() {
+			if (start >= 0) traceRecordScope(name, category, start, traceNow());
+		};
+	private:
+		TraceScope(const TraceScope&);
+		TraceScope& operator=(const TraceScope&);
+		const char* name;
+		const char* category;
+		int64_t start;
+	};
+
+	// Per name totals of the recorded scopes and counters
+	struct TraceSummaryRow {
+		string name;
+		bool counter;
+		size_t count;
+		double total_ms; // scopes: summed duration, counters: summed value
+		double min_ms;
+		double max_ms;
+	};
+	// Sorted by total, descending. Call once recording threads are idle
+	vector<TraceSummaryRow> traceSummary();
+	void tracePrintSummary(ostream &out);
+
+	// Chrome trace_event JSON: complete ("X") events for scopes, "C"
+	// events for counters. Call once recording threads are idle
+	bool traceWriteChrome(const string &path);
+	size_t traceEventCount();
+	// Events not recorded because their thread's buffer was full
+	size_t traceDroppedCount();
+}
@@ -0,0 +1,205 @@
+#include "BenchHarness.h"
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <sstream>
+
+// ====================== ALLOCATION COUNTERS ====================== //
+// Replaced for the bench executable only. Sized / aligned forms fall back
+// to these through the standard library defaults
+
+static std::atomic<size_t> gAllocations(0);
+static std::atomic<size_t> gAllocatedBytes(0);
+
+static inline void countAllocation(size_t bytes) {
+	gAllocations.fetch_add(1, std::memory_order_relaxed);
+	gAllocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void* operator new(size_t bytes) {
+	countAllocation(bytes);
+	void* p = std::malloc(bytes ? bytes : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t bytes) {
+	return ::operator new(bytes);
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+
+static void* countedMalloc(size_t bytes) {
+	countAllocation(bytes);
+	return std::malloc(bytes);
+}
+
+static void* countedCalloc(size_t count, size_t bytes) {
+	countAllocation(count * bytes);
+	return std::calloc(count, bytes);
+}
+
+static void* countedRealloc(void* p, size_t bytes) {
+	countAllocation(bytes);
+	return std::realloc(p, bytes);
+}
+
+static void countedFree(void* p) {
+	std::free(p);
+}
+// ==================== end ALLOCATION COUNTERS ==================== //
+
+namespace qg {
+
+	AllocStats allocStats() {
+		return AllocStats{ gAllocations.load(), gAllocatedBytes.load() };
+	}
+
+	void installFbxAllocCounters() {
+		FbxSetMallocHandler(countedMalloc);
+		FbxSetCallocHandler(countedCalloc);
+		FbxSetReallocHandler(countedRealloc);
+		FbxSetFreeHandler(countedFree);
+	}
+
+	// ======================== BENCH RUNNER ======================= //
+
+	bool BenchRunner::enabled(const string &name, size_t size) const {
+		if (size > options.max_size) return false;
+		return options.filter.empty() || name.find(options.filter) != string::npos;
+	}
+
+	void BenchRunner::run(const string &name, size_t size, size_t opsPerIter,
+		const function<void()> &body, const function<void()> &setup, const function<void()> &teardown) {
+		if (!enabled(name, size)) return;
+
+		vector<double> times;
+		double total = 0.0;
+		AllocStats allocated = { 0, 0 };
+		while (times.size() < options.min_iterations ||
+			(total < options.min_time_ms && times.size() < options.max_iterations)) {
+			if (setup) setup();
+			AllocStats a0 = allocStats();
+			auto t0 = std::chrono::steady_clock::now();
+			body();
+			auto t1 = std::chrono::steady_clock::now();
+			AllocStats a1 = allocStats();
+			if (teardown) teardown();
+
+			double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+			times.push_back(ms);
+			total += ms;
+			allocated = AllocStats{ a1.allocations - a0.allocations, a1.bytes - a0.bytes };
+		}
+
+		std::sort(times.begin(), times.end());
+		BenchResult r;
+		r.name = name;
+		r.size = size;
+		r.iterations = times.size();
+		r.median_ms = times[times.size() / 2];
+		r.min_ms = times.front();
+		r.ns_per_op = opsPerIter ? r.median_ms * 1e6 / opsPerIter : 0.0;
+		r.ops_per_sec = r.median_ms > 0.0 ? opsPerIter * 1000.0 / r.median_ms : 0.0;
+		r.bytes_allocated = allocated.bytes;
+		r.allocations = allocated.allocations;
+		bench_results.push_back(r);
+
+		cout << std::left << std::setw(36) << name << std::right << std::setw(10) << size
+			<< std::setw(12) << std::fixed << std::setprecision(2) << r.ns_per_op << " ns/op"
+			<< std::setw(12) << std::setprecision(1) << r.median_ms << " ms"
+			<< std::setw(14) << r.bytes_allocated << " B" << endl;
+	}
+
+	void BenchRunner::printTable(ostream &out) const {
+		out << std::left << std::setw(36) << "case" << std::right << std::setw(10) << "size"
+			<< std::setw(8) << "iters" << std::setw(14) << "ns/op" << std::setw(14) << "ops/sec"
+			<< std::setw(12) << "median ms" << std::setw(14) << "bytes" << std::setw(10) << "allocs" << endl;
+		for (const auto &r : bench_results) {
+			out << std::left << std::setw(36) << r.name << std::right << std::setw(10) << r.size
+				<< std::setw(8) << r.iterations
+				<< std::setw(14) << std::fixed << std::setprecision(2) << r.ns_per_op
+				<< std::setw(14) << std::setprecision(0) << r.ops_per_sec
+				<< std::setw(12) << std::setprecision(2) << r.median_ms
+				<< std::setw(14) << r.bytes_allocated << std::setw(10) << r.allocations << endl;
+		}
+	}
+
+	bool BenchRunner::writeJson(const string &path) const {
+		std::ofstream out(path);
+		if (!out) return false;
+		long long stamp = std::chrono::duration_cast<std::chrono::seconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		out << "{\n  \"qgen_version\": \"" << QGEN_VERSION << "\",\n  \"timestamp\": " << stamp
+			<< ",\n  \"results\": [\n";
+		out << std::setprecision(6);
+		for (size_t i = 0; i < bench_results.size(); i++) {
+			const BenchResult &r = bench_results[i];
+			out << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+				<< ", \"iterations\": " << r.iterations
+				<< ", \"ns_per_op\": " << r.ns_per_op
+				<< ", \"median_ms\": " << r.median_ms
+				<< ", \"min_ms\": " << r.min_ms
+				<< ", \"ops_per_sec\": " << r.ops_per_sec
+				<< ", \"bytes_allocated\": " << r.bytes_allocated
+				<< ", \"allocations\": " << r.allocations << "}"
+				<< (i + 1 < bench_results.size() ? ",\n" : "\n");
+		}
+		out << "  ]\n}\n";
+		return (bool)out;
+	}
+
+	bool BenchRunner::writeCsv(const string &path) const {
+		std::ofstream out(path);
+		if (!out) return false;
+		out << "name,size,iterations,ns_per_op,median_ms,min_ms,ops_per_sec,bytes_allocated,allocations\n";
+		out << std::setprecision(6);
+		for (const auto &r : bench_results) {
+			out << r.name << ',' << r.size << ',' << r.iterations << ',' << r.ns_per_op << ','
+				<< r.median_ms << ',' << r.min_ms << ',' << r.ops_per_sec << ','
+				<< r.bytes_allocated << ',' << r.allocations << '\n';
+		}
+		return (bool)out;
+	}
+
+	int BenchRunner::compareBaseline(const string &csvPath, double threshold, ostream &out) const {
+		std::ifstream in(csvPath);
+		if (!in) {
+			out << "Baseline " << csvPath << " not found" << endl;
+			return 0;
+		}
+		// name,size -> ns_per_op
+		map<pair<string, size_t>, double> baseline;
+		string line;
+		std::getline(in, line); // header
+		while (std::getline(in, line)) {
+			std::istringstream row(line);
+			string name, size, iterations, ns;
+			if (!std::getline(row, name, ',') || !std::getline(row, size, ',') ||
+				!std::getline(row, iterations, ',') || !std::getline(row, ns, ',')) continue;
+			baseline[make_pair(name, (size_t)std::stoull(size))] = std::stod(ns);
+		}
+
+		int regressions = 0;
+		for (const auto &r : bench_results) {
+			auto it = baseline.find(make_pair(r.name, r.size));
+			if (it == baseline.end() || it->second <= 0.0) continue;
+			double change = r.ns_per_op / it->second - 1.0;
+			bool slower = change > threshold;
+			if (slower) ++regressions;
+			out << std::left << std::setw(36) << r.name << std::right << std::setw(10) << r.size
+				<< std::setw(10) << std::fixed << std::setprecision(1) << change * 100.0 << " %"
+				<< (slower ? "  REGRESSION" : "") << endl;
+		}
+		return regressions;
+	}
+	// ====================== end BENCH RUNNER ===================== //
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../BaseWrapper.h"
+#include <functional>
+
+using namespace std;
+
+namespace qg {
+
+	// One case measured at one size
+	struct BenchResult {
+		string name;
+		size_t size;            // problem size, quads unless the case says otherwise
+		size_t iterations;
+		double ns_per_op;       // median iteration time / ops per iteration
+		double median_ms;
+		double min_ms;
+		double ops_per_sec;     // throughput at the median
+		size_t bytes_allocated; // heap bytes requested by one iteration
+		size_t allocations;     // heap allocations of one iteration
+	};
+
+	struct BenchOptions {
+		size_t max_size = 1000000;
+		size_t min_iterations = 3;
+		size_t max_iterations = 50;
+		// Iterate until this much time is measured, within the bounds above
+		double min_time_ms = 200.0;
+		// Runs only cases whose name contains filter, empty runs all
+		string filter;
+	};
+
+	// Heap traffic so far: operator new plus the FBX SDK allocation
+	// handlers, both replaced by the bench executable
+	struct AllocStats {
+		size_t allocations;
+		size_t bytes;
+	};
+	AllocStats allocStats();
+	// Routes FBX SDK heap allocations through the counters. Must be called
+	// before the first FbxManager::Create
+	void installFbxAllocCounters();
+
+	// Runs cases, keeps results, writes them as JSON or CSV and compares
+	// against a previous CSV to flag regressions between releases
+	class BenchRunner {
+	public:
+		explicit BenchRunner(const BenchOptions &options) : options(options) {};
+
+		bool enabled(const string &name, size_t size) const;
+		// Times body over several iterations, setup and teardown run around
+		// every iteration untimed
+		void run(const string &name, size_t size, size_t opsPerIter,
+			const function<void()> &body,
+			const function<void()> &setup = function<void()>(),
+			const function<void()> &teardown = function<void()>());
+
+		const vector<BenchResult>& results() const { return bench_results; };
+
+		void printTable(ostream &out) const;
+		bool writeJson(const string &path) const;
+		bool writeCsv(const string &path) const;
+		// Prints the ns/op change of every case found in the baseline CSV.
+		// Returns how many got slower by more than threshold (0.1 = 10%)
+		int compareBaseline(const string &csvPath, double threshold, ostream &out) const;
+
+	private:
+		BenchOptions options;
+		vector<BenchResult> bench_results;
+	};
+}
@@ -0,0 +1,391 @@
+// qgen_bench: micro and macro benchmarks for qgen_core
+//
+// qgen_bench [--max-quads N] [--full] [--filter NAME] [--iterations N]
+//            [--min-time MS] [--json FILE] [--csv FILE]
+//            [--baseline FILE] [--threshold PERCENT] [--tmp FILE]
+//
+// Sizes run from 1K quads up to --max-quads (1M by default, --full for
+// 10M). Exits with 1 when --baseline is given and a case got slower than
+// --threshold percent (10 by default).
+
+#include "BenchHarness.h"
+#include "../MeshStructure.h"
+#include "../MeshBuilder.h"
+#include "../MeshMerge.h"
+#include "../ComputeLib.h"
+#include "../FBXTransformer.h"
+#include "../GenCore.h"
+#include "../FbxBinaryWriter.h"
+#include "../GlbWriter.h"
+#include "../QgmFormat.h"
+#include "../MeshTriangles.h"
+#include "../MeshDecimate.h"
+#include <cstdio>
+
+using namespace std;
+using namespace qg;
+
+static QuadFaceDTO gridFaceDTO(int i, int j, float cell) {
+	QuadFaceDTO dto;
+	float x0 = i * cell, x1 = (i + 1) * cell, z0 = j * cell, z1 = (j + 1) * cell;
+	dto.verts[0] = { x0, 0.0f, z0 };
+	dto.verts[1] = { x0, 0.0f, z1 };
+	dto.verts[2] = { x1, 0.0f, z1 };
+	dto.verts[3] = { x1, 0.0f, z0 };
+	for (int c = 0; c < 4; c++) {
+		dto.uvs[c] = { 0.0f, 0.0f };
+		dto.normals[c] = { 0.0f, 1.0f, 0.0f };
+	}
+	dto.faceIndex = j;
+	return dto;
+}
+
+static bool anyEnabled(const BenchRunner &runner, const vector<string> &names, size_t size) {
+	for (const auto &name : names) {
+		if (runner.enabled(name, size)) return true;
+	}
+	return false;
+}
+
+// ========================= MESH CASES ======================== //
+
+static void benchMeshCases(BenchRunner &runner, int side) {
+	const size_t quads = (size_t)side * side;
+	const size_t numVerts = (size_t)(side + 1) * (side + 1);
+
+	runner.run("weld_stream_build", quads, quads, [&]() {
+		MeshStreamBuilder builder(numVerts, quads);
+		for (int j = 0; j < side; j++) {
+			for (int i = 0; i < side; i++) builder.addFace(gridFaceDTO(i, j, 1.0f));
+		}
+		MeshStructure ms = builder.finish();
+	});
+
+	if (!anyEnabled(runner, { "rebuild_vert_index_reverse_map", "rebuild_indexFaceIndexList_map",
+		"dropVerts", "dropVerts_sequential_erase" }, quads)) return;
+	MeshStructure* base = buildGridMesh(side, side, 1.0f);
+
+	runner.run("rebuild_vert_index_reverse_map", quads, numVerts, [&]() {
+		base->rebuild_vert_index_reverse_map();
+	});
+	runner.run("rebuild_indexFaceIndexList_map", quads, quads, [&]() {
+		base->rebuild_indexFaceIndexList_map();
+	});
+
+	vector<int> drop;
+	for (int i = 0; i < (int)numVerts; i += 7) drop.push_back(i);
+	MeshStructure work;
+	runner.run("dropVerts", quads, drop.size(), [&]() {
+		work.dropVerts(drop);
+	}, [&]() {
+		work = *base;
+		work.rebuild_vert_index_reverse_map();
+	}, [&]() {
+		work = MeshStructure();
+	});
+
+	// Previous implementation, one vector::erase per dropped vert. O(n^2)
+	if (quads <= 100000) {
+		vector<qvec3> legacy;
+		runner.run("dropVerts_sequential_erase", quads, drop.size(), [&]() {
+			for (auto rit = drop.rbegin(); rit != drop.rend(); ++rit) {
+				legacy.erase(legacy.begin() + *rit);
+			}
+		}, [&]() {
+			legacy.assign(base->verts.begin(), base->verts.end());
+		});
+	}
+	delete base;
+}
+
+static void benchMergeCases(BenchRunner &runner, size_t quads) {
+	// 16 x 16 modules stitched along X on declared borders
+	const int M = 16;
+	const size_t numModules = std::max<size_t>(1, quads / (M * M));
+	if (!runner.enabled("mergeMeshes", quads)) return;
+
+	vector<MeshStructure> modules(numModules);
+	vector<const MeshStructure*> parts;
+	for (size_t m = 0; m < numModules; m++) {
+		MeshStructure* grid = buildGridMesh(M, M, 1.0f);
+		modules[m] = *grid;
+		delete grid;
+		VertString left, right;
+		float offset = (float)(m * M);
+		for (auto &v : modules[m].verts) {
+			v.x += offset;
+			if (v.x == offset) left.verts.push_back(v);
+			if (v.x == offset + M) right.verts.push_back(v);
+		}
+		modules[m].holes_and_borders["left"] = left;
+		modules[m].holes_and_borders["right"] = right;
+		parts.push_back(&modules[m]);
+	}
+	runner.run("mergeMeshes", numModules * M * M, numModules * M * M, [&]() {
+		MeshStructure merged = mergeMeshes(parts);
+	});
+}
+
+// ========================== QGM CASES ======================== //
+
+// Warm start: write once, then map (in place use) or map and copy out
+static void benchQgmCases(BenchRunner &runner, int side, const string &tmpFile) {
+	const size_t quads = (size_t)side * side;
+	if (!anyEnabled(runner, { "writeQgm", "QgmMapping_open", "QgmMapping_load" }, quads)) return;
+	MeshStructure* ms = buildGridMesh(side, side, 1.0f);
+	const string path = tmpFile + ".qgm";
+
+	runner.run("writeQgm", quads, quads, [&]() {
+		writeQgm(path, *ms);
+	});
+	writeQgm(path, *ms);
+	QgmMapping mapping;
+	runner.run("QgmMapping_open", quads, quads, [&]() {
+		mapping.open(path);
+	}, nullptr, [&]() {
+		mapping.close();
+	});
+	MeshStructure loaded;
+	runner.run("QgmMapping_load", quads, quads, [&]() {
+		mapping.open(path);
+		mapping.load(loaded);
+	}, nullptr, [&]() {
+		mapping.close();
+		loaded = MeshStructure();
+	});
+
+	std::remove(path.c_str());
+	delete ms;
+}
+
+// ======================= TRIANGLE CASES ====================== //
+
+static void benchTriangleCases(BenchRunner &runner, int side) {
+	const size_t quads = (size_t)side * side;
+	if (!anyEnabled(runner, { "triangulateQuads", "optimizeVertexCache", "optimizeVertexFetch" }, quads)) return;
+	MeshStructure* ms = buildGridMesh(side, side, 1.0f);
+
+	runner.run("triangulateQuads", quads, quads * 2, [&]() {
+		triangulateQuads(*ms);
+	});
+	const TriangleMesh source = triangulateQuads(*ms);
+	TriangleMesh tm;
+	runner.run("optimizeVertexCache", quads, source.triangleCount(), [&]() {
+		optimizeVertexCache(tm.indices, tm.vertexCount());
+	}, [&]() {
+		tm = source;
+	});
+	runner.run("optimizeVertexFetch", quads, source.vertexCount(), [&]() {
+		optimizeVertexFetch(tm);
+	}, [&]() {
+		tm = source;
+	});
+	delete ms;
+}
+
+// ========================= LOD CASES ========================= //
+
+static void benchLodCases(BenchRunner &runner, int side) {
+	const size_t quads = (size_t)side * side;
+	if (!anyEnabled(runner, { "decimateQuads", "buildLodChain" }, quads)) return;
+	MeshStructure* source = buildGridMesh(side, side, 1.0f);
+	for (auto &v : source->verts) v.y = 0.25f * std::sin(v.x * 0.7f) * std::cos(v.z * 0.9f);
+
+	MeshStructure ms;
+	DecimateOptions options;
+	options.target_faces = quads / 4;
+	runner.run("decimateQuads", quads, quads - options.target_faces, [&]() {
+		decimateQuads(ms, options);
+	}, [&]() {
+		ms = *source;
+	});
+	runner.run("buildLodChain", quads, quads, [&]() {
+		vector<MeshStructure> levels = buildLodChain(*source);
+	});
+	delete source;
+}
+
+// ======================= SPREADER CASES ====================== //
+
+static void benchSpreaderCases(BenchRunner &runner, size_t points) {
+	SpreaderInput p = { (int)points, 10.0f, 0, 1, 0.5f, 1 };
+	runner.run("positionRadialSpreader", points, points, [&]() {
+		vector<glm::vec3> out = positionRadialSpreader(p, [](SpreaderInput) { return 1.0f; });
+	});
+
+	vector<glm::vec3> out;
+	runner.run("positionRadialSpreaderBatch", points, points, [&]() {
+		positionRadialSpreaderBatch(p, [](const SpreaderInput&) { return 1.0f; }, out.data());
+	}, [&]() {
+		out.resize(points);
+	});
+}
+
+// ========================== FBX CASES ======================== //
+
+static void benchFbxCases(BenchRunner &runner, FbxManager* manager, int side, const string &tmpFile) {
+	const size_t quads = (size_t)side * side;
+	if (!anyEnabled(runner, { "fbxTransform", "fbxTransform_incremental", "fbxTransform_soa",
+		"fbxTransform_triangulate", "SaveScene_binary", "SaveScene_ascii", "writeFbxBinary", "writeGlb" }, quads)) return;
+	MeshStructure* ms = buildGridMesh(side, side, 1.0f);
+	FbxScene* scene = nullptr;
+
+	auto newScene = [&]() { scene = FbxScene::Create(manager, "BenchScene"); };
+	auto destroyScene = [&]() {
+		scene->Destroy();
+		scene = nullptr;
+	};
+
+	FbxTransformOptions bulk;
+	runner.run("fbxTransform", quads, quads, [&]() {
+		fbxTransformMesh(*ms, scene, "Bench", bulk);
+	}, newScene, destroyScene);
+
+	if (quads <= 1000000) {
+		FbxTransformOptions incremental;
+		incremental.bulk = false;
+		runner.run("fbxTransform_incremental", quads, quads, [&]() {
+			fbxTransformMesh(*ms, scene, "Bench", incremental);
+		}, newScene, destroyScene);
+	}
+
+	// Same export from SoA streams, conversion excluded: builders filling
+	// MeshStructureSoA directly skip it
+	const MeshStructureSoA soa = MeshStructureSoA::fromAoS(*ms);
+	runner.run("fbxTransform_soa", quads, quads, [&]() {
+		fbxTransformMesh(soa, scene, "Bench", bulk);
+	}, newScene, destroyScene);
+
+	FbxTransformOptions triangles;
+	triangles.triangulate = true;
+	runner.run("fbxTransform_triangulate", quads, quads, [&]() {
+		fbxTransformMesh(*ms, scene, "Bench", triangles);
+	}, newScene, destroyScene);
+
+	char nodeName[] = "Bench";
+	auto meshScene = [&]() {
+		newScene();
+		fbxTransform(*ms, scene, nodeName);
+	};
+	const int binary = manager->GetIOPluginRegistry()->GetNativeWriterFormat();
+	runner.run("SaveScene_binary", quads, quads, [&]() {
+		SaveScene(manager, scene, tmpFile.c_str(), binary, false);
+	}, meshScene, destroyScene);
+
+	// Same file without SDK objects: compare with fbxTransform + SaveScene_binary
+	vector<FbxWriterMesh> direct(1);
+	direct[0].mesh = ms;
+	direct[0].name = "Bench";
+	runner.run("writeFbxBinary", quads, quads, [&]() {
+		writeFbxBinary(tmpFile, direct);
+	});
+	runner.run("writeGlb", quads, quads, [&]() {
+		writeGlb(tmpFile, direct);
+	});
+
+	// -1 with no embedded media falls back to ascii
+	if (quads <= 100000) {
+		runner.run("SaveScene_ascii", quads, quads, [&]() {
+			SaveScene(manager, scene, tmpFile.c_str(), -1, false);
+		}, meshScene, destroyScene);
+	}
+
+	std::remove(tmpFile.c_str());
+	delete ms;
+}
+
+// ======================== PIPELINE CASES ===================== //
+
+// Sequential vs pipelined batch on the global SDK manager, one grid mesh
+// per job: the pipelined batch should approach max(build, write) per job
+static void benchPipelineCases(BenchRunner &runner, int side, const string &tmpFile) {
+	const size_t quads = (size_t)side * side;
+	const size_t numJobs = 8;
+	if (quads > 1000000 || !anyEnabled(runner, { "batch_sequential", "batch_pipelined" }, quads)) return;
+
+	vector<GenJobSpec> jobs(numJobs);
+	for (size_t i = 0; i < numJobs; i++) {
+		jobs[i].output = tmpFile + "." + to_string(i) + ".fbx";
+		jobs[i].format = "binary";
+		jobs[i].embed = false;
+	}
+	GenPipelineOptions options;
+	options.builder = [side](const GenMeshJob&) { return buildGridMesh(side, side, 1.0f); };
+
+	// RunJobBatch loop with the grid builder
+	runner.run("batch_sequential", quads, numJobs, [&]() {
+		if (!gSdkManager) CreateScene();
+		for (size_t i = 0; i < numJobs; i++) {
+			ResetScene();
+			CreateGenMeshBatch(1, options.builder, 0, false, false);
+			SaveScene(gSdkManager, gScene, jobs[i].output.c_str(), gSdkManager->GetIOPluginRegistry()->GetNativeWriterFormat(), false);
+		}
+	});
+	runner.run("batch_pipelined", quads, numJobs, [&]() {
+		RunJobBatchPipelined(jobs, NULL, options);
+	});
+	for (const auto &job : jobs) std::remove(job.output.c_str());
+}
+
+int main(int argc, const char* argv[]) {
+	BenchOptions options;
+	string jsonPath, csvPath, baselinePath;
+	string tmpFile = "qgen_bench_tmp.fbx";
+	double threshold = 0.10;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--full") options.max_size = 10000000;
+		else if (arg == "--max-quads" && hasValue) options.max_size = (size_t)std::stoull(argv[++i]);
+		else if (arg == "--filter" && hasValue) options.filter = argv[++i];
+		else if (arg == "--iterations" && hasValue) options.min_iterations = options.max_iterations = (size_t)std::stoull(argv[++i]);
+		else if (arg == "--min-time" && hasValue) options.min_time_ms = std::stod(argv[++i]);
+		else if (arg == "--json" && hasValue) jsonPath = argv[++i];
+		else if (arg == "--csv" && hasValue) csvPath = argv[++i];
+		else if (arg == "--baseline" && hasValue) baselinePath = argv[++i];
+		else if (arg == "--threshold" && hasValue) threshold = std::stod(argv[++i]) / 100.0;
+		else if (arg == "--tmp" && hasValue) tmpFile = argv[++i];
+		else {
+			cout << "Unknown or incomplete argument: " << arg << endl;
+			return 2;
+		}
+	}
+
+	cout << "QGEN " QGEN_VERSION " benchmarks, up to " << options.max_size << " quads" << endl;
+	installFbxAllocCounters();
+	FbxManager* manager = nullptr;
+	FbxScene* scene = nullptr;
+	InitializeSdkObjects(manager, scene);
+
+	BenchRunner runner(options);
+	// ~1K, 10K, 100K, 1M and 10M quads
+	const int sides[] = { 32, 100, 316, 1000, 3162 };
+	for (int side : sides) {
+		const size_t quads = (size_t)side * side;
+		if (quads > options.max_size) break;
+		benchMeshCases(runner, side);
+		benchMergeCases(runner, quads);
+		benchQgmCases(runner, side, tmpFile);
+		benchTriangleCases(runner, side);
+		benchLodCases(runner, side);
+		benchSpreaderCases(runner, quads);
+		benchFbxCases(runner, manager, side, tmpFile);
+		benchPipelineCases(runner, side, tmpFile);
+	}
+
+	DestroySdkObjects(manager, false);
+	DestroySdkObjects(gSdkManager, false);
+
+	cout << endl;
+	runner.printTable(cout);
+	if (!jsonPath.empty() && !runner.writeJson(jsonPath)) cout << "Failed to write " << jsonPath << endl;
+	if (!csvPath.empty() && !runner.writeCsv(csvPath)) cout << "Failed to write " << csvPath << endl;
+
+	int regressions = 0;
+	if (!baselinePath.empty()) {
+		cout << endl << "Change against " << baselinePath << endl;
+		regressions = runner.compareBaseline(baselinePath, threshold, cout);
+	}
+	return regressions > 0 ? 1 : 0;
+}